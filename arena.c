@@ -0,0 +1,105 @@
+#include "arena.h"
+#include "diag.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_SIZE  (64 * 1024)
+// strictest alignment any AST node needs (malloc's guarantee on x86-64)
+#define ALIGN       16
+
+struct chunk {
+    struct chunk *next;
+    size_t        size;
+    size_t        used;
+    char          data[] __attribute__((aligned(ALIGN)));
+};
+
+// chunks are kept for the life of the process; 'curr' is the one being bumped, those before it are full.
+// Each thread bumps its own (see arena_detach)
+static __thread struct chunk *first = NULL, *curr = NULL;
+static __thread size_t        used_total = 0;
+
+static struct chunk *chunk_create(size_t size){
+    struct chunk *c = malloc(sizeof(*c) + size);
+    if( !c ) diag_fatal("Could not allocate arena chunk of %zu bytes", size);
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+    return c;
+}
+
+void *arena_alloc(size_t size){
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+
+    // move on to the next kept chunk with room, allocating one when we run out
+    while( !curr || curr->size - curr->used < size ){
+        if( curr && curr->next ){
+            curr = curr->next;
+            continue;
+        }
+        struct chunk *c = chunk_create(size > CHUNK_SIZE ? size : CHUNK_SIZE);
+        if( curr ) curr->next = c;
+        else       first = c;
+        curr = c;
+    }
+
+    void *p = curr->data + curr->used;
+    curr->used += size;
+    used_total += size;
+    return p;
+}
+
+char *arena_strndup(const char *s, size_t n){
+    char *dup = arena_alloc(n + 1);
+    memcpy(dup, s, n);
+    dup[n] = '\0';
+    return dup;
+}
+
+char *arena_strdup(const char *s){
+    return arena_strndup(s, strlen(s));
+}
+
+void arena_reset(){
+    for( struct chunk *c = first; c; c = c->next ) c->used = 0;
+    curr = first;
+    used_total = 0;
+}
+
+struct arena_mark arena_mark(){
+    return (struct arena_mark){ curr, curr ? curr->used : 0, used_total };
+}
+
+void arena_release(struct arena_mark mark){
+    // a mark taken before the first allocation is the same as a reset
+    if( !mark.chunk ){
+        arena_reset();
+        return;
+    }
+    struct chunk *c = mark.chunk;
+    c->used = mark.used;
+    // the chunks after the marked one were only bumped since the mark
+    for( struct chunk *after = c->next; after; after = after->next ) after->used = 0;
+    curr = c;
+    used_total = mark.used_total;
+}
+
+void *arena_detach(){
+    struct chunk *chunks = first;
+    first = curr = NULL;
+    used_total = 0;
+    return chunks;
+}
+
+void arena_attach(void *chunks){
+    // after every chunk of this thread's, kept ones included: what they hold was allocated after anything here
+    struct chunk *last = first;
+    while( last && last->next ) last = last->next;
+    if( last ) last->next = chunks;
+    else       first = curr = chunks;
+    for( struct chunk *c = chunks; c; c = c->next ) used_total += c->used;
+}
+
+size_t arena_used(){
+    return used_total;
+}
@@ -0,0 +1,36 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Bump allocator backing the AST (nodes, identifier names, literal data).
+   Nothing allocated here is freed individually: arena_reset releases all of it at once, keeping the chunks for the next compile,
+   and arena_release what was allocated after a mark. */
+
+/* never returns NULL: failure goes through diag_fatal */
+void  *arena_alloc( size_t size );
+char  *arena_strdup( const char *s );
+char  *arena_strndup( const char *s, size_t n );
+
+void   arena_reset();
+
+/* a point in the arena to roll back to: what was allocated since is released at once (and its memory reused), what was
+   allocated before is untouched */
+struct arena_mark {
+    void  *chunk;
+    size_t used;
+    size_t used_total;
+};
+struct arena_mark arena_mark();
+void   arena_release( struct arena_mark mark );
+
+/* Each thread allocates from chunks of its own, without locking. A thread done allocating (a worker of a parallel
+   codegen_program) detaches its chunks, and the thread that will use what is in them attaches them to its arena: they are
+   then its latest allocations, released as such by arena_reset and arena_release */
+void  *arena_detach();
+void   arena_attach( void *chunks );
+
+/* bytes handed out since the last reset */
+size_t arena_used();
+
+#endif
@@ -0,0 +1,209 @@
+#include "bounds.h"
+#include "codegen.h"
+#include "runtime.h"
+#include "diag.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* a check that failed jumps to its stub, which reports the index still in its register */
+struct bounds_stub {
+    const char *label;
+    reg_t       index;
+    long        length;
+    // the function generated: the caller, where the access is in a body inlined into it
+    const char *function;
+};
+
+/* range of a for loop's variable, inside its body */
+struct bounds_fact {
+    struct symbol *symbol;
+    long           lo, hi;
+};
+
+/* stubs of the function being generated (on this thread) */
+static __thread struct bounds_stub *stubs = NULL;
+static __thread int stub_count = 0, stub_cap = 0;
+/* ranges known at this point of the code: the loops' being generated, innermost last */
+static __thread struct bounds_fact *facts = NULL;
+static __thread int fact_count = 0, fact_cap = 0;
+/* for -stats: since bounds_reset */
+static int checks_total = 0, checks_left_out = 0;
+
+/* internal helpers */
+bool bounds_proven(struct expr *e);
+bool bounds_range(struct expr *e, long *lo, long *hi);
+bool bounds_loop_var(struct expr *e, struct symbol *sym);
+bool bounds_writes_stmt(struct stmt *s, struct symbol *sym);
+bool bounds_writes_expr(struct expr *e, struct symbol *sym);
+
+void bounds_reset(){
+    stub_count = fact_count = 0;
+    checks_total = checks_left_out = 0;
+}
+
+void bounds_check(struct expr *e, int index){
+    struct expr *array = e->data->operator_args;
+    long length = type_array_length(array->type);
+    if( !codegen_opts.bounds_check || length < 0 ) return;
+
+    codegen_count(checks_total, 1);
+    if( codegen_opts.bounds_elim && bounds_proven(e) ){
+        codegen_count(checks_left_out, 1);
+        return;
+    }
+
+    if( stub_count == stub_cap ){
+        stub_cap = stub_cap ? 2 * stub_cap : 16;
+        stubs    = realloc(stubs, stub_cap * sizeof(*stubs));
+        if( !stubs ) diag_fatal("Could not allocate the bounds check stubs");
+    }
+    struct bounds_stub *stub = &stubs[stub_count++];
+    *stub = (struct bounds_stub) { label_create(), index, length, codegen_function_name() };
+
+    emit(OP_CMPQ, opnd_imm(length), opnd_reg(index));
+    emit1(OP_JAE, opnd_label(stub->label));
+}
+
+void bounds_stubs(){
+    /* the runtime exits: nothing returns here, and the scratch registers need not be saved */
+    for( int i = 0; i < stub_count; i++ ){
+        emit_label(stubs[i].label);
+        emit(OP_MOVQ, opnd_reg(stubs[i].index), opnd_reg(codegen_arg_reg(0)));
+        emit(OP_MOVQ, opnd_imm(stubs[i].length), opnd_reg(codegen_arg_reg(1)));
+        const char *name = codegen_string(stubs[i].function, strlen(stubs[i].function));
+        emit(OP_LEAQ, opnd_sym(name), opnd_reg(codegen_arg_reg(2)));
+        emit1(OP_CALL, opnd_label(RUNTIME_BOUNDS_ERROR));
+    }
+    // the function is done with: a worker thread generating it leaves nothing behind
+    free(stubs);
+    free(facts);
+    stubs = NULL;
+    facts = NULL;
+    stub_count = stub_cap = fact_count = fact_cap = 0;
+}
+
+bool bounds_loop_begin(struct stmt *s){
+    struct expr *init = s->expr_list, *cond = init->next, *step = cond->next;
+    if( init->kind != EXPR_ASGN || (step->kind != EXPR_POST_INC && step->kind != EXPR_POST_DEC) ) return false;
+    if( cond->kind != EXPR_LT && cond->kind != EXPR_LT_EQ && cond->kind != EXPR_GT && cond->kind != EXPR_GT_EQ ) return false;
+
+    struct expr *var = init->data->operator_args, *bound = cond->data->operator_args;
+    if( var->kind != EXPR_IDENT || var->symbol->kind == SYMBOL_GLOBAL || var->type->kind != TYPE_INTEGER ) return false;
+    struct symbol *sym = var->symbol;
+    if( !bounds_loop_var(step->data->operator_args, sym) || !bounds_loop_var(bound, sym) ) return false;
+    bound = bound->next;
+
+    // the initial value is taken once; the bound is compared with the variable on every iteration
+    long init_lo, init_hi, bound_lo, bound_hi, lo, hi;
+    if( !bounds_range(var->next, &init_lo, &init_hi) || !bounds_range(bound, &bound_lo, &bound_hi) ) return false;
+    if( step->kind == EXPR_POST_INC && (cond->kind == EXPR_LT || cond->kind == EXPR_LT_EQ) ){
+        lo = init_lo;
+        hi = cond->kind == EXPR_LT ? bound_hi - 1 : bound_hi;
+    }
+    else if( step->kind == EXPR_POST_DEC && (cond->kind == EXPR_GT || cond->kind == EXPR_GT_EQ) ){
+        lo = cond->kind == EXPR_GT ? bound_lo + 1 : bound_lo;
+        hi = init_hi;
+    }
+    else return false;
+    if( bounds_writes_expr(bound, sym) || bounds_writes_stmt(s->body, sym) ) return false;
+
+    if( fact_count == fact_cap ){
+        fact_cap = fact_cap ? 2 * fact_cap : 8;
+        facts    = realloc(facts, fact_cap * sizeof(*facts));
+        if( !facts ) diag_fatal("Could not allocate the ranges of loop variables");
+    }
+    facts[fact_count++] = (struct bounds_fact) { sym, lo, hi };
+    return true;
+}
+
+void bounds_loop_end(bool known){
+    if( known ) fact_count--;
+}
+
+void bounds_report(FILE *f){
+    fprintf(f, "Bounds checks: %d of %d proven unneeded and left out\n", checks_left_out, checks_total);
+}
+
+bool bounds_checked(struct expr *e){
+    struct expr *array = e->data->operator_args;
+    if( !codegen_opts.bounds_check || type_array_length(array->type) < 0 ) return false;
+    return !(codegen_opts.bounds_elim && bounds_proven(e));
+}
+
+bool bounds_proven(struct expr *e){
+    /* whether the index of array element 'e', of an array with a length, is known to be in bounds */
+    struct expr *array = e->data->operator_args;
+    long lo, hi;
+    return bounds_range(array->next, &lo, &hi) && lo >= 0 && hi < type_array_length(array->type);
+}
+
+bool bounds_range(struct expr *e, long *lo, long *hi){
+    /* whether the value of 'e' is known to lie in [lo, hi] */
+    long c, l1, h1, l2, h2;
+    if( expr_const_int(e, &c) ){
+        *lo = *hi = c;
+        return true;
+    }
+    switch(e->kind){
+        case EXPR_IDENT:
+            for( int i = fact_count - 1; i >= 0; i-- ){
+                if( facts[i].symbol != e->symbol ) continue;
+                *lo = facts[i].lo;
+                *hi = facts[i].hi;
+                return true;
+            }
+            return false;
+        case EXPR_ADD:
+        case EXPR_SUB:
+            if( !bounds_range(e->data->operator_args, &l1, &h1) || !bounds_range(e->data->operator_args->next, &l2, &h2) )
+                return false;
+            // the generated code wraps around where these would overflow
+            if( e->kind == EXPR_ADD )
+                return !__builtin_add_overflow(l1, l2, lo) && !__builtin_add_overflow(h1, h2, hi);
+            return !__builtin_sub_overflow(l1, h2, lo) && !__builtin_sub_overflow(h1, l2, hi);
+        case EXPR_MOD:
+            if( !expr_const_int(e->data->operator_args->next, &c) || c <= 0 ) return false;
+            if( !bounds_range(e->data->operator_args, &l1, &h1) || l1 < 0 ) return false;
+            *lo = 0;
+            *hi = h1 < c - 1 ? h1 : c - 1;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool bounds_loop_var(struct expr *e, struct symbol *sym){
+    return e->kind == EXPR_IDENT && e->symbol == sym;
+}
+
+bool bounds_writes_stmt(struct stmt *s, struct symbol *sym){
+    for( ; s; s = s->next ){
+        if( s->decl && bounds_writes_expr(s->decl->init_value, sym) )                return true;
+        if( bounds_writes_expr(s->expr_list, sym) || bounds_writes_stmt(s->body, sym) ) return true;
+    }
+    return false;
+}
+
+bool bounds_writes_expr(struct expr *e, struct symbol *sym){
+    for( ; e; e = e->next ){
+        switch(e->kind){
+            case EXPR_ASGN:
+            case EXPR_POST_INC:
+            case EXPR_POST_DEC:
+                if( bounds_loop_var(e->data->operator_args, sym) ) return true;
+                break;
+            case EXPR_EMPTY:
+            case EXPR_IDENT:
+            case EXPR_INT_LIT:
+            case EXPR_STR_LIT:
+            case EXPR_CHAR_LIT:
+            case EXPR_BOOL_LIT:
+                continue;
+            default:
+                break;
+        }
+        // calls and array literals keep their operands in the same place as operators
+        if( bounds_writes_expr(e->data->operator_args, sym) ) return true;
+    }
+    return false;
+}
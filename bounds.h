@@ -0,0 +1,37 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include "stmt.h"
+#include "expr.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Array bounds checks, applied during code generation. Indexing an array whose type has a length (its declaration's, or an
+   element's of an array of arrays) compares the index with it, unsigned so that negative indices fail too, and jumps to a
+   stub after the function's epilogue that calls the runtime's RUNTIME_BOUNDS_ERROR. Parameters declared array [] have no
+   length: indexing them is not checked.
+   A check is left out when range analysis proves the index in bounds. The ranges known are those of integer constants, and
+   of the variable of a for loop of the form
+       for( i = <init>; i < <bound>; i++ )     (or <=, and i-- with > and >=)
+   inside its body, when the variable is a local or parameter (nothing else assigns it) that neither the body nor the
+   condition assigns: from the least <init> to the greatest <bound> less one. Sums, differences, and remainders of
+   non-negative values by positive constants, of expressions with known ranges, have known ranges too. */
+
+/* forgets the counts of the last program */
+void bounds_reset();
+/* checks the index of array element 'e', generated into register 'index': unless codegen_opts.bounds_check is off, or
+   codegen_opts.bounds_elim is on and the index is proven in bounds */
+void bounds_check( struct expr *e, int index );
+/* whether bounds_check would check the index of array element 'e' here: code that may fail must not be moved to where
+   the element would not have been read */
+bool bounds_checked( struct expr *e );
+/* emits the stubs the checks of the function generated since the last call jump to */
+void bounds_stubs();
+/* the range of the variable of for statement 's', if it has one, is known in its body until bounds_loop_end: returns whether
+   it has one */
+bool bounds_loop_begin( struct stmt *s );
+void bounds_loop_end( bool known );
+/* prints how many checks were left out of how many since bounds_reset */
+void bounds_report( FILE *f );
+
+#endif
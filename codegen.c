@@ -0,0 +1,728 @@
+#define _GNU_SOURCE // vasprintf
+#include "codegen.h"
+#include "inline.h"
+#include "licm.h"
+#include "bounds.h"
+#include "profile.h"
+#include "peephole.h"
+#include "data.h"
+#include "hash_table.h"
+#include "stmt.h"
+#include "diag.h"
+#include "output.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+
+#define MAX_ARGS 6
+
+struct codegen_opts codegen_opts = { .strength_reduce = true, .inline_budget = DEFAULT_INLINE_BUDGET, .peephole = true, .licm = true,
+                                     .bounds_check = true, .bounds_elim = true, .jobs = 1 };
+
+static const char *opcode_mnemonics[OPCODE_COUNT] = {
+#define OPCODE_MNEMONIC(name, mnemonic, n) [name] = mnemonic,
+    OPCODE_TABLE(OPCODE_MNEMONIC)
+#undef OPCODE_MNEMONIC
+};
+static const int opcode_operands[OPCODE_COUNT] = {
+#define OPCODE_OPERANDS(name, mnemonic, n) [name] = n,
+    OPCODE_TABLE(OPCODE_OPERANDS)
+#undef OPCODE_OPERANDS
+};
+
+static const char *reg_names[REG_COUNT] = {
+    "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+    "%r8",  "%r9",  "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+};
+static const char *reg8_names[REG_COUNT] = {
+    "%al",  "%cl",  "%dl",  "%bl",  "%spl", "%bpl", "%sil", "%dil",
+    "%r8b", "%r9b", "%r10b", "%r11b", "%r12b", "%r13b", "%r14b", "%r15b"
+};
+
+/* %rax and %rdx are left out for division, the argument registers for calls */
+static const reg_t scratch_regs[] = { REG_RBX, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15 };
+#define SCRATCH_COUNT   (sizeof(scratch_regs) / sizeof(*scratch_regs))
+/* the scratch registers a callee may clobber: saved around calls while in use */
+static const reg_t caller_saved_scratch[] = { REG_R10, REG_R11 };
+/* the scratch registers a caller expects preserved: saved by every prologue */
+static const reg_t callee_saved_scratch[] = { REG_RBX, REG_R12, REG_R13, REG_R14, REG_R15 };
+#define CALLEE_SAVED_COUNT  (sizeof(callee_saved_scratch) / sizeof(*callee_saved_scratch))
+
+static const reg_t arg_regs[MAX_ARGS] = { REG_RDI, REG_RSI, REG_RDX, REG_RCX, REG_R8, REG_R9 };
+
+/* what codegen_program does with a function, generated by whichever thread: its own instructions, and its labels named only
+   once it is merged into the program, as the whole program would have numbered them */
+struct codegen_unit {
+    struct decl       *decl;
+    struct insn       *head, *tail;
+    // labels created and string literals first used while generating it, in that order
+    struct unit_label *labels, *labels_tail;
+    int                label_count;
+    // its string literals' labels, by escaped bytes
+    struct hash_table *strings;
+    struct unit_defer *defers, *defers_tail;
+    int                err_count;
+    // diagnostics a worker thread recorded while generating it: reported when it is merged
+    struct diag       *diags;
+};
+
+/* until its unit is merged, a label is named '.Lu<n>' after its place among the unit's (nothing else is named that way); then
+   it is named in place, a string literal's after its label in the pool */
+struct unit_label {
+    char        name[24];
+    // a string literal's, else NULL
+    const char *bytes;
+    int         len;
+    const char *text;
+    struct unit_label *next;
+};
+
+struct unit_defer {
+    void (*fn)(void *arg);
+    void *arg;
+    struct unit_defer *next;
+};
+
+/* a thread generating units, the next of which to generate is shared */
+struct codegen_worker {
+    pthread_t            thread;
+    struct codegen_unit *units;
+    int                  count;
+    int                 *next;
+    // its arena chunks, for the merging thread to keep
+    void                *chunks;
+};
+
+/* the instructions being appended to: the program's, or while a function is generated on this thread, its unit's */
+static __thread struct insn *insn_head = NULL, *insn_tail = NULL;
+static __thread bool         scratch_in_use[REG_COUNT];
+static __thread struct codegen_unit *unit = NULL;
+static int          label_count = 0;
+static int          err_count   = 0;
+
+/* string literals, pooled: emitted into .rodata after the code, each distinct string once */
+struct string_entry {
+    const char *label;
+    const char *bytes;
+    int         len;
+    // bytes as the assembler takes them in a .string directive: also the key of the pool
+    const char *text;
+    // set when the string is the tail of a longer one: it is emitted as a label 'offset' bytes into 'host'
+    struct string_entry *host;
+    int         offset;
+    struct string_entry *next;
+};
+static struct string_entry *strings = NULL, *strings_tail = NULL;
+static struct hash_table   *string_pool = NULL;
+// for -stats: literals asked for, and the bytes (terminating nuls included) they would take unpooled and take pooled
+static int  string_uses = 0;
+static long string_bytes = 0, string_bytes_pooled = 0;
+
+/* function being generated (on this thread) */
+static __thread const char *function_name = NULL;
+static __thread const char *return_label  = NULL;
+// bottom of its frame in use, and the lowest it has been: inlined bodies take slots below the function's own while generated
+static __thread int         frame_bottom = 0, frame_max = 0;
+// scratch registers it has used: the prologue saves only the callee-saved ones among them
+static __thread bool        scratch_used[REG_COUNT];
+// for -stats: bytes of locals and parameters, the frame bytes they were laid out in, and callee-saved registers saved
+static long         slot_bytes = 0, frame_bytes = 0;
+static int          saves_kept = 0, saves_total = 0;
+
+/* internal helpers */
+void codegen_reset();
+void codegen_workers(struct codegen_unit *units, int count);
+void *codegen_worker(void *arg);
+void codegen_unit(struct codegen_unit *u);
+void codegen_unit_merge(struct codegen_unit *u);
+struct unit_label *unit_label_create();
+void codegen_function(struct decl *d);
+int  frame_layout_stmt(struct stmt *s, int offset);
+const char *string_pool_label(const char *bytes, int len, const char *text);
+void codegen_strings();
+void codegen_strings_share_tails();
+int  string_tail_cmp(const void *a, const void *b);
+char *string_escape(const char *bytes, int len);
+void operand_print(struct operand *o);
+struct insn *insn_append(struct insn *i);
+
+int codegen_program(struct decl *ast){
+    codegen_reset();
+    inline_plan(ast);
+    licm_plan(ast);
+    profile_plan(ast);
+    data_plan(ast);
+
+    int count = 0;
+    for( struct decl *d = ast; d; d = d->next ) count += d->func_body != NULL;
+    struct codegen_unit *units = calloc(count ? count : 1, sizeof(*units));
+    if( !units ) diag_fatal("Could not allocate %d functions to generate", count);
+    count = 0;
+    for( struct decl *d = ast; d; d = d->next )
+        if( d->func_body ) units[count++].decl = d;
+    bool parallel = codegen_opts.jobs > 1 && count > 1;
+    if( parallel ) codegen_workers(units, count);
+
+    count = 0;
+    for( struct decl *d = ast; d; d = d->next ){
+        if( d->func_body ){
+            // with one job, each function is generated right where it is merged
+            if( !parallel ) codegen_unit(&units[count]);
+            codegen_unit_merge(&units[count++]);
+        }
+        else if( d->type->kind != TYPE_FUNCTION )   data_global(d);
+    }
+    free(units);
+    data_templates();
+    profile_table();
+    codegen_strings();
+    // no executable stack
+    emit_directive(".section .note.GNU-stack,\"\",@progbits");
+
+    if( !err_count )
+        for( struct insn *i = insn_head; i; i = i->next ) insn_print(i);
+    return err_count;
+}
+
+void codegen_reset(){
+    insn_head = insn_tail = NULL;
+    memset(scratch_in_use, 0, sizeof(scratch_in_use));
+    label_count = 0;
+    err_count = 0;
+    strings = strings_tail = NULL;
+    if( !string_pool && !(string_pool = hash_table_create(0, 0)) ) diag_fatal("Could not allocate the string pool");
+    hash_table_clear(string_pool);
+    string_uses = 0;
+    string_bytes = string_bytes_pooled = 0;
+    function_name = return_label = NULL;
+    frame_bottom = frame_max = 0;
+    slot_bytes = frame_bytes = 0;
+    saves_kept = saves_total = 0;
+    peephole_reset();
+    bounds_reset();
+}
+
+void codegen_stats(FILE *f){
+    peephole_report(f);
+    licm_report(f);
+    bounds_report(f);
+    fprintf(f, "Strings: %d literals, %ld bytes pooled into %ld: %ld bytes saved\n",
+            string_uses, string_bytes, string_bytes_pooled, string_bytes - string_bytes_pooled);
+    fprintf(f, "Frames: %ld bytes of locals and parameters in %ld bytes of slots, %d of %d callee-saved registers saved\n",
+            slot_bytes, frame_bytes, saves_kept, saves_total);
+}
+
+void codegen_workers(struct codegen_unit *units, int count){
+    int jobs = codegen_opts.jobs < count ? codegen_opts.jobs : count, next = 0;
+    struct codegen_worker *workers = calloc(jobs, sizeof(*workers));
+    if( !workers ) diag_fatal("Could not allocate %d code generation threads", jobs);
+    for( int i = 0; i < jobs; i++ ){
+        workers[i] = (struct codegen_worker) { .units = units, .count = count, .next = &next };
+        if( pthread_create(&workers[i].thread, NULL, codegen_worker, &workers[i]) )
+            diag_fatal("Could not start code generation thread %d of %d", i + 1, jobs);
+    }
+    for( int i = 0; i < jobs; i++ ){
+        pthread_join(workers[i].thread, NULL);
+        arena_attach(workers[i].chunks);
+    }
+    free(workers);
+}
+
+void *codegen_worker(void *arg){
+    /* takes the units in declaration order, as many at once as there are workers */
+    struct codegen_worker *w = arg;
+    diag_set_echo(false);
+    for( int n; (n = __atomic_fetch_add(w->next, 1, __ATOMIC_RELAXED)) < w->count; ){
+        codegen_unit(&w->units[n]);
+        w->units[n].diags = diag_take();
+    }
+    w->chunks = arena_detach();
+    return NULL;
+}
+
+void codegen_unit(struct codegen_unit *u){
+    // on the merging thread, the program's instructions are put aside meanwhile
+    struct insn *head = insn_head, *tail = insn_tail;
+    insn_head = insn_tail = NULL;
+    unit = u;
+    codegen_function(u->decl);
+    if( codegen_opts.peephole ) peephole_run();
+    unit = NULL;
+    u->head = insn_head;
+    u->tail = insn_tail;
+    insn_head = head;
+    insn_tail = tail;
+}
+
+void codegen_unit_merge(struct codegen_unit *u){
+    for( struct unit_label *l = u->labels; l; l = l->next ){
+        if( l->text ) snprintf(l->name, sizeof(l->name), "%s", string_pool_label(l->bytes, l->len, l->text));
+        else          snprintf(l->name, sizeof(l->name), ".L%d", label_count++);
+    }
+    if( u->strings ) hash_table_delete(u->strings);
+    for( struct unit_defer *f = u->defers; f; f = f->next ) f->fn(f->arg);
+    for( struct diag *d = u->diags; d; d = d->next ) diag_report(d->kind, d->line, "%s", d->msg);
+    diag_delete(u->diags);
+    err_count += u->err_count;
+
+    if( !u->head ) return;
+    u->head->prev = insn_tail;
+    if( insn_tail ) insn_tail->next = u->head;
+    else            insn_head = u->head;
+    insn_tail = u->tail;
+}
+
+void codegen_defer(void (*fn)(void *arg), void *arg){
+    if( !unit ){
+        fn(arg);
+        return;
+    }
+    struct unit_defer *f = arena_alloc(sizeof(*f));
+    f->fn   = fn;
+    f->arg  = arg;
+    f->next = NULL;
+    if( unit->defers_tail ) unit->defers_tail->next = f;
+    else                    unit->defers = f;
+    unit->defers_tail = f;
+}
+
+void codegen_function(struct decl *d){
+    /* frame, from %rbp down: parameters, locals, then the callee-saved scratch registers the body uses, pushed by the prologue */
+    int offset = 0, nparams = 0;
+    inline_lock(d);
+    for( struct decl *p = d->type->params; p; p = p->next, nparams++ ){
+        offset += 8;
+        p->symbol->frame_offset = -offset;
+    }
+    if( nparams > MAX_ARGS ){
+        diag_report(DIAG_CODEGEN, 0, "Function %s takes %d parameters: at most %d are supported", d->ident, nparams, MAX_ARGS);
+        unit->err_count++;
+        inline_unlock(d);
+        return;
+    }
+    codegen_count(slot_bytes, offset);
+    frame_bottom = frame_max = frame_layout_stmt(d->func_body, offset);
+    function_name = d->ident;
+    return_label  = label_create();
+    memset(scratch_used, 0, sizeof(scratch_used));
+
+    /* the frame size and the saved registers are only known once the body is generated: the prologue and epilogue
+       are emitted in full, then trimmed */
+    emit_directive(".text");
+    emit_directive(".globl %s", d->ident);
+    emit_label(d->ident);
+    emit1(OP_PUSHQ, opnd_reg(REG_RBP));
+    emit(OP_MOVQ, opnd_reg(REG_RSP), opnd_reg(REG_RBP));
+    struct insn *frame_alloc_insn = emit(OP_SUBQ, opnd_imm(0), opnd_reg(REG_RSP));
+    struct insn *pushes[CALLEE_SAVED_COUNT], *pops[CALLEE_SAVED_COUNT];
+    for( size_t i = 0; i < CALLEE_SAVED_COUNT; i++ )
+        pushes[i] = emit1(OP_PUSHQ, opnd_reg(callee_saved_scratch[i]));
+    int i = 0;
+    for( struct decl *p = d->type->params; p; p = p->next, i++ )
+        emit(OP_MOVQ, opnd_reg(arg_regs[i]), opnd_mem(REG_RBP, p->symbol->frame_offset));
+    profile_function_begin(d);
+
+    stmt_codegen(d->func_body);
+
+    // falling off the end returns 0 (main's exit status)
+    emit(OP_MOVQ, opnd_imm(0), opnd_reg(REG_RAX));
+    emit_label(return_label);
+    profile_function_end(d);
+    for( int i = CALLEE_SAVED_COUNT - 1; i >= 0; i-- )
+        pops[i] = emit1(OP_POPQ, opnd_reg(callee_saved_scratch[i]));
+    emit(OP_MOVQ, opnd_reg(REG_RBP), opnd_reg(REG_RSP));
+    emit1(OP_POPQ, opnd_reg(REG_RBP));
+    emit0(OP_RET);
+    bounds_stubs();
+
+    int saved = 0;
+    for( size_t i = 0; i < CALLEE_SAVED_COUNT; i++ ){
+        if( scratch_used[callee_saved_scratch[i]] ){
+            saved++;
+            continue;
+        }
+        insn_remove(pushes[i]);
+        insn_remove(pops[i]);
+    }
+    // %rsp is 16-byte aligned after pushing %rbp: the frame plus the saved registers must keep it so
+    int frame_size = (frame_max + 8 * saved + 15) / 16 * 16 - 8 * saved;
+    if( frame_size ) frame_alloc_insn->opnd[0].val = frame_size;
+    else             insn_remove(frame_alloc_insn);
+
+    codegen_count(frame_bytes, frame_max);
+    codegen_count(saves_kept, saved);
+    codegen_count(saves_total, CALLEE_SAVED_COUNT);
+    inline_unlock(d);
+}
+
+int frame_layout_stmt(struct stmt *s, int offset){
+    /* locals get slots below 'offset' in the order they are declared. A nested block's locals are gone once the block ends,
+       so its slots are free again: sibling blocks (and the branches of an if) share theirs. Returns the lowest bottom reached. */
+    int bottom = offset;
+    for( ; s; s = s->next ){
+        if( s->kind == STMT_DECL ){
+            int size = type_size(s->decl->type);
+            offset += size;
+            codegen_count(slot_bytes, size);
+            s->decl->symbol->frame_offset = -offset;
+            if( offset > bottom ) bottom = offset;
+        }
+        // an if's else branch hangs off its then branch's next, so it is reached through the body too
+        int inner = frame_layout_stmt(s->body, offset);
+        if( inner > bottom ) bottom = inner;
+    }
+    return bottom;
+}
+
+int frame_alloc(int size){
+    frame_bottom += size;
+    codegen_count(slot_bytes, size);
+    if( frame_bottom > frame_max ) frame_max = frame_bottom;
+    return -frame_bottom;
+}
+
+void frame_alloc_locals(struct stmt *s){
+    frame_bottom = frame_layout_stmt(s, frame_bottom);
+    if( frame_bottom > frame_max ) frame_max = frame_bottom;
+}
+
+int  frame_mark(){ return frame_bottom; }
+void frame_release(int mark){ frame_bottom = mark; }
+
+const char *codegen_function_name(){ return function_name; }
+const char *codegen_return_label(){ return return_label; }
+
+const char *codegen_set_return_label(const char *label){
+    const char *prev = return_label;
+    return_label = label;
+    return prev;
+}
+
+/* operands ============================================================== */
+
+struct operand opnd_reg(reg_t r){
+    return (struct operand) { .kind = OPND_REG, .reg = r, .index = REG_NONE };
+}
+
+struct operand opnd_reg8(reg_t r){
+    return (struct operand) { .kind = OPND_REG8, .reg = r, .index = REG_NONE };
+}
+
+struct operand opnd_imm(long val){
+    return (struct operand) { .kind = OPND_IMM, .reg = REG_NONE, .index = REG_NONE, .val = val };
+}
+
+struct operand opnd_mem(reg_t base, long disp){
+    return (struct operand) { .kind = OPND_MEM, .reg = base, .index = REG_NONE, .val = disp };
+}
+
+struct operand opnd_mem_index(reg_t base, reg_t index, int scale, long disp){
+    return (struct operand) { .kind = OPND_MEM, .reg = base, .index = index, .scale = scale, .val = disp };
+}
+
+struct operand opnd_sym(const char *label){
+    return (struct operand) { .kind = OPND_MEM, .reg = REG_NONE, .index = REG_NONE, .label = label };
+}
+
+struct operand opnd_label(const char *label){
+    return (struct operand) { .kind = OPND_LABEL, .reg = REG_NONE, .index = REG_NONE, .label = label };
+}
+
+/* instruction list ====================================================== */
+
+struct insn *insn_append(struct insn *i){
+    i->next = NULL;
+    i->prev = insn_tail;
+    if( insn_tail ) insn_tail->next = i;
+    else            insn_head = i;
+    insn_tail = i;
+    return i;
+}
+
+struct insn *emit(opcode_t op, struct operand a, struct operand b){
+    struct insn *i = arena_alloc(sizeof(*i));
+    i->kind    = INSN_OP;
+    i->op      = op;
+    i->opnd[0] = a;
+    i->opnd[1] = b;
+    i->text    = NULL;
+    return insn_append(i);
+}
+
+struct insn *emit1(opcode_t op, struct operand a){
+    return emit(op, a, (struct operand) { .kind = OPND_NONE });
+}
+
+struct insn *emit0(opcode_t op){
+    return emit(op, (struct operand) { .kind = OPND_NONE }, (struct operand) { .kind = OPND_NONE });
+}
+
+struct insn *emit_label(const char *label){
+    struct insn *i = emit0(OP_RET);
+    i->kind = INSN_LABEL;
+    i->text = label;
+    return i;
+}
+
+struct insn *emit_directive(const char *fmt, ...){
+    char *text = NULL;
+    va_list args;
+    va_start(args, fmt);
+    if( vasprintf(&text, fmt, args) < 0 ) diag_fatal("Could not format directive %s", fmt);
+    va_end(args);
+
+    struct insn *i = emit0(OP_RET);
+    i->kind = INSN_DIRECTIVE;
+    i->text = arena_strdup(text);
+    free(text);
+    return i;
+}
+
+void insn_remove(struct insn *i){
+    if( i->prev ) i->prev->next = i->next;
+    else          insn_head = i->next;
+    if( i->next ) i->next->prev = i->prev;
+    else          insn_tail = i->prev;
+}
+
+struct insn *codegen_insns(){ return insn_head; }
+
+void insn_print(struct insn *i){
+    switch(i->kind){
+        case INSN_LABEL:
+            fprintf(out_stream, "%s:\n", i->text);
+            break;
+        case INSN_DIRECTIVE:
+            fprintf(out_stream, "\t%s\n", i->text);
+            break;
+        case INSN_OP:
+            fprintf(out_stream, "\t%s", opcode_mnemonics[i->op]);
+            for( int n = 0; n < opcode_operands[i->op]; n++ ){
+                fputs(n ? ", " : "\t", out_stream);
+                operand_print(&i->opnd[n]);
+            }
+            fputs("\n", out_stream);
+            break;
+    }
+}
+
+void operand_print(struct operand *o){
+    switch(o->kind){
+        case OPND_REG:
+            fputs(reg_names[o->reg], out_stream);
+            break;
+        case OPND_REG8:
+            fputs(reg8_names[o->reg], out_stream);
+            break;
+        case OPND_IMM:
+            fprintf(out_stream, "$%ld", o->val);
+            break;
+        case OPND_LABEL:
+            fputs(o->label, out_stream);
+            break;
+        case OPND_MEM:
+            if( o->label ){
+                fputs(o->label, out_stream);
+                if( o->val ) fprintf(out_stream, "%+ld", o->val);
+                fputs("(%rip)", out_stream);
+                break;
+            }
+            if( o->val ) fprintf(out_stream, "%ld", o->val);
+            fprintf(out_stream, "(%s", reg_names[o->reg]);
+            if( o->index != REG_NONE ) fprintf(out_stream, ",%s,%d", reg_names[o->index], o->scale);
+            fputs(")", out_stream);
+            break;
+        default:
+            break;
+    }
+}
+
+/* registers and labels ================================================== */
+
+reg_t scratch_alloc(){
+    for( size_t i = 0; i < SCRATCH_COUNT; i++ ){
+        if( !scratch_in_use[scratch_regs[i]] ){
+            scratch_in_use[scratch_regs[i]] = true;
+            scratch_used[scratch_regs[i]] = true;
+            return scratch_regs[i];
+        }
+    }
+    // held values are spilled before the reserve runs out, so this is a bug: a register is handed out anyway so instruction
+    // selection can finish, and the error, reported once a function, keeps the output from being printed
+    if( !unit->err_count++ )
+        diag_report(DIAG_INTERNAL, 0, "Ran out of scratch registers in %s", function_name);
+    return scratch_regs[0];
+}
+
+void scratch_claim(reg_t r){
+    scratch_in_use[r] = scratch_used[r] = true;
+}
+
+void scratch_free(reg_t r){
+    if( r != REG_NONE ) scratch_in_use[r] = false;
+}
+
+int scratch_spill(reg_t r){
+    int slot = frame_alloc(8);
+    emit(OP_MOVQ, opnd_reg(r), opnd_mem(REG_RBP, slot));
+    scratch_free(r);
+    return slot;
+}
+
+reg_t scratch_reload(int slot){
+    reg_t r = scratch_alloc();
+    emit(OP_MOVQ, opnd_mem(REG_RBP, slot), opnd_reg(r));
+    // the slot is the last one reserved: see scratch_spill
+    frame_release(-slot - 8);
+    return r;
+}
+
+int scratch_available(){
+    int n = 0;
+    for( size_t i = 0; i < SCRATCH_COUNT; i++ ) n += !scratch_in_use[scratch_regs[i]];
+    return n;
+}
+
+const char *label_create(){
+    if( unit ) return unit_label_create()->name;
+    char name[32];
+    snprintf(name, sizeof(name), ".L%d", label_count++);
+    return arena_strdup(name);
+}
+
+struct unit_label *unit_label_create(){
+    struct unit_label *l = arena_alloc(sizeof(*l));
+    snprintf(l->name, sizeof(l->name), ".Lu%d", unit->label_count++);
+    l->bytes = l->text = NULL;
+    l->len   = 0;
+    l->next  = NULL;
+    if( unit->labels_tail ) unit->labels_tail->next = l;
+    else                    unit->labels = l;
+    unit->labels_tail = l;
+    return l;
+}
+
+reg_t codegen_arg_reg(int i){
+    if( i < MAX_ARGS ) return arg_regs[i];
+    if( !unit->err_count++ ) diag_report(DIAG_CODEGEN, 0, "Function calls take at most %d arguments, in %s", MAX_ARGS, function_name);
+    return arg_regs[MAX_ARGS - 1];
+}
+
+void codegen_call(const char *callee){
+    int saved = 0;
+    for( size_t i = 0; i < sizeof(caller_saved_scratch) / sizeof(*caller_saved_scratch); i++ ){
+        if( scratch_in_use[caller_saved_scratch[i]] ){
+            emit1(OP_PUSHQ, opnd_reg(caller_saved_scratch[i]));
+            saved++;
+        }
+    }
+    if( saved % 2 ) emit(OP_SUBQ, opnd_imm(8), opnd_reg(REG_RSP));
+    // variadic callees (printf) read the number of vector registers used from %al
+    emit(OP_MOVQ, opnd_imm(0), opnd_reg(REG_RAX));
+    emit1(OP_CALL, opnd_label(callee));
+    if( saved % 2 ) emit(OP_ADDQ, opnd_imm(8), opnd_reg(REG_RSP));
+    for( int i = sizeof(caller_saved_scratch) / sizeof(*caller_saved_scratch) - 1; i >= 0; i-- )
+        if( scratch_in_use[caller_saved_scratch[i]] )
+            emit1(OP_POPQ, opnd_reg(caller_saved_scratch[i]));
+}
+
+/* string literals ======================================================= */
+
+const char *codegen_string(const char *bytes, int len){
+    codegen_count(string_uses, 1);
+    codegen_count(string_bytes, len + 1);
+    char *text = string_escape(bytes, len);
+    if( !unit ) return string_pool_label(bytes, len, text);
+
+    // pooled into the program's when the unit is merged
+    if( !unit->strings && !(unit->strings = hash_table_create(0, 0)) ) diag_fatal("Could not allocate a function's strings");
+    struct unit_label *l = hash_table_lookup(unit->strings, text);
+    if( l ) return l->name;
+    l = unit_label_create();
+    l->bytes = bytes;
+    l->len   = len;
+    l->text  = text;
+    hash_table_insert(unit->strings, text, l);
+    return l->name;
+}
+
+const char *string_pool_label(const char *bytes, int len, const char *text){
+    struct string_entry *s = hash_table_lookup(string_pool, text);
+    if( s ) return s->label;
+
+    s = arena_alloc(sizeof(*s));
+    char name[32];
+    snprintf(name, sizeof(name), ".LS%d", label_count++);
+    s->label  = arena_strdup(name);
+    s->bytes  = bytes;
+    s->len    = len;
+    s->text   = text;
+    s->host   = NULL;
+    s->offset = 0;
+    s->next   = NULL;
+    if( strings_tail ) strings_tail->next = s;
+    else               strings = s;
+    strings_tail = s;
+    hash_table_insert(string_pool, text, s);
+    return s->label;
+}
+
+void codegen_strings(){
+    if( !strings ) return;
+    codegen_strings_share_tails();
+    emit_directive(".section .rodata");
+    for( struct string_entry *s = strings; s; s = s->next ){
+        if( s->host ) continue;
+        emit_label(s->label);
+        emit_directive(".string \"%s\"", s->text);
+        string_bytes_pooled += s->len + 1;
+    }
+    // tails of other strings, in the same section as their hosts
+    for( struct string_entry *s = strings; s; s = s->next )
+        if( s->host ) emit_directive(".set %s, %s+%d", s->label, s->host->label, s->offset);
+}
+
+void codegen_strings_share_tails(){
+    /* sorted by their bytes read backwards, the strings a string ends with come right before it:
+       walking back from the end, each string that is the tail of its successor lives inside that one's host */
+    int n = 0;
+    for( struct string_entry *s = strings; s; s = s->next ) n++;
+    struct string_entry **sorted = malloc(n * sizeof(*sorted));
+    if( !sorted ) diag_fatal("Could not allocate %d strings to pool", n);
+    n = 0;
+    for( struct string_entry *s = strings; s; s = s->next ) sorted[n++] = s;
+    qsort(sorted, n, sizeof(*sorted), string_tail_cmp);
+
+    for( int i = n - 2; i >= 0; i-- ){
+        struct string_entry *s = sorted[i], *longer = sorted[i + 1];
+        if( s->len > longer->len || memcmp(s->bytes, longer->bytes + longer->len - s->len, s->len) ) continue;
+        struct string_entry *host = longer->host ? longer->host : longer;
+        s->host   = host;
+        s->offset = host->len - s->len;
+    }
+    free(sorted);
+}
+
+int string_tail_cmp(const void *a, const void *b){
+    const struct string_entry *x = *(struct string_entry * const *) a, *y = *(struct string_entry * const *) b;
+    for( int i = 1; i <= x->len && i <= y->len; i++ ){
+        unsigned char cx = x->bytes[x->len - i], cy = y->bytes[y->len - i];
+        if( cx != cy ) return cx - cy;
+    }
+    return x->len - y->len;
+}
+
+char *string_escape(const char *bytes, int len){
+    /* octal escapes for anything the assembler would not take literally (.string adds the terminating nul) */
+    char *text = arena_alloc(4 * len + 1), *w = text;
+    for( int i = 0; i < len; i++ ){
+        unsigned char c = bytes[i];
+        if( c == '"' || c == '\\' || c < ' ' || c > '~' ) w += sprintf(w, "\\%03o", c);
+        else *w++ = c;
+    }
+    *w = '\0';
+    return text;
+}
@@ -0,0 +1,200 @@
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include "decl.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/* x86-64 code generation. The expr/stmt/decl _codegen functions do instruction selection into an instruction list (struct insn),
+   which optimizations can rewrite before codegen_program prints it as GNU assembler (AT&T syntax).
+   Every value (integer, char, boolean, string and array pointer) is a quadword; arrays are stored in place. */
+
+/* registers, in hardware encoding order */
+typedef enum {
+    REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+    REG_R8,  REG_R9,  REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+    REG_COUNT,
+    REG_NONE = -1
+} reg_t;
+
+/* Opcode table: each row expands into an opcode_t enumerator and its mnemonic.
+ *      name            mnemonic        operands    */
+#define OPCODE_TABLE(X) \
+    X(OP_MOVQ,          "movq",         2) \
+    X(OP_MOVZBQ,        "movzbq",       2) \
+    X(OP_LEAQ,          "leaq",         2) \
+    X(OP_ADDQ,          "addq",         2) \
+    X(OP_SUBQ,          "subq",         2) \
+    X(OP_IMULQ,         "imulq",        2) \
+    X(OP_IDIVQ,         "idivq",        1) \
+    X(OP_CQO,           "cqo",          0) \
+    X(OP_CLTQ,          "cltq",         0) \
+    X(OP_NEGQ,          "negq",         1) \
+    X(OP_SALQ,          "salq",         2) \
+    X(OP_SARQ,          "sarq",         2) \
+    X(OP_SHRQ,          "shrq",         2) \
+    X(OP_ANDQ,          "andq",         2) \
+    X(OP_XORQ,          "xorq",         2) \
+    X(OP_CMPQ,          "cmpq",         2) \
+    X(OP_TESTQ,         "testq",        2) \
+    X(OP_SETE,          "sete",         1) \
+    X(OP_SETNE,         "setne",        1) \
+    X(OP_SETL,          "setl",         1) \
+    X(OP_SETLE,         "setle",        1) \
+    X(OP_SETG,          "setg",         1) \
+    X(OP_SETGE,         "setge",        1) \
+    X(OP_JMP,           "jmp",          1) \
+    X(OP_JE,            "je",           1) \
+    X(OP_JNE,           "jne",          1) \
+    X(OP_JLE,           "jle",          1) \
+    X(OP_JAE,           "jae",          1) \
+    X(OP_PUSHQ,         "pushq",        1) \
+    X(OP_POPQ,          "popq",         1) \
+    X(OP_CALL,          "call",         1) \
+    X(OP_RDTSC,         "rdtsc",        0) \
+    X(OP_RET,           "ret",          0) \
+    X(OP_REP_STOSQ,     "rep stosq",    0) \
+    X(OP_REP_MOVSQ,     "rep movsq",    0)
+
+typedef enum {
+#define OPCODE_ENUM(name, mnemonic, n) name,
+    OPCODE_TABLE(OPCODE_ENUM)
+#undef OPCODE_ENUM
+    OPCODE_COUNT
+} opcode_t;
+
+typedef enum {
+    OPND_NONE,
+    OPND_REG,       // reg
+    OPND_REG8,      // low byte of reg (setcc, movzbq)
+    OPND_IMM,       // $val
+    OPND_MEM,       // val(reg,index,scale), or label+val(%rip) when label is set
+    OPND_LABEL      // jump or call target
+} opnd_t;
+
+struct operand {
+    opnd_t      kind;
+    reg_t       reg;
+    reg_t       index;
+    int         scale;
+    long        val;
+    const char *label;
+};
+
+typedef enum {
+    INSN_OP,
+    INSN_LABEL,     // text is the label name
+    INSN_DIRECTIVE  // text is printed on its own line, indented
+} insn_t;
+
+struct insn {
+    insn_t          kind;
+    opcode_t        op;
+    // AT&T order: source first
+    struct operand  opnd[2];
+    const char     *text;
+    struct insn    *prev;
+    struct insn    *next;
+};
+
+#define DEFAULT_INLINE_BUDGET   40
+
+struct codegen_opts {
+    // rewrite ^, *, / and % by constants into cheaper sequences (see strength.h)
+    bool strength_reduce;
+    // largest function body, in AST nodes, generated in place of a call (see inline.h): 0 disables inlining
+    int  inline_budget;
+    // rewrite the instruction list with the rules in peephole.h
+    bool peephole;
+    // compute the invariant expressions of for loops once, before the loop (see licm.h)
+    bool licm;
+    // check array indices against the arrays' lengths (see bounds.h)
+    bool bounds_check;
+    // leave out the checks of indices range analysis proves in bounds
+    bool bounds_elim;
+    // count calls and loop iterations into a table the runtime saves at exit (see profile.h)
+    bool profile;
+    // under profile, also time the calls with the time stamp counter
+    bool profile_cycles;
+    // threads generating functions at once: the output is the same for any number
+    int  jobs;
+};
+extern struct codegen_opts codegen_opts;
+
+/* generates code for the (resolved and typechecked) program 'ast' and prints it to out_stream: returns the number of errors.
+   Each function is generated, and peephole optimized, into an instruction list of its own, then merged into the program in
+   declaration order, where its labels are numbered: with codegen_opts.jobs above 1, that many threads generate functions at
+   once, and the assembly is the same as with one. What is kept about the function being generated is per thread, totals
+   for codegen_stats are added with codegen_count, and what must be in program order is left to codegen_defer. */
+int codegen_program( struct decl *ast );
+/* prints what the optimizations of the last codegen_program did */
+void codegen_stats( FILE *f );
+/* adds 'n' to 'counter', a total of the program's for codegen_stats, from whichever thread */
+#define codegen_count( counter, n )     __atomic_add_fetch(&(counter), (n), __ATOMIC_RELAXED)
+/* has fn(arg) called when the function being generated is merged into the program: in declaration order with the other
+   functions, and on the thread that called codegen_program (at once when no function is being generated) */
+void codegen_defer( void (*fn)( void *arg ), void *arg );
+
+/* operands */
+struct operand opnd_reg( reg_t r );
+struct operand opnd_reg8( reg_t r );
+struct operand opnd_imm( long val );
+struct operand opnd_mem( reg_t base, long disp );
+struct operand opnd_mem_index( reg_t base, reg_t index, int scale, long disp );
+struct operand opnd_sym( const char *label );
+struct operand opnd_label( const char *label );
+
+/* instruction list: appended to by the emitters, in program order (while a function is generated, the function's own) */
+struct insn *emit( opcode_t op, struct operand a, struct operand b );
+struct insn *emit1( opcode_t op, struct operand a );
+struct insn *emit0( opcode_t op );
+struct insn *emit_label( const char *label );
+struct insn *emit_directive( const char *fmt, ... );
+void         insn_remove( struct insn *i );
+struct insn *codegen_insns();
+void         insn_print( struct insn *i );
+
+/* scratch registers hold intermediate values: one held while more code is generated is spilled to the frame when that code
+   needs its register, so that no program runs out of them */
+reg_t scratch_alloc();
+/* marks 'r', which is not in use, as in use */
+void  scratch_claim( reg_t r );
+void  scratch_free( reg_t r );
+/* number of scratch registers not in use */
+int   scratch_available();
+/* scratch registers generating any one expression takes beyond those of its operands' values: with this many free, a held
+   value only needs spilling if the expression generated next needs more */
+#define SCRATCH_RESERVE 3
+/* stores 'r' in a new frame slot and frees it: returns the slot */
+int   scratch_spill( reg_t r );
+/* loads the value scratch_spill stored in 'slot' into a scratch register, which is returned, and frees the slot: slots are
+   reloaded in the reverse of the order they were spilled in */
+reg_t scratch_reload( int slot );
+
+/* labels local to the assembly file: those of a function are only named for good once it is merged into the program, the
+   text they point to rewritten in place */
+const char *label_create();
+/* label of a string literal's bytes in .rodata: pooled, so equal strings share a label and a string ending another points into it */
+const char *codegen_string( const char *bytes, int len );
+
+/* calls 'callee' with the arguments already in the argument registers: saves live caller-saved scratch registers and keeps %rsp aligned */
+void codegen_call( const char *callee );
+/* register holding argument 'i' */
+reg_t codegen_arg_reg( int i );
+/* label the current function's epilogue starts at: the target of return statements */
+const char *codegen_return_label();
+/* makes 'label' the target of return statements: returns the previous target */
+const char *codegen_set_return_label( const char *label );
+/* name of the function being generated */
+const char *codegen_function_name();
+
+/* reserves 'size' bytes in the current function's frame: returns their %rbp-relative offset */
+int  frame_alloc( int size );
+/* gives the locals declared in 's' slots in the current function's frame, below those in use */
+struct stmt;
+void frame_alloc_locals( struct stmt *s );
+/* frame_release(frame_mark()) frees the slots reserved in between, for reuse by what is generated next */
+int  frame_mark();
+void frame_release( int mark );
+
+#endif
@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# good programs are compiled both with and without optimizations, assembled and linked with the runtime, run, and must print
+# exactly ${testfile}.expected; where ${testfile}.checks exists, the optimized compile must leave out the checks it says
+# bad programs index out of bounds: they must compile, and then fail at run time with the runtime's report
+for testfile in good*.bminor; do
+    result="success (as expected)"
+    for opt in "" "-O0"; do
+        if ! ./bminor $opt -stats -codegen $testfile ${testfile}.s > ${testfile}.out; then
+            result="compile failure $opt (INCORRECT)"
+        elif [ -z "$opt" ] && [ -f ${testfile}.checks ] && ! grep -qxF -f ${testfile}.checks ${testfile}.out; then
+            result="wrong checks left out (INCORRECT)"
+        elif ! gcc -o ${testfile}.exe ${testfile}.s runtime.o >> ${testfile}.out 2>&1; then
+            result="assembly failure $opt (INCORRECT)"
+        elif ! diff <(./${testfile}.exe) ${testfile}.expected > ${testfile}.out; then
+            result="wrong output $opt (INCORRECT)"
+        fi
+        [ "$result" = "success (as expected)" ] || break
+    done
+    rm -f ${testfile}.s ${testfile}.exe
+    echo "$testfile $result"
+done
+
+for testfile in bad*.bminor; do
+    result="failure (as expected)"
+    for opt in "" "-O0"; do
+        if ! ./bminor $opt -codegen $testfile ${testfile}.s > ${testfile}.out; then
+            result="compile failure $opt (INCORRECT)"
+        elif ! gcc -o ${testfile}.exe ${testfile}.s runtime.o >> ${testfile}.out 2>&1; then
+            result="assembly failure $opt (INCORRECT)"
+        elif ./${testfile}.exe > /dev/null 2> ${testfile}.out; then
+            result="success $opt (INCORRECT)"
+        elif ! grep -q "out of bounds" ${testfile}.out; then
+            result="failure without a report $opt (INCORRECT)"
+        fi
+        [ "$result" = "failure (as expected)" ] || break
+    done
+    rm -f ${testfile}.s ${testfile}.exe
+    echo "$testfile $result"
+done
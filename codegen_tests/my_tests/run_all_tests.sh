@@ -0,0 +1,57 @@
+#!/bin/bash
+
+# good programs are compiled both with and without optimizations, assembled and linked with the runtime, run, and must print exactly ${testfile}.expected
+# where ${testfile}.inlined exists, the optimized compile must also report inlining exactly those calls
+# where ${testfile}.header exists, it is precompiled and included, and the assembly must be exactly that of the header prepended to the program
+# generating the functions on several threads (-jobs) must give exactly the same assembly
+for testfile in good*.bminor; do
+    result="success (as expected)"
+    include=""
+    if [ -f ${testfile}.header ]; then
+        include="-include ${testfile}.pch"
+        cat ${testfile}.header $testfile > ${testfile}.whole
+        ./bminor -precompile ${testfile}.header ${testfile}.pch > ${testfile}.out || result="precompile failure (INCORRECT)"
+    fi
+    for opt in "" "-O0"; do
+        [ "$result" = "success (as expected)" ] || break
+        if ! ./bminor $opt $include -inline-report -codegen $testfile ${testfile}.s > ${testfile}.out; then
+            result="compile failure $opt (INCORRECT)"
+        elif [ -n "$include" ] && ! { ./bminor $opt -codegen ${testfile}.whole ${testfile}.whole.s > /dev/null && cmp -s ${testfile}.s ${testfile}.whole.s; }; then
+            result="precompiled header changed the assembly $opt (INCORRECT)"
+        elif [ -z "$opt" ] && [ -f ${testfile}.inlined ] && ! diff ${testfile}.out ${testfile}.inlined > /dev/null; then
+            result="wrong inlining report (INCORRECT)"
+        elif ! { ./bminor $opt $include -inline-report -jobs 4 -codegen $testfile ${testfile}.jobs.s | cmp -s - ${testfile}.out && cmp -s ${testfile}.s ${testfile}.jobs.s; }; then
+            result="assembly changed by -jobs $opt (INCORRECT)"
+        elif ! gcc -o ${testfile}.exe ${testfile}.s runtime.o >> ${testfile}.out 2>&1; then
+            result="assembly failure $opt (INCORRECT)"
+        elif ! diff <(./${testfile}.exe) ${testfile}.expected > ${testfile}.out; then
+            result="wrong output $opt (INCORRECT)"
+        fi
+    done
+    rm -f ${testfile}.s ${testfile}.jobs.s ${testfile}.exe ${testfile}.pch ${testfile}.whole ${testfile}.whole.s
+    echo "$testfile $result"
+done
+
+# bad programs must fail with a diagnostic, not a crash
+# where ${testfile}.header exists, it is precompiled and included, after overwriting the bytes in ${testfile}.corrupt (lines of an
+# offset into the snapshot and the hex bytes to write there)
+for testfile in bad*.bminor; do
+    include=""
+    if [ -f ${testfile}.header ]; then
+        include="-include ${testfile}.pch"
+        ./bminor -precompile ${testfile}.header ${testfile}.pch > ${testfile}.out
+        while read offset bytes; do
+            printf "$(printf '\\x%s' $bytes)" | dd of=${testfile}.pch bs=1 seek=$offset conv=notrunc 2> /dev/null
+        done < ${testfile}.corrupt
+    fi
+    ./bminor $include -codegen $testfile ${testfile}.s > ${testfile}.out 2>&1
+    e_st=$?
+    rm -f ${testfile}.s ${testfile}.pch
+	if [ $e_st -eq 0 ]; then
+		echo "$testfile success (INCORRECT)"
+	elif [ $e_st -gt 128 ]; then
+		echo "$testfile crash (INCORRECT)"
+	else
+		echo "$testfile failure (as expected)"
+	fi
+done
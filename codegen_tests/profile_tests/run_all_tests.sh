@@ -0,0 +1,24 @@
+#!/bin/bash
+
+# good programs are compiled with -profile and with -profile-cycles, assembled and linked with the runtime, and run: they
+# must print exactly ${testfile}.expected, and write a profile whose sites and counts (cycles aside) are exactly
+# ${testfile}.counts, which -profile-report must then read
+for testfile in good*.bminor; do
+    result="success (as expected)"
+    for opt in "-profile" "-profile-cycles"; do
+        if ! ./bminor $opt -codegen $testfile ${testfile}.s > ${testfile}.out; then
+            result="compile failure $opt (INCORRECT)"
+        elif ! gcc -o ${testfile}.exe ${testfile}.s runtime.o >> ${testfile}.out 2>&1; then
+            result="assembly failure $opt (INCORRECT)"
+        elif ! diff <(BMINOR_PROFILE=${testfile}.prof ./${testfile}.exe 2> /dev/null) ${testfile}.expected > ${testfile}.out; then
+            result="wrong output $opt (INCORRECT)"
+        elif ! diff <(cut -d ' ' -f 1-6 ${testfile}.prof) ${testfile}.counts >> ${testfile}.out; then
+            result="wrong counts $opt (INCORRECT)"
+        elif ! ./bminor -profile-report ${testfile}.prof $testfile >> ${testfile}.out; then
+            result="report failure $opt (INCORRECT)"
+        fi
+        [ "$result" = "success (as expected)" ] || break
+    done
+    rm -f ${testfile}.s ${testfile}.exe ${testfile}.prof
+    echo "$testfile $result"
+done
@@ -0,0 +1,31 @@
+#! /usr/bin/env bash
+
+echo "[My tests]"
+cd my_tests
+./run_all_tests.sh
+echo "-----------------"
+cd ..
+
+echo "[Bounds check tests]"
+cd bounds_tests
+./run_all_tests.sh
+echo "-----------------"
+cd ..
+
+echo "[Profiling tests]"
+cd profile_tests
+./run_all_tests.sh
+echo "-----------------"
+cd ..
+
+echo "[Bytecode interpreter tests]"
+cd vm_tests
+./run_all_tests.sh
+echo "-----------------"
+cd ..
+
+#echo "[Thain's tests]"
+#cd thain_tests
+#./run_all_tests.sh
+#echo "-----------------"
+#cd ..
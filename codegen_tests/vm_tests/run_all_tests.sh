@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# good programs are run with -run, both interpreted and with -jit, and must print exactly ${testfile}.expected, and exit with
+# the status in ${testfile}.status (0 where there is none); the programs of ../my_tests are run too, against the output they
+# have compiled
+# where ${testfile}.header exists, it is precompiled and included
+for testfile in good*.bminor ../my_tests/good*.bminor; do
+    result="success (as expected)"
+    include=""
+    expected_status=0
+    [ -f ${testfile}.status ] && expected_status=$(cat ${testfile}.status)
+    out=$(basename ${testfile}).out
+    if [ -f ${testfile}.header ]; then
+        include="-include ${out%.out}.pch"
+        ./bminor -precompile ${testfile}.header ${out%.out}.pch > $out || result="precompile failure (INCORRECT)"
+    fi
+    for engine in "" "-jit"; do
+        [ "$result" = "success (as expected)" ] || break
+        ./bminor $include -run $engine $testfile > ${out}.run 2> $out
+        status=$?
+        if ! diff ${out}.run ${testfile}.expected >> $out; then
+            result="wrong output $engine (INCORRECT)"
+        elif [ $status -ne $expected_status ]; then
+            result="exit status $status $engine (INCORRECT)"
+        fi
+    done
+    rm -f ${out}.run ${out%.out}.pch
+    echo "$testfile $result"
+done
+
+for testfile in bad*.bminor; do
+    for engine in "" "-jit"; do
+        ./bminor -run $engine $testfile > ${testfile}.out 2>&1
+        e_st=$?
+        if [ $e_st -eq 0 ]; then
+            echo "$testfile success $engine (INCORRECT)"
+        else
+            echo "$testfile failure $engine (as expected)"
+        fi
+    done
+done
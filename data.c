@@ -0,0 +1,239 @@
+#include "data.h"
+#include "codegen.h"
+#include "stmt.h"
+#include "hash_table.h"
+#include "diag.h"
+#include "arena.h"
+#include <stdio.h>
+#include <string.h>
+
+// values per .quad directive
+#define QUADS_PER_LINE  8
+
+/* globals the program may store to, by name (globals cannot be shadowed by other globals) */
+static struct hash_table *written = NULL;
+
+/* constant array literals to emit into .rodata after the code, in program order (added as codegen_defer merges their functions) */
+struct template {
+    const char  *label;
+    struct expr *lit;
+    struct type *type;
+    struct template *next;
+};
+static struct template *templates = NULL, *templates_tail = NULL;
+
+/* a .quad directive being filled, and zero bytes waiting to be emitted as one .zero */
+struct data_writer {
+    char text[QUADS_PER_LINE * 24 + 8];
+    int  quads;
+    long zeros;
+};
+
+/* internal helpers */
+void data_writes_stmt(struct stmt *s);
+void data_writes_expr(struct expr *e);
+void data_writes_lvalue(struct expr *e);
+void data_writes_base(struct expr *base);
+void data_mark_root(struct expr *e);
+bool data_has_addresses(struct expr *init);
+void data_value(struct data_writer *w, struct type *t, struct expr *init);
+void data_put(struct data_writer *w, const char *item);
+void data_put_zeros(struct data_writer *w, long bytes);
+void data_flush(struct data_writer *w);
+void data_template_add(void *template);
+
+void data_plan(struct decl *ast){
+    if( !written && !(written = hash_table_create(0, 0)) ) diag_fatal("Could not allocate the table of written globals");
+    hash_table_clear(written);
+    templates = templates_tail = NULL;
+
+    // global initializers are constants: only function bodies store
+    for( struct decl *d = ast; d; d = d->next ) data_writes_stmt(d->func_body);
+}
+
+void data_global(struct decl *d){
+    const char *section;
+    if( !d->init_value )                                section = ".bss";
+    else if( hash_table_lookup(written, d->ident) )     section = ".data";
+    else if( data_has_addresses(d->init_value) )        section = ".section .data.rel.ro";
+    else                                                section = ".section .rodata";
+
+    emit_directive("%s", section);
+    emit_directive(".globl %s", d->ident);
+    emit_directive(".align 8");
+    emit_directive(".type %s, @object", d->ident);
+    emit_directive(".size %s, %d", d->ident, type_size(d->type));
+    emit_label(d->ident);
+
+    struct data_writer w = { .quads = 0, .zeros = 0 };
+    data_value(&w, d->type, d->init_value);
+    data_flush(&w);
+}
+
+const char *data_template(struct expr *lit, struct type *t){
+    struct template *tm = arena_alloc(sizeof(*tm));
+    tm->label = label_create();
+    tm->lit   = lit;
+    tm->type  = t;
+    tm->next  = NULL;
+    codegen_defer(data_template_add, tm);
+    return tm->label;
+}
+
+void data_template_add(void *template){
+    struct template *tm = template;
+    if( templates_tail ) templates_tail->next = tm;
+    else                 templates = tm;
+    templates_tail = tm;
+}
+
+void data_templates(){
+    for( struct template *tm = templates; tm; tm = tm->next ){
+        emit_directive(data_has_addresses(tm->lit) ? ".section .data.rel.ro" : ".section .rodata");
+        emit_directive(".align 8");
+        emit_label(tm->label);
+        struct data_writer w = { .quads = 0, .zeros = 0 };
+        data_value(&w, tm->type, tm->lit);
+        data_flush(&w);
+    }
+}
+
+/* stores ================================================================ */
+
+void data_writes_stmt(struct stmt *s){
+    for( ; s; s = s->next ){
+        for( struct expr *e = s->expr_list; e; e = e->next ) data_writes_expr(e);
+        if( s->decl ) data_writes_expr(s->decl->init_value);
+        data_writes_stmt(s->body);
+    }
+}
+
+void data_writes_expr(struct expr *e){
+    /* 'e' is evaluated for its value */
+    if( !e ) return;
+    struct expr *left = NULL;
+    if( e->kind == EXPR_ARR_ACC || expr_fixity(e->kind) != FIX_NONE ) left = e->data->operator_args;
+
+    switch(e->kind){
+        case EXPR_ASGN:
+            data_writes_lvalue(left);
+            data_writes_expr(left->next);
+            break;
+        case EXPR_POST_INC:
+        case EXPR_POST_DEC:
+            data_writes_lvalue(left);
+            break;
+        case EXPR_IDENT:
+            // an array's value is its address, which lets whoever gets it store into it
+            if( e->type && e->type->kind == TYPE_ARRAY ) data_mark_root(e);
+            break;
+        case EXPR_ARR_ACC:
+            if( e->type && e->type->kind == TYPE_ARRAY ) data_writes_lvalue(e);
+            else {
+                data_writes_base(left);
+                data_writes_expr(left->next);
+            }
+            break;
+        case EXPR_ARR_LIT:
+            for( struct expr *el = e->data->arr_elements; el; el = el->next ) data_writes_expr(el);
+            break;
+        case EXPR_FUNC_CALL:
+            for( struct expr *arg = e->data->func_and_args->next; arg; arg = arg->next ) data_writes_expr(arg);
+            break;
+        default:
+            if( left ){
+                data_writes_expr(left);
+                data_writes_expr(left->next);
+            }
+            break;
+    }
+}
+
+void data_writes_lvalue(struct expr *e){
+    /* 'e' is stored to: its variable is written, and the indices on the way to it are evaluated */
+    data_mark_root(e);
+    for( ; e->kind == EXPR_ARR_ACC; e = e->data->operator_args )
+        data_writes_expr(e->data->operator_args->next);
+}
+
+void data_writes_base(struct expr *base){
+    /* 'base' is only indexed into, to load an element */
+    if( base->kind == EXPR_IDENT ) return;
+    if( base->kind != EXPR_ARR_ACC ){
+        data_writes_expr(base);
+        return;
+    }
+    data_writes_base(base->data->operator_args);
+    data_writes_expr(base->data->operator_args->next);
+}
+
+void data_mark_root(struct expr *e){
+    while( e->kind == EXPR_ARR_ACC ) e = e->data->operator_args;
+    if( e->kind == EXPR_IDENT && e->symbol && e->symbol->kind == SYMBOL_GLOBAL )
+        hash_table_insert(written, e->symbol->name, e->symbol);
+}
+
+/* values ================================================================ */
+
+bool data_has_addresses(struct expr *init){
+    if( !init ) return false;
+    if( init->kind == EXPR_STR_LIT ) return true;
+    if( init->kind != EXPR_ARR_LIT ) return false;
+    for( struct expr *el = init->data->arr_elements; el; el = el->next )
+        if( data_has_addresses(el) ) return true;
+    return false;
+}
+
+void data_value(struct data_writer *w, struct type *t, struct expr *init){
+    /* the typechecker only lets constant initializers through */
+    if( !init ){
+        data_put_zeros(w, type_size(t));
+        return;
+    }
+    if( init->kind == EXPR_ARR_LIT ){
+        int n = 0;
+        for( struct expr *el = init->data->arr_elements; el; el = el->next, n++ )
+            data_value(w, t->subtype, el);
+        // elements the literal leaves out are zero
+        int len = type_array_length(t);
+        if( len > n ) data_put_zeros(w, (long) (len - n) * type_size(t->subtype));
+        return;
+    }
+    if( init->kind == EXPR_STR_LIT ){
+        data_put(w, codegen_string(str_lit_bytes(init->data->str_data), init->data->str_data->len));
+        return;
+    }
+    long val = 0;
+    if( init->kind == EXPR_CHAR_LIT )       val = init->data->char_data;
+    else if( init->kind == EXPR_BOOL_LIT )  val = init->data->bool_data;
+    else                                    expr_const_int(init, &val);
+    if( !val ){
+        data_put_zeros(w, 8);
+        return;
+    }
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", val);
+    data_put(w, text);
+}
+
+void data_put(struct data_writer *w, const char *item){
+    if( w->zeros ) data_flush(w);
+    // a label could be longer than a number: start a new directive rather than overflow this one
+    if( w->quads && strlen(w->text) + strlen(item) + 3 > sizeof(w->text) ) data_flush(w);
+    if( w->quads++ ) strcat(w->text, ", ");
+    else             w->text[0] = '\0';
+    strcat(w->text, item);
+    if( w->quads == QUADS_PER_LINE ) data_flush(w);
+}
+
+void data_put_zeros(struct data_writer *w, long bytes){
+    if( w->quads ) data_flush(w);
+    w->zeros += bytes;
+}
+
+void data_flush(struct data_writer *w){
+    if( w->quads )  emit_directive(".quad %s", w->text);
+    if( w->zeros )  emit_directive(".zero %ld", w->zeros);
+    w->quads = 0;
+    w->zeros = 0;
+}
@@ -0,0 +1,27 @@
+#ifndef DATA_H
+#define DATA_H
+
+#include "decl.h"
+#include <stdbool.h>
+
+/* Static data: the storage and initial values of globals, and of constant array literals, laid out at compile time.
+   A global goes in
+    - .bss when it has no initializer: zero filled at load time, taking no space in the binary
+    - .rodata when the program never stores to it (nor passes it, if an array, where a callee could)
+    - .data.rel.ro instead when such a global holds string addresses, which the loader relocates before making them read-only
+    - .data otherwise
+   Values are packed several to a .quad directive, and runs of zeros become .zero. */
+
+/* local array literals with at least this many elements, all constants, are copied from a template in .rodata */
+#define DATA_TEMPLATE_MIN   8
+
+/* finds the globals the program may store to: before data_global */
+void data_plan( struct decl *ast );
+/* emits the storage of global 'd' (not a function) */
+void data_global( struct decl *d );
+/* label of a read-only copy of 'lit', a constant array literal of type 't', emitted by data_templates */
+const char *data_template( struct expr *lit, struct type *t );
+/* emits the templates data_template handed out */
+void data_templates();
+
+#endif
@@ -1,17 +1,20 @@
 #include "decl.h"
 #include "scope.h"
+#include "diag.h"
+#include "output.h"
+#include "arena.h"
+#include "codegen.h"
+#include "data.h"
 #include <stdio.h>
 #include <stdlib.h>
 //#include <stdbool.h>
 
-extern void indent(int indents);
+/* internal helpers */
+int  decl_typecheck_type(struct decl *d);
+void decl_codegen_array_literal(struct expr *lit, struct type *t, long offset);
 
 struct decl * decl_create(char *ident, struct type *type, struct expr *init_value, struct stmt *func_body){
-    struct decl *d = malloc(sizeof(*d));
-    if(!d) {
-        puts("[ERROR|FATAL] Could not allocate decl memory, exiting...");
-        exit(EXIT_FAILURE);
-    }
+    struct decl *d = arena_alloc(sizeof(*d));
 
     d->ident         = ident;
     d->type          = type;
@@ -19,6 +22,8 @@ struct decl * decl_create(char *ident, struct type *type, struct expr *init_valu
     d->func_body     = func_body;
     d->next          = NULL;
     d->symbol        = NULL;
+    d->line          = 0;
+    d->column        = 0;
 
     return d;
 }
@@ -27,27 +32,28 @@ void decl_print(struct decl *d, int indents, char* term){
     if (!d) return;
 
     indent(indents);
-    printf("%s: ", d->ident);
+    fprintf(out_stream, "%s: ", d->ident);
     type_print(d->type);
 
     if (d->init_value){
-        fputs(" = ", stdout);
+        fputs(" = ", out_stream);
         expr_print(d->init_value);
     }
 
     if (d->func_body){
-        fputs(" = {\n", stdout);
+        fputs(" = {\n", out_stream);
         stmt_print_list(d->func_body, indents + 1, "\n");
         indent(indents);
-        fputs("\n}", stdout);
-    } else fputs(term, stdout);
+        fputs("\n}", out_stream);
+    } else fputs(term, out_stream);
 }
 
 void decl_print_list(struct decl *d, int indents, char* term, char *delim){
-    if (!d) return;
-    decl_print(d, indents, term);
-    if (d->next) fputs(delim, stdout);
-    decl_print_list(d->next, indents, term, delim);
+    // a loop rather than recursion: generated programs can have more top-level declarations than the stack has frames
+    for (; d; d = d->next){
+        decl_print(d, indents, term);
+        if (d->next) fputs(delim, out_stream);
+    }
 }
 
 int decl_resolve(struct decl *d, struct scope *sc, bool am_param, bool verbose){
@@ -75,14 +81,16 @@ int decl_resolve(struct decl *d, struct scope *sc, bool am_param, bool verbose){
         //      - global symbol with non-zero which
         //  - could also emit error message IN scope_bind
         //      - not crazy about this
-        printf("[ERROR|resolve] Non-prototype variable %s has either a redeclaration or function body redefinition\n", d->ident);
+        diag_report(DIAG_RESOLVE, 0, "Non-prototype variable %s has either a redeclaration or function body redefinition", d->ident);
         err_count++;
     }
     else if(verbose){
-        printf("Variable %s declared as ", d->ident);
+        fprintf(out_stream, "Variable %s declared as ", d->ident);
         symbol_print(d->symbol);
-        puts("");
+        fputs("\n", out_stream);
     };
+    // the inliner finds a callee's body through its symbol
+    if( d->symbol && d->func_body ) d->symbol->definition = d;
 
     // create new scope for declaring a function
     // resolve function name before body to allow recursion
@@ -97,3 +105,133 @@ int decl_resolve(struct decl *d, struct scope *sc, bool am_param, bool verbose){
     err_count += decl_resolve(d->next, sc, am_param, verbose);
     return err_count;
 }
+
+int decl_typecheck(struct decl *d){
+    if( !d ) return 0;
+
+    int err_count = decl_typecheck_type(d);
+    struct type *t = d->type;
+
+    // later declarations of a function share the first one's symbol, and with it that declaration's type
+    if( !type_equals(d->symbol->type, t) ){
+        diag_report(DIAG_TYPECHECK, 0, "%s declared as %s, conflicting with its earlier declaration as %s", d->ident, type_to_str(t), type_to_str(d->symbol->type));
+        err_count++;
+    }
+
+    if( d->init_value ){
+        err_count += expr_typecheck_initializer(d->init_value);
+        struct type *init_type = d->init_value->type;
+        // array [] <type> = {...}: the length comes from the literal
+        if( t->kind == TYPE_ARRAY && !t->arr_sz && init_type && init_type->kind == TYPE_ARRAY )
+            t->arr_sz = init_type->arr_sz;
+        if( init_type && !type_equals(t, init_type) ){
+            diag_report(DIAG_TYPECHECK, 0, "%s is %s, but its initializer %s is %s", d->ident, type_to_str(t), expr_to_str(d->init_value), type_to_str(init_type));
+            err_count++;
+        }
+        if( d->symbol->kind == SYMBOL_GLOBAL && !expr_is_constant(d->init_value) ){
+            diag_report(DIAG_TYPECHECK, 0, "Global %s must be initialized with a constant, not %s", d->ident, expr_to_str(d->init_value));
+            err_count++;
+        }
+    }
+
+    if( t->kind == TYPE_FUNCTION ){
+        err_count += decl_typecheck(t->params);
+        err_count += stmt_typecheck(d->func_body, t->subtype);
+    }
+
+    err_count += decl_typecheck(d->next);
+    return err_count;
+}
+
+int decl_typecheck_type(struct decl *d){
+    /* whether 'd' may be declared with its type at all */
+    struct type *t = d->type;
+    bool param = d->symbol->kind == SYMBOL_PARAM;
+    int err_count = 0;
+
+    switch(t->kind){
+        case TYPE_VOID:
+            diag_report(DIAG_TYPECHECK, 0, "%s cannot be declared void", d->ident);
+            err_count++;
+            break;
+        case TYPE_FUNCTION:
+            if( t->subtype->kind != TYPE_VOID && !type_is_atomic(t->subtype) ){
+                diag_report(DIAG_TYPECHECK, 0, "Function %s must return integer, boolean, char, string or void, not %s", d->ident, type_to_str(t->subtype));
+                err_count++;
+            }
+            if( d->symbol->kind != SYMBOL_GLOBAL ){
+                diag_report(DIAG_TYPECHECK, 0, "Function %s can only be declared globally%s", d->ident, param ? ": it cannot be a parameter" : "");
+                err_count++;
+            }
+            break;
+        case TYPE_ARRAY:
+            for( struct type *a = t; a->kind == TYPE_ARRAY; a = a->subtype ){
+                long len;
+                // the outermost length of a parameter is the caller's, and that of an initialized array the initializer's
+                if( !a->arr_sz ){
+                    if( a == t && (param || (d->init_value && d->init_value->kind == EXPR_ARR_LIT)) ) continue;
+                    diag_report(DIAG_TYPECHECK, 0, "Array %s needs a length for each dimension", d->ident);
+                    err_count++;
+                }
+                else if( !expr_const_int(a->arr_sz, &len) || len <= 0 ){
+                    diag_report(DIAG_TYPECHECK, 0, "Length %s of array %s must be a positive integer literal", expr_to_str(a->arr_sz), d->ident);
+                    err_count++;
+                }
+                if( a->subtype->kind != TYPE_ARRAY && !type_is_atomic(a->subtype) ){
+                    diag_report(DIAG_TYPECHECK, 0, "Array %s must hold integers, booleans, chars or strings, not %s", d->ident, type_to_str(a->subtype));
+                    err_count++;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    return err_count;
+}
+
+void decl_codegen(struct decl *d){
+    struct operand slot = symbol_codegen(d->symbol);
+
+    if( d->type->kind == TYPE_ARRAY ){
+        long quads = type_size(d->type) / 8;
+        if( d->init_value && quads >= DATA_TEMPLATE_MIN && expr_is_constant(d->init_value) ){
+            // one block copy from the literal laid out in .rodata, rather than a store per element
+            emit(OP_LEAQ, opnd_sym(data_template(d->init_value, d->type)), opnd_reg(REG_RSI));
+            emit(OP_LEAQ, slot, opnd_reg(REG_RDI));
+            emit(OP_MOVQ, opnd_imm(quads), opnd_reg(REG_RCX));
+            emit0(OP_REP_MOVSQ);
+            return;
+        }
+        if( d->init_value ){
+            decl_codegen_array_literal(d->init_value, d->type, slot.val);
+            return;
+        }
+        // uninitialized arrays are all zeros
+        emit(OP_LEAQ, slot, opnd_reg(REG_RDI));
+        emit(OP_MOVQ, opnd_imm(quads), opnd_reg(REG_RCX));
+        emit(OP_XORQ, opnd_reg(REG_RAX), opnd_reg(REG_RAX));
+        emit0(OP_REP_STOSQ);
+        return;
+    }
+
+    if( !d->init_value ){
+        emit(OP_MOVQ, opnd_imm(0), slot);
+        return;
+    }
+    expr_codegen(d->init_value);
+    emit(OP_MOVQ, opnd_reg(d->init_value->reg), slot);
+    scratch_free(d->init_value->reg);
+}
+
+void decl_codegen_array_literal(struct expr *lit, struct type *t, long offset){
+    /* stores the elements of 'lit', an array literal of type 't', into the frame from 'offset' up */
+    for( struct expr *el = lit->data->arr_elements; el; el = el->next, offset += type_size(t->subtype) ){
+        if( el->kind == EXPR_ARR_LIT ){
+            decl_codegen_array_literal(el, t->subtype, offset);
+            continue;
+        }
+        expr_codegen(el);
+        emit(OP_MOVQ, opnd_reg(el->reg), opnd_mem(REG_RBP, offset));
+        scratch_free(el->reg);
+    }
+}
@@ -14,6 +14,9 @@ struct decl {
 	struct stmt   *func_body;
 	struct symbol *symbol;
 	struct decl   *next;
+	// where the name is declared in the source (1-based; 0 for declarations loaded from a precompiled header)
+	int            line;
+	int            column;
 };
 
 struct decl * decl_create( char *name, struct type *type, struct expr *init_value, struct stmt *func_body);
@@ -22,6 +25,10 @@ void decl_print_list( struct decl *d, int indents, char* term, char *delim );
 
 struct scope;
 int  decl_resolve( struct decl *d, struct scope *sc, bool am_param, bool verbose);
+/* typechecks the list of declarations starting at 'd' (function bodies included): returns the number of type errors */
+int  decl_typecheck( struct decl *d );
+/* local declarations: storage is already laid out in the frame, so this only initializes it */
+void decl_codegen( struct decl *d );
 
 #endif
 
@@ -0,0 +1,96 @@
+#define _GNU_SOURCE // vasprintf
+#include "diag.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+/* diagnostics recorded since the last diag_take, oldest first: each thread records its own (see codegen_opts.jobs) */
+static __thread struct diag *head = NULL, *tail = NULL;
+static __thread bool         echo = true;
+static __thread jmp_buf     *recovery = NULL;
+
+static void diag_vreport(diag_t kind, int line, const char *fmt, va_list args){
+    char *msg = NULL;
+    if( vasprintf(&msg, fmt, args) < 0 ) msg = NULL;
+
+    if( echo ){
+        printf("[ERROR|%s] ", diag_kind_str(kind));
+        if( line > 0 ) printf("line %d: ", line);
+        puts(msg ? msg : "(could not format diagnostic)");
+    }
+
+    // out of memory: the echo above is the best we can do
+    struct diag *d = msg ? malloc(sizeof(*d)) : NULL;
+    if( !d ){
+        free(msg);
+        return;
+    }
+    d->kind = kind;
+    d->line = line;
+    d->msg  = msg;
+    d->next = NULL;
+
+    if( tail ) tail->next = d;
+    else       head = d;
+    tail = d;
+}
+
+void diag_report(diag_t kind, int line, const char *fmt, ...){
+    va_list args;
+    va_start(args, fmt);
+    diag_vreport(kind, line, fmt, args);
+    va_end(args);
+}
+
+void diag_fatal(const char *fmt, ...){
+    va_list args;
+    va_start(args, fmt);
+    diag_vreport(DIAG_INTERNAL, 0, fmt, args);
+    va_end(args);
+
+    if( recovery ) longjmp(*recovery, 1);
+    // nothing else would say why
+    if( !echo && tail ) printf("[ERROR|%s] %s\n", diag_kind_str(tail->kind), tail->msg);
+    exit(EXIT_FAILURE);
+}
+
+bool diag_set_echo(bool on){
+    bool was = echo;
+    echo = on;
+    return was;
+}
+
+void diag_set_recovery(jmp_buf *r){ recovery = r; }
+
+struct diag *diag_take(){
+    struct diag *taken = head;
+    head = tail = NULL;
+    return taken;
+}
+
+int diag_count(struct diag *d){
+    return d ? 1 + diag_count(d->next) : 0;
+}
+
+const char *diag_kind_str(diag_t kind){
+    switch(kind){
+        case DIAG_FILE:         return "file";
+        case DIAG_SCAN:         return "scan";
+        case DIAG_PARSE:        return "parse";
+        case DIAG_RESOLVE:      return "resolve";
+        case DIAG_TYPECHECK:    return "typecheck";
+        case DIAG_CODEGEN:      return "codegen";
+        case DIAG_RUNTIME:      return "runtime";
+        case DIAG_INTERNAL:     return "internal";
+        default:                return "unknown";
+    }
+}
+
+void diag_delete(struct diag *d){
+    while( d ){
+        struct diag *next = d->next;
+        free(d->msg);
+        free(d);
+        d = next;
+    }
+}
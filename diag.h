@@ -0,0 +1,47 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdbool.h>
+#include <setjmp.h>
+
+typedef enum {
+    DIAG_FILE,
+    DIAG_SCAN,
+    DIAG_PARSE,
+    DIAG_RESOLVE,
+    DIAG_TYPECHECK,
+    DIAG_CODEGEN,
+    // an error of a program run by the interpreter (-run)
+    DIAG_RUNTIME,
+    DIAG_INTERNAL
+} diag_t;
+
+struct diag {
+    diag_t kind;
+    // 0 when the stage reporting the diagnostic has no position information (e.g. name resolution, typechecking)
+    int    line;
+    char  *msg;
+    struct diag *next;
+};
+
+/* Diagnostics, the echo setting and the recovery point are each thread's own: a thread starts with none recorded, echoing on
+   and no recovery point */
+
+/* record a diagnostic: also printed to stdout as "[ERROR|<kind>] <msg>" while echoing is on (the default, for the command line tool) */
+void diag_report( diag_t kind, int line, const char *fmt, ... );
+/* record an internal diagnostic and abandon the compile: longjmps to the recovery point if one is set, otherwise exits
+   (printing the diagnostic even while echoing is off) */
+void diag_fatal( const char *fmt, ... );
+
+/* returns the previous setting */
+bool diag_set_echo( bool echo );
+/* recovery point for diag_fatal: NULL restores exit-on-fatal */
+void diag_set_recovery( jmp_buf *recovery );
+
+/* hand ownership of the diagnostics recorded so far to the caller (in report order), starting a fresh list */
+struct diag *diag_take();
+int          diag_count( struct diag *d );
+const char  *diag_kind_str( diag_t kind );
+void         diag_delete( struct diag *d );
+
+#endif
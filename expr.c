@@ -0,0 +1,857 @@
+#include "expr.h"
+#include "scope.h"
+#include "diag.h"
+#include "output.h"
+#include "arena.h"
+#include "type.h"
+#include "codegen.h"
+#include "strength.h"
+#include "bounds.h"
+#include "inline.h"
+#include "runtime.h"
+#include "flat.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define MAX(a, b)   ((a) > (b) ? (a) : (b))
+
+/* internal helpers */
+union expr_data *expr_data_create();
+void expr_print_subexpr(struct expr *e, expr_t parent_oper, bool right_oper);
+void descape_and_print_str_lit(struct str_lit *lit);
+void descape_and_print_char_lit(char c);
+char *descape_char(char c, char delim, char *clean);
+int  expr_typecheck_operands(struct expr *e, type_t kind, const char *what);
+bool expr_is_lvalue(struct expr *e);
+struct type *expr_type_of_kind(type_t kind);
+void expr_codegen_address(struct expr *e);
+void expr_codegen_store(struct expr *lvalue, struct expr *value);
+bool expr_codegen_short(struct expr *next);
+void expr_codegen_spill(struct expr *held, struct expr *next);
+void expr_codegen_reload(struct expr *held);
+void expr_codegen_arith(struct expr *e);
+void expr_codegen_exp_loop(reg_t base, reg_t exponent);
+void expr_codegen_compare(struct expr *e);
+void expr_codegen_logical(struct expr *e);
+void expr_codegen_call(struct expr *e);
+
+struct expr * expr_create(expr_t expr_type, union expr_data *data){
+    struct expr *e = arena_alloc(sizeof(*e));
+
+    e->kind = expr_type;
+    // this seemed to me a good union application since the data values are mutually exclusive
+    e->data = data;
+    e->next = NULL;
+    e->symbol = NULL;
+    e->type = NULL;
+    e->reg = -1;
+    e->line = e->column = 0;
+    e->hoisted = 0;
+    e->spill = 0;
+
+    return e;
+}
+
+struct expr * expr_create_oper( expr_t expr_type, struct expr *left_arg, struct expr* right_arg ){
+    /* */
+    union expr_data *d = expr_data_create();
+    // uniform interface for unary operators: pass as NULL whichever operand is not used
+    // fill in with empty placeholders on either side so that we have two operands no matter the operator
+    if (!left_arg)  left_arg  = expr_create_empty();
+    if (!right_arg) right_arg = expr_create_empty();
+    left_arg->next = right_arg;
+    d->operator_args = left_arg;
+    return expr_create(expr_type, d);
+}
+
+struct expr * expr_create_identifier( const char *ident ){
+    union expr_data *d = expr_data_create();
+    d->ident_name = ident;
+    return expr_create(EXPR_IDENT, d);
+}
+
+struct expr * expr_create_integer_literal( int i ){ 
+    union expr_data *d = expr_data_create();
+    d->int_data = i;
+    return expr_create(EXPR_INT_LIT, d);
+}
+
+struct expr * expr_create_boolean_literal( bool b ){
+    union expr_data *d = expr_data_create();
+    d->bool_data = b;
+    return expr_create(EXPR_BOOL_LIT, d);
+}
+
+struct expr * expr_create_char_literal( char c ){
+    union expr_data *d = expr_data_create();
+    d->char_data = c;
+    return expr_create(EXPR_CHAR_LIT, d);
+}
+
+struct expr *expr_create_string_literal( struct str_lit lit ){
+    union expr_data *d = expr_data_create();
+    d->str_data = arena_alloc(sizeof(lit));
+    *d->str_data = lit;
+    return expr_create(EXPR_STR_LIT, d);
+}
+
+struct expr *expr_create_array_literal(struct expr *expr_list){
+    union expr_data *d = expr_data_create();
+    d->arr_elements = expr_list;
+    return expr_create(EXPR_ARR_LIT, d);
+}
+
+struct expr *expr_create_function_call(struct expr *function, struct expr *arg_list){ 
+    union expr_data *d = expr_data_create();
+    function->next = arg_list;
+    d->func_and_args = function;
+    return expr_create(EXPR_FUNC_CALL, d);
+}
+
+struct expr *expr_create_array_access(struct expr *array, struct expr *index){
+    union expr_data *d = expr_data_create();
+    array->next = index;
+    d->operator_args = array;
+    return expr_create(EXPR_ARR_ACC, d);
+}
+
+struct expr *expr_create_empty(){
+    return expr_create(EXPR_EMPTY, NULL);
+}
+
+union expr_data *expr_data_create(){
+    return arena_alloc(sizeof(union expr_data));
+}
+
+int expr_resolve(struct expr *e, struct scope *sc, bool verbose){
+    if( !e ) return 0;
+    if( resolve_flat ){
+        // the flattened list is only needed for as long as it is being resolved
+        struct arena_mark mark = arena_mark();
+        int err_count = flat_resolve(flat_create(e), sc, verbose);
+        arena_release(mark);
+        return err_count;
+    }
+
+    int err_count = 0;
+    if( e->kind == EXPR_IDENT){
+        e->symbol = scope_lookup(sc, e->data->ident_name, false);
+        if ( !e->symbol ){
+            diag_report(DIAG_RESOLVE, 0, "Variable %s used before declaration", e->data->ident_name);
+            err_count++;
+        }
+        else if(verbose){
+            fprintf(out_stream, "Variable %s resolved to ", e->data->ident_name);
+            symbol_print(e->symbol);
+            fputs("\n", out_stream);
+        }
+    }
+    // if we have arguments, resolve them: operator_args is arbitrary choice here
+    //  - just need to interpret data as expr pointer
+    // my choice to use a union for e->data makes this clunky
+    if( !(e->kind == EXPR_EMPTY    || e->kind == EXPR_IDENT
+       || e->kind == EXPR_INT_LIT  || e->kind == EXPR_STR_LIT
+       || e->kind == EXPR_CHAR_LIT || e->kind == EXPR_BOOL_LIT) )
+        err_count += expr_resolve(e->data->operator_args, sc, verbose);
+
+    err_count += expr_resolve(e->next, sc, verbose);
+    return err_count;
+}
+
+int expr_typecheck(struct expr *e){
+    if( !e ) return 0;
+
+    int err_count = 0;
+    struct expr *left = NULL, *right = NULL;
+    if( e->kind == EXPR_ARR_ACC || expr_fixity(e->kind) != FIX_NONE ){
+        left  = e->data->operator_args;
+        right = left->next;
+        err_count += expr_typecheck(left) + expr_typecheck(right);
+    }
+
+    switch(e->kind){
+        case EXPR_EMPTY:
+            e->type = expr_type_of_kind(TYPE_VOID);
+            break;
+        case EXPR_IDENT:
+            e->type = e->symbol->type;
+            break;
+        case EXPR_INT_LIT:
+            e->type = expr_type_of_kind(TYPE_INTEGER);
+            break;
+        case EXPR_STR_LIT:
+            e->type = expr_type_of_kind(TYPE_STRING);
+            break;
+        case EXPR_CHAR_LIT:
+            e->type = expr_type_of_kind(TYPE_CHAR);
+            break;
+        case EXPR_BOOL_LIT:
+            e->type = expr_type_of_kind(TYPE_BOOLEAN);
+            break;
+        case EXPR_ARR_LIT:
+            // typechecked by expr_typecheck_initializer when it initializes a declaration
+            diag_report(DIAG_TYPECHECK, 0, "Array literal %s can only initialize an array declaration", expr_to_str(e));
+            err_count++;
+            break;
+        case EXPR_ARR_ACC:
+            if( left->type && left->type->kind != TYPE_ARRAY ){
+                diag_report(DIAG_TYPECHECK, 0, "Cannot index %s, of type %s: it is not an array", expr_to_str(left), type_to_str(left->type));
+                err_count++;
+            }
+            if( right->type && right->type->kind != TYPE_INTEGER ){
+                diag_report(DIAG_TYPECHECK, 0, "Array index %s is %s, not integer", expr_to_str(right), type_to_str(right->type));
+                err_count++;
+            }
+            e->type = left->type && left->type->kind == TYPE_ARRAY ? left->type->subtype : NULL;
+            break;
+        case EXPR_FUNC_CALL: {
+            struct expr *callee = e->data->func_and_args;
+            for( struct expr *part = callee; part; part = part->next )
+                err_count += expr_typecheck(part);
+            if( !callee->type ) break;
+            if( callee->type->kind != TYPE_FUNCTION ){
+                diag_report(DIAG_TYPECHECK, 0, "Cannot call %s, of type %s: it is not a function", expr_to_str(callee), type_to_str(callee->type));
+                err_count++;
+                break;
+            }
+            int nargs = 0, nparams = 0;
+            struct decl *param = callee->type->params;
+            for( struct expr *arg = callee->next; arg; arg = arg->next, nargs++ ){
+                if( !param ) continue;
+                if( arg->type && !type_equals(param->type, arg->type) ){
+                    diag_report(DIAG_TYPECHECK, 0, "Argument %s of %s is %s, but parameter %s is %s", expr_to_str(arg), expr_to_str(e), type_to_str(arg->type), param->ident, type_to_str(param->type));
+                    err_count++;
+                }
+                param = param->next;
+            }
+            for( param = callee->type->params; param; param = param->next ) nparams++;
+            if( nargs != nparams ){
+                diag_report(DIAG_TYPECHECK, 0, "%s passes %d argument%s, but %s takes %d", expr_to_str(e), nargs, nargs == 1 ? "" : "s", expr_to_str(callee), nparams);
+                err_count++;
+            }
+            e->type = callee->type->subtype;
+            break;
+        }
+        case EXPR_ASGN:
+            if( !expr_is_lvalue(left) ){
+                diag_report(DIAG_TYPECHECK, 0, "Cannot assign to %s: it is not a variable or an array element", expr_to_str(left));
+                err_count++;
+            }
+            else if( left->type && !type_is_atomic(left->type) ){
+                diag_report(DIAG_TYPECHECK, 0, "Cannot assign to %s, of type %s: only integers, booleans, chars and strings can be assigned", expr_to_str(left), type_to_str(left->type));
+                err_count++;
+            }
+            else if( left->type && right->type && !type_equals(left->type, right->type) ){
+                diag_report(DIAG_TYPECHECK, 0, "Cannot assign %s, of type %s, to %s, of type %s", expr_to_str(right), type_to_str(right->type), expr_to_str(left), type_to_str(left->type));
+                err_count++;
+            }
+            e->type = left->type;
+            break;
+        case EXPR_OR:
+        case EXPR_AND:
+        case EXPR_NOT:
+            err_count += expr_typecheck_operands(e, TYPE_BOOLEAN, "boolean");
+            e->type = expr_type_of_kind(TYPE_BOOLEAN);
+            break;
+        case EXPR_LT:
+        case EXPR_LT_EQ:
+        case EXPR_GT:
+        case EXPR_GT_EQ:
+            err_count += expr_typecheck_operands(e, TYPE_INTEGER, "integer");
+            e->type = expr_type_of_kind(TYPE_BOOLEAN);
+            break;
+        case EXPR_EQ:
+        case EXPR_NOT_EQ:
+            if( left->type && right->type ){
+                if( !type_equals(left->type, right->type) ){
+                    diag_report(DIAG_TYPECHECK, 0, "Cannot compare %s, of type %s, with %s, of type %s", expr_to_str(left), type_to_str(left->type), expr_to_str(right), type_to_str(right->type));
+                    err_count++;
+                }
+                else if( !type_is_atomic(left->type) ){
+                    diag_report(DIAG_TYPECHECK, 0, "Cannot compare values of type %s in %s", type_to_str(left->type), expr_to_str(e));
+                    err_count++;
+                }
+            }
+            e->type = expr_type_of_kind(TYPE_BOOLEAN);
+            break;
+        case EXPR_POST_INC:
+        case EXPR_POST_DEC:
+            if( !expr_is_lvalue(left) ){
+                diag_report(DIAG_TYPECHECK, 0, "Cannot apply %s to %s: it is not a variable or an array element", expr_oper_str(e->kind), expr_to_str(left));
+                err_count++;
+            }
+            err_count += expr_typecheck_operands(e, TYPE_INTEGER, "integer");
+            e->type = expr_type_of_kind(TYPE_INTEGER);
+            break;
+        default:
+            // arithmetic
+            err_count += expr_typecheck_operands(e, TYPE_INTEGER, "integer");
+            e->type = expr_type_of_kind(TYPE_INTEGER);
+            break;
+    }
+    return err_count;
+}
+
+int expr_typecheck_initializer(struct expr *e){
+    if( e->kind != EXPR_ARR_LIT ) return expr_typecheck(e);
+
+    // typed as an array exactly as long as the literal: the declaration checks that against its own length
+    int err_count = 0, n = 0;
+    struct type *elem_type = NULL;
+    bool ok = true;
+    for( struct expr *el = e->data->arr_elements; el; el = el->next, n++ ){
+        err_count += expr_typecheck_initializer(el);
+        if( !el->type ) ok = false;
+        else if( !elem_type ) elem_type = el->type;
+        else if( !type_equals(elem_type, el->type) ){
+            diag_report(DIAG_TYPECHECK, 0, "Array literal %s mixes elements of type %s and %s", expr_to_str(e), type_to_str(elem_type), type_to_str(el->type));
+            err_count++;
+            ok = false;
+        }
+    }
+    e->type = ok ? type_create(TYPE_ARRAY, elem_type, expr_create_integer_literal(n), NULL) : NULL;
+    return err_count;
+}
+
+int expr_typecheck_operands(struct expr *e, type_t kind, const char *what){
+    /* every operand of 'e' (empty placeholders aside) must be of type 'kind' */
+    int err_count = 0;
+    for( struct expr *operand = e->data->operator_args; operand; operand = operand->next ){
+        if( operand->kind == EXPR_EMPTY || !operand->type || operand->type->kind == kind ) continue;
+        diag_report(DIAG_TYPECHECK, 0, "%s needs %s operands, but %s is %s", expr_to_str(e), what, expr_to_str(operand), type_to_str(operand->type));
+        err_count++;
+    }
+    return err_count;
+}
+
+bool expr_is_lvalue(struct expr *e){
+    return e->kind == EXPR_ARR_ACC || (e->kind == EXPR_IDENT && e->symbol->type->kind != TYPE_FUNCTION);
+}
+
+struct type *expr_type_of_kind(type_t kind){
+    return type_create(kind, NULL, NULL, NULL);
+}
+
+bool expr_is_constant(struct expr *e){
+    long val;
+    switch(e->kind){
+        case EXPR_INT_LIT:
+        case EXPR_STR_LIT:
+        case EXPR_CHAR_LIT:
+        case EXPR_BOOL_LIT:
+            return true;
+        case EXPR_ARR_LIT:
+            for( struct expr *el = e->data->arr_elements; el; el = el->next )
+                if( !expr_is_constant(el) ) return false;
+            return true;
+        default:
+            return expr_const_int(e, &val);
+    }
+}
+
+bool expr_const_int(struct expr *e, long *val){
+    if( !e ) return false;
+    switch(e->kind){
+        case EXPR_INT_LIT:
+            *val = e->data->int_data;
+            return true;
+        case EXPR_ADD_ID:
+            return expr_const_int(e->data->operator_args->next, val);
+        case EXPR_ADD_INV:
+            if( !expr_const_int(e->data->operator_args->next, val) ) return false;
+            *val = -*val;
+            return true;
+        default:
+            return false;
+    }
+}
+
+char *expr_to_str(struct expr *e){
+    output_capture_begin();
+    expr_print(e);
+    return output_capture_end();
+}
+
+void expr_codegen(struct expr *e){
+    if( !e ) return;
+    if( e->hoisted ){
+        e->reg = scratch_alloc();
+        emit(OP_MOVQ, opnd_mem(REG_RBP, e->hoisted), opnd_reg(e->reg));
+        return;
+    }
+
+    struct expr *left = NULL, *right = NULL;
+    if( e->kind == EXPR_ARR_ACC || expr_fixity(e->kind) != FIX_NONE ){
+        left  = e->data->operator_args;
+        right = left->next;
+    }
+
+    switch(e->kind){
+        case EXPR_EMPTY:
+            e->reg = REG_NONE;
+            break;
+        case EXPR_INT_LIT:
+        case EXPR_CHAR_LIT:
+        case EXPR_BOOL_LIT:
+            e->reg = scratch_alloc();
+            emit(OP_MOVQ, opnd_imm(e->kind == EXPR_INT_LIT  ? e->data->int_data
+                                 : e->kind == EXPR_CHAR_LIT ? e->data->char_data
+                                 : e->data->bool_data), opnd_reg(e->reg));
+            break;
+        case EXPR_STR_LIT:
+            e->reg = scratch_alloc();
+            emit(OP_LEAQ, opnd_sym(codegen_string(str_lit_bytes(e->data->str_data), e->data->str_data->len)), opnd_reg(e->reg));
+            break;
+        case EXPR_IDENT:
+            e->reg = scratch_alloc();
+            // arrays are stored in place, so their value is their address: parameters hold the address the caller passed
+            emit(e->type->kind == TYPE_ARRAY && e->symbol->kind != SYMBOL_PARAM ? OP_LEAQ : OP_MOVQ, symbol_codegen(e->symbol), opnd_reg(e->reg));
+            break;
+        case EXPR_ARR_ACC:
+            expr_codegen_address(e);
+            // an element that is itself an array is used by address
+            if( e->type->kind != TYPE_ARRAY ) emit(OP_MOVQ, opnd_mem(e->reg, 0), opnd_reg(e->reg));
+            break;
+        case EXPR_FUNC_CALL:
+            expr_codegen_call(e);
+            break;
+        case EXPR_ASGN:
+            expr_codegen(right);
+            expr_codegen_store(left, right);
+            e->reg = right->reg;
+            break;
+        case EXPR_POST_INC:
+        case EXPR_POST_DEC: {
+            struct operand target;
+            if( left->kind == EXPR_IDENT ) target = symbol_codegen(left->symbol);
+            else {
+                expr_codegen_address(left);
+                target = opnd_mem(left->reg, 0);
+            }
+            e->reg = scratch_alloc();
+            emit(OP_MOVQ, target, opnd_reg(e->reg));
+            emit(e->kind == EXPR_POST_INC ? OP_ADDQ : OP_SUBQ, opnd_imm(1), target);
+            if( left->kind != EXPR_IDENT ) scratch_free(left->reg);
+            break;
+        }
+        case EXPR_NOT:
+            expr_codegen(right);
+            emit(OP_XORQ, opnd_imm(1), opnd_reg(right->reg));
+            e->reg = right->reg;
+            break;
+        case EXPR_ADD_ID:
+            expr_codegen(right);
+            e->reg = right->reg;
+            break;
+        case EXPR_ADD_INV:
+            expr_codegen(right);
+            emit1(OP_NEGQ, opnd_reg(right->reg));
+            e->reg = right->reg;
+            break;
+        case EXPR_OR:
+        case EXPR_AND:
+            expr_codegen_logical(e);
+            break;
+        case EXPR_LT:
+        case EXPR_LT_EQ:
+        case EXPR_GT:
+        case EXPR_GT_EQ:
+        case EXPR_EQ:
+        case EXPR_NOT_EQ:
+            expr_codegen_compare(e);
+            break;
+        case EXPR_ADD:
+        case EXPR_SUB:
+        case EXPR_MUL:
+        case EXPR_DIV:
+        case EXPR_MOD:
+        case EXPR_EXP:
+            expr_codegen_arith(e);
+            break;
+        default:
+            // array literals only appear as initializers, which decl_codegen stores element by element
+            diag_fatal("No code generation for %s", expr_to_str(e));
+            break;
+    }
+}
+
+void expr_codegen_address(struct expr *e){
+    /* leaves the address of array element 'e' in e->reg */
+    struct expr *array = e->data->operator_args, *index = array->next;
+    expr_codegen(array);
+    expr_codegen_spill(array, index);
+    expr_codegen(index);
+    expr_codegen_reload(array);
+    bounds_check(e, index->reg);
+
+    int stride = type_size(e->type);
+    if( stride == 8 ) emit(OP_LEAQ, opnd_mem_index(array->reg, index->reg, 8, 0), opnd_reg(array->reg));
+    else {
+        if( !codegen_opts.strength_reduce || !strength_reduce_mul(index->reg, stride) )
+            emit(OP_IMULQ, opnd_imm(stride), opnd_reg(index->reg));
+        emit(OP_ADDQ, opnd_reg(index->reg), opnd_reg(array->reg));
+    }
+    scratch_free(index->reg);
+    e->reg = array->reg;
+}
+
+void expr_codegen_store(struct expr *lvalue, struct expr *value){
+    if( lvalue->kind == EXPR_IDENT ){
+        emit(OP_MOVQ, opnd_reg(value->reg), symbol_codegen(lvalue->symbol));
+        return;
+    }
+    expr_codegen_spill(value, lvalue);
+    expr_codegen_address(lvalue);
+    expr_codegen_reload(value);
+    emit(OP_MOVQ, opnd_reg(value->reg), opnd_mem(lvalue->reg, 0));
+    scratch_free(lvalue->reg);
+}
+
+void expr_codegen_arith(struct expr *e){
+    struct expr *left = e->data->operator_args, *right = left->next;
+
+    long c;
+    bool const_right = expr_const_int(right, &c);
+    bool const_left  = !const_right && e->kind == EXPR_MUL && expr_const_int(left, &c);
+    if( codegen_opts.strength_reduce && e->kind != EXPR_ADD && e->kind != EXPR_SUB && (const_right || const_left) ){
+        // the constant only needs a register if there is no cheaper sequence for it
+        struct expr *operand = const_right ? left : right, *constant = const_right ? right : left;
+        expr_codegen(operand);
+        bool reduced = e->kind == EXPR_MUL ? strength_reduce_mul(operand->reg, c)
+                     : e->kind == EXPR_DIV ? strength_reduce_div(operand->reg, c)
+                     : e->kind == EXPR_MOD ? strength_reduce_mod(operand->reg, c)
+                     : strength_reduce_exp(operand->reg, c);
+        if( reduced ){
+            e->reg = operand->reg;
+            return;
+        }
+        expr_codegen_spill(operand, constant);
+        expr_codegen(constant);
+        expr_codegen_reload(operand);
+    }
+    else {
+        expr_codegen(left);
+        expr_codegen_spill(left, right);
+        expr_codegen(right);
+        expr_codegen_reload(left);
+    }
+
+    reg_t l = left->reg, r = right->reg;
+    switch(e->kind){
+        case EXPR_ADD:
+            emit(OP_ADDQ, opnd_reg(r), opnd_reg(l));
+            break;
+        case EXPR_SUB:
+            emit(OP_SUBQ, opnd_reg(r), opnd_reg(l));
+            break;
+        case EXPR_MUL:
+            emit(OP_IMULQ, opnd_reg(r), opnd_reg(l));
+            break;
+        case EXPR_DIV:
+        case EXPR_MOD:
+            // quotient in %rax, remainder in %rdx
+            emit(OP_MOVQ, opnd_reg(l), opnd_reg(REG_RAX));
+            emit0(OP_CQO);
+            emit1(OP_IDIVQ, opnd_reg(r));
+            emit(OP_MOVQ, opnd_reg(e->kind == EXPR_DIV ? REG_RAX : REG_RDX), opnd_reg(l));
+            break;
+        default:
+            expr_codegen_exp_loop(l, r);
+            break;
+    }
+    scratch_free(r);
+    e->reg = l;
+}
+
+void expr_codegen_exp_loop(reg_t base, reg_t exponent){
+    /* square-and-multiply over the bits of 'exponent', leaving the power in 'base': non-positive exponents give 1 */
+    reg_t result = scratch_alloc();
+    const char *top = label_create(), *skip = label_create(), *done = label_create();
+    emit(OP_MOVQ, opnd_imm(1), opnd_reg(result));
+    emit_label(top);
+    emit(OP_TESTQ, opnd_reg(exponent), opnd_reg(exponent));
+    emit1(OP_JLE, opnd_label(done));
+    emit(OP_TESTQ, opnd_imm(1), opnd_reg(exponent));
+    emit1(OP_JE, opnd_label(skip));
+    emit(OP_IMULQ, opnd_reg(base), opnd_reg(result));
+    emit_label(skip);
+    emit(OP_IMULQ, opnd_reg(base), opnd_reg(base));
+    emit(OP_SARQ, opnd_imm(1), opnd_reg(exponent));
+    emit1(OP_JMP, opnd_label(top));
+    emit_label(done);
+    emit(OP_MOVQ, opnd_reg(result), opnd_reg(base));
+    scratch_free(result);
+}
+
+void expr_codegen_compare(struct expr *e){
+    struct expr *left = e->data->operator_args, *right = left->next;
+    expr_codegen(left);
+    expr_codegen_spill(left, right);
+    expr_codegen(right);
+    expr_codegen_reload(left);
+
+    opcode_t set;
+    switch(e->kind){
+        case EXPR_LT:       set = OP_SETL;  break;
+        case EXPR_LT_EQ:    set = OP_SETLE; break;
+        case EXPR_GT:       set = OP_SETG;  break;
+        case EXPR_GT_EQ:    set = OP_SETGE; break;
+        case EXPR_EQ:       set = OP_SETE;  break;
+        default:            set = OP_SETNE; break;
+    }
+
+    if( left->type->kind == TYPE_STRING ){
+        // strings are equal by content
+        emit(OP_MOVQ, opnd_reg(left->reg), opnd_reg(REG_RDI));
+        emit(OP_MOVQ, opnd_reg(right->reg), opnd_reg(REG_RSI));
+        scratch_free(left->reg);
+        scratch_free(right->reg);
+        codegen_call("strcmp");
+        e->reg = scratch_alloc();
+        // strcmp returns an int
+        emit0(OP_CLTQ);
+        emit(OP_CMPQ, opnd_imm(0), opnd_reg(REG_RAX));
+    }
+    else {
+        emit(OP_CMPQ, opnd_reg(right->reg), opnd_reg(left->reg));
+        scratch_free(right->reg);
+        e->reg = left->reg;
+    }
+    emit1(set, opnd_reg8(e->reg));
+    emit(OP_MOVZBQ, opnd_reg8(e->reg), opnd_reg(e->reg));
+}
+
+void expr_codegen_logical(struct expr *e){
+    /* short-circuits: the right operand is only evaluated when the left one does not decide the result */
+    struct expr *left = e->data->operator_args, *right = left->next;
+    const char *done = label_create();
+    expr_codegen(left);
+    emit(OP_TESTQ, opnd_reg(left->reg), opnd_reg(left->reg));
+    emit1(e->kind == EXPR_AND ? OP_JE : OP_JNE, opnd_label(done));
+    // the left value isn't needed past the jump: if the right operand needs its register, it is only taken back for the result,
+    // which has to be where the jump leaves it
+    bool lent = expr_codegen_short(right);
+    if( lent ) scratch_free(left->reg);
+    expr_codegen(right);
+    if( right->reg != left->reg ){
+        if( lent ) scratch_claim(left->reg);
+        emit(OP_MOVQ, opnd_reg(right->reg), opnd_reg(left->reg));
+        scratch_free(right->reg);
+    }
+    emit_label(done);
+    e->reg = left->reg;
+}
+
+void expr_codegen_call(struct expr *e){
+    /* arguments are all evaluated before any is moved into its argument register, so nested calls cannot clobber them */
+    if( inline_call_ok(e) ){
+        inline_codegen_call(e);
+        return;
+    }
+    struct expr *callee = e->data->func_and_args;
+    int mark = frame_mark();
+    expr_codegen_args(callee->next);
+    // a function defined elsewhere may write to stdout: what print has buffered goes first
+    if( !callee->symbol->definition ) codegen_call(RUNTIME_FLUSH);
+    int i = 0;
+    for( struct expr *arg = callee->next; arg; arg = arg->next, i++ ){
+        // a spilled argument goes straight from its slot
+        emit(OP_MOVQ, arg->spill ? opnd_mem(REG_RBP, arg->spill) : opnd_reg(arg->reg), opnd_reg(codegen_arg_reg(i)));
+        if( !arg->spill ) scratch_free(arg->reg);
+        arg->spill = 0;
+    }
+    frame_release(mark);
+    // the typechecker only admits calls of declared functions
+    codegen_call(callee->symbol->name);
+    e->reg = scratch_alloc();
+    emit(OP_MOVQ, opnd_reg(REG_RAX), opnd_reg(e->reg));
+}
+
+void expr_codegen_args(struct expr *args){
+    for( struct expr *arg = args; arg; arg = arg->next ){
+        // the arguments evaluated so far are spilled, first to last, until this one has the registers it needs
+        for( struct expr *held = args; held != arg; held = held->next )
+            if( !held->spill ) expr_codegen_spill(held, arg);
+        expr_codegen(arg);
+    }
+}
+
+int expr_codegen_regs(struct expr *e){
+    /* operands are measured into locals first: MAX evaluates its arguments twice, which would make this exponential */
+    if( !e ) return 0;
+
+    int need = 0, held = 0;
+    switch(e->kind){
+        case EXPR_EMPTY:
+            return 0;
+        case EXPR_IDENT:
+        case EXPR_INT_LIT:
+        case EXPR_STR_LIT:
+        case EXPR_CHAR_LIT:
+        case EXPR_BOOL_LIT:
+            return 1;
+        case EXPR_ARR_LIT:
+            // only in initializers, which store one element at a time
+            for( struct expr *el = e->data->arr_elements; el; el = el->next ){
+                int n = expr_codegen_regs(el);
+                need = MAX(need, n);
+            }
+            return need;
+        case EXPR_FUNC_CALL:
+            // the arguments evaluated so far stay in registers
+            for( struct expr *arg = e->data->func_and_args->next; arg; arg = arg->next, held++ ){
+                int n = held + expr_codegen_regs(arg);
+                need = MAX(need, n);
+            }
+            return MAX(need, 1);
+        default: {
+            // the left operand is held while the right one is evaluated, and some operators take a temporary besides both
+            struct expr *left = e->data->operator_args;
+            int l = expr_codegen_regs(left), r = 1 + expr_codegen_regs(left->next);
+            need = MAX(l, r);
+            return MAX(need, 3);
+        }
+    }
+}
+
+bool expr_codegen_short(struct expr *next){
+    /* whether generating 'next' needs registers in use: never with the reserve free, so 'next' is only measured without it */
+    return scratch_available() < SCRATCH_RESERVE && scratch_available() < expr_codegen_regs(next);
+}
+
+void expr_codegen_spill(struct expr *held, struct expr *next){
+    /* 'held' keeps its value while 'next' is generated: in a frame slot rather than its register if 'next' needs the register */
+    if( expr_codegen_short(next) ) held->spill = scratch_spill(held->reg);
+}
+
+void expr_codegen_reload(struct expr *held){
+    if( !held->spill ) return;
+    held->reg   = scratch_reload(held->spill);
+    held->spill = 0;
+}
+
+void expr_print(struct expr *e){
+    if (!e) return;
+
+    switch(e->kind){
+        case EXPR_EMPTY:
+            break;
+        case EXPR_ARR_ACC:
+            // expecting exactly two arguments: expression resolving to array and indexing expression
+            expr_print_list(e->data->operator_args, "[");
+            fputs("]", out_stream);
+            break;
+        case EXPR_ARR_LIT:
+            fputs("{", out_stream);
+            expr_print_list(e->data->arr_elements, ", ");
+            fputs("}", out_stream);
+            break;
+        case EXPR_FUNC_CALL:
+            expr_print(e->data->func_and_args);
+            fputs("(", out_stream);
+            expr_print_list(e->data->func_and_args->next, ", ");
+            fputs(")", out_stream);
+            break;
+        case EXPR_IDENT:
+            fputs(e->data->ident_name, out_stream);
+            break;
+        case EXPR_INT_LIT:
+            fprintf(out_stream, "%d", e->data->int_data);
+            break;
+        case EXPR_STR_LIT:
+            // revrese clean string function from scanner
+            descape_and_print_str_lit(e->data->str_data);
+            break;
+        case EXPR_CHAR_LIT:
+            descape_and_print_char_lit(e->data->char_data);
+            break;
+        case EXPR_BOOL_LIT:
+            fputs(e->data->bool_data ? "true" : "false", out_stream);
+            break;
+        default:
+            //operators
+            /* this printing code is made elegant by allowing the AST to have empty nodes */
+            expr_print_subexpr(e->data->operator_args, e->kind, false);
+            fputs(expr_oper_str(e->kind), out_stream);
+            expr_print_subexpr(e->data->operator_args->next, e->kind, true);
+            break;
+    }
+}
+
+void expr_print_subexpr(struct expr *e, expr_t parent_oper, bool right_oper){ 
+    if (!e || e->kind == EXPR_EMPTY) return;
+
+    // if parent operator is non-commutative and we are the operand opposite the associativy of the operator, wrap in parens ( a - (b - c) | (a = b) = c or (a = &b) = c )
+    // to see relevance, consider the cases | (3+4)*5 | a - -b | - -(a - - b) |
+    bool wrap_in_parens = expr_precedence(parent_oper) > expr_precedence(e->kind)
+        || (parent_oper == e->kind && (parent_oper == EXPR_ADD_INV || parent_oper == EXPR_ADD_ID))
+        // now that I include spaces in my expressions, parentheses are not strictly necessary in this case
+        //|| (parent_oper == EXPR_ADD && e->kind == EXPR_ADD_ID)
+        //|| (parent_oper == EXPR_SUB && e->kind == EXPR_ADD_INV)
+        || (parent_oper == e->kind
+                && expr_fixity(parent_oper) == FIX_BINARY
+                && !expr_commutative(parent_oper)
+                && expr_right_assoc(parent_oper) != right_oper);
+    if (wrap_in_parens) fputs("(", out_stream);
+    expr_print(e);
+    if (wrap_in_parens) fputs(")", out_stream);
+}
+
+void expr_print_list(struct expr *e, char *delim){
+    if(!e) return;
+    
+    expr_print(e);
+    if (e->next) fputs(delim, out_stream);
+    expr_print_list(e->next, delim);
+}
+
+char *descape_char(char c, char delim, char *clean){
+    /* writes the source spelling of 'c' inside a literal delimited by 'delim' into 'clean', which must hold 3 chars */
+    char *writer = clean;
+    switch(c){
+        case '\n':
+            *(writer)    = '\\';
+            *(++writer)  = 'n';
+            break;
+        case '\0':
+            *(writer)    = '\\';
+            *(++writer)  = '0';
+            break;
+        case '\\':
+            *(writer)    = '\\';
+            *(++writer)  = '\\';
+            break;
+        default:
+            if(c == delim){
+                *(writer)    = '\\';
+                *(++writer)  = delim;
+            }
+            else  *(writer)    = c;
+            break;
+    }
+    *(++writer) = '\0';
+    return clean;
+}
+
+void descape_and_print_char_lit(char c){
+    char clean[3];
+    fputc('\'', out_stream);
+    fputs(descape_char(c, '\'', clean), out_stream);
+    fputc('\'', out_stream);
+}
+
+void descape_and_print_str_lit(struct str_lit *lit){
+    fputc('"', out_stream);
+    // a literal written without escapes has nothing needing one: print the source span as is
+    if (!lit->has_escapes)
+        fwrite(lit->src, 1, lit->src_len, out_stream);
+    else {
+        const char *bytes = str_lit_bytes(lit);
+        char clean[3];
+        for (int i = 0; i < lit->len; i++)
+            fputs(descape_char(bytes[i], '"', clean), out_stream);
+    }
+    fputc('"', out_stream);
+}
@@ -2,46 +2,83 @@
 #define EXPR_H
 
 #include "symbol.h"
+#include "str_lit.h"
 #include <stdbool.h>
 
 typedef enum {
-    /* EXPR_NAME       @ precedence @   commutative? @  associativity @   string  @ */
-    EXPR_EMPTY,     // @    11      @                @                @           @
-    EXPR_ASGN,      // @    1       @   no           @   right        @   " = "   @
-    EXPR_OR,        // @    2       @   yes          @   left         @   " || "  @
-    EXPR_AND,       // @    3       @   yes          @   left         @   " && "  @
-    EXPR_LT,        // @    4       @   yes          @   left         @   " < "   @
-    EXPR_LT_EQ,     // @    4       @   yes          @   left         @   " <= "  @
-    EXPR_GT,        // @    4       @   yes          @   left         @   " > "   @
-    EXPR_GT_EQ,     // @    4       @   yes          @   left         @   " >= "  @
-	EXPR_EQ,        // @    4       @   yes          @   left         @   " == "  @
-	EXPR_NOT_EQ,    // @    4       @   yes          @   left         @   " != "  @
-    EXPR_ADD,       // @    5       @   yes          @   left         @   " + "   @
-    EXPR_SUB,       // @    5       @   no           @   left         @   " - "   @  
-	EXPR_MUL,       // @    6       @   yes          @   left         @   " * "   @
-	EXPR_DIV,       // @    6       @   no           @   left         @   " / "   @ 
-    EXPR_MOD,       // @    6       @   no           @   left         @   " % "   @ 
-    EXPR_EXP,       // @    7       @   no           @   left         @   " ^ "   @ 
-    EXPR_NOT,       // @    8       @                @                @   "!"     @  
-    EXPR_ADD_ID,    // @    8       @                @                @   "+"     @
-    EXPR_ADD_INV,   // @    8       @                @                @   "-"     @
-    EXPR_POST_INC,  // @    9       @                @                @   "++"    @
-    EXPR_POST_DEC,  // @    9       @                @                @   "--"    @
-    EXPR_ARR_ACC,   // @    10      @                @                @           @ 
-    EXPR_ARR_LIT,   // @    10      @                @                @           @
-    EXPR_FUNC_CALL, // @    10      @                @                @           @
-    EXPR_IDENT,     // @    10      @                @                @           @
-    EXPR_INT_LIT,   // @    10      @                @                @           @
-    EXPR_STR_LIT,   // @    10      @                @                @           @
-    EXPR_CHAR_LIT,  // @    10      @                @                @           @
-    EXPR_BOOL_LIT   // @    10      @                @                @           @
+    FIX_NONE,       // not an operator: atoms, grouping, calls
+    FIX_PREFIX,
+    FIX_POSTFIX,
+    FIX_BINARY
+} fixity_t;
+
+/* Operator descriptor table: the single source of truth for expr_t and for the per-operator data the parser, printer and optimizers use.
+ * Each row expands, in order, into an expr_t enumerator and an entry of expr_opers below.
+ *      name                precedence  fixity          commutative     right assoc     string      */
+#define EXPR_TABLE(X) \
+    X(EXPR_EMPTY,           11,         FIX_NONE,       false,          false,          ""      ) \
+    X(EXPR_ASGN,            1,          FIX_BINARY,     false,          true,           " = "   ) \
+    X(EXPR_OR,              2,          FIX_BINARY,     true,           false,          " || "  ) \
+    X(EXPR_AND,             3,          FIX_BINARY,     true,           false,          " && "  ) \
+    X(EXPR_LT,              4,          FIX_BINARY,     true,           false,          " < "   ) \
+    X(EXPR_LT_EQ,           4,          FIX_BINARY,     true,           false,          " <= "  ) \
+    X(EXPR_GT,              4,          FIX_BINARY,     true,           false,          " > "   ) \
+    X(EXPR_GT_EQ,           4,          FIX_BINARY,     true,           false,          " >= "  ) \
+    X(EXPR_EQ,              4,          FIX_BINARY,     true,           false,          " == "  ) \
+    X(EXPR_NOT_EQ,          4,          FIX_BINARY,     true,           false,          " != "  ) \
+    X(EXPR_ADD,             5,          FIX_BINARY,     true,           false,          " + "   ) \
+    X(EXPR_SUB,             5,          FIX_BINARY,     false,          false,          " - "   ) \
+    X(EXPR_MUL,             6,          FIX_BINARY,     true,           false,          " * "   ) \
+    X(EXPR_DIV,             6,          FIX_BINARY,     false,          false,          " / "   ) \
+    X(EXPR_MOD,             6,          FIX_BINARY,     false,          false,          " % "   ) \
+    X(EXPR_EXP,             7,          FIX_BINARY,     false,          false,          " ^ "   ) \
+    X(EXPR_NOT,             8,          FIX_PREFIX,     false,          false,          "!"     ) \
+    X(EXPR_ADD_ID,          8,          FIX_PREFIX,     false,          false,          "+"     ) \
+    X(EXPR_ADD_INV,         8,          FIX_PREFIX,     false,          false,          "-"     ) \
+    X(EXPR_POST_INC,        9,          FIX_POSTFIX,    false,          false,          "++"    ) \
+    X(EXPR_POST_DEC,        9,          FIX_POSTFIX,    false,          false,          "--"    ) \
+    X(EXPR_ARR_ACC,         10,         FIX_NONE,       false,          false,          ""      ) \
+    X(EXPR_ARR_LIT,         10,         FIX_NONE,       false,          false,          ""      ) \
+    X(EXPR_FUNC_CALL,       10,         FIX_NONE,       false,          false,          ""      ) \
+    X(EXPR_IDENT,           10,         FIX_NONE,       false,          false,          ""      ) \
+    X(EXPR_INT_LIT,         10,         FIX_NONE,       false,          false,          ""      ) \
+    X(EXPR_STR_LIT,         10,         FIX_NONE,       false,          false,          ""      ) \
+    X(EXPR_CHAR_LIT,        10,         FIX_NONE,       false,          false,          ""      ) \
+    X(EXPR_BOOL_LIT,        10,         FIX_NONE,       false,          false,          ""      )
+
+typedef enum {
+#define EXPR_ENUM(name, prec, fix, comm, right, str) name,
+    EXPR_TABLE(EXPR_ENUM)
+#undef EXPR_ENUM
+    EXPR_KIND_COUNT
 } expr_t;
 
+struct expr_oper {
+    int         precedence;
+    fixity_t    fixity;
+    bool        commutative;
+    bool        right_assoc;
+    const char *str;
+};
+
+/* static so every lookup with a known kind folds to a constant, and an unknown one is a single indexed load */
+static const struct expr_oper expr_opers[EXPR_KIND_COUNT] = {
+#define EXPR_OPER(name, prec, fix, comm, right, str) [name] = { prec, fix, comm, right, str },
+    EXPR_TABLE(EXPR_OPER)
+#undef EXPR_OPER
+};
+
+static inline int         expr_precedence( expr_t kind )  { return expr_opers[kind].precedence; }
+static inline fixity_t    expr_fixity( expr_t kind )      { return expr_opers[kind].fixity; }
+static inline bool        expr_commutative( expr_t kind ) { return expr_opers[kind].commutative; }
+static inline bool        expr_right_assoc( expr_t kind ) { return expr_opers[kind].right_assoc; }
+static inline const char *expr_oper_str( expr_t kind )    { return expr_opers[kind].str; }
+
 union expr_data {
     /* mutually exclusive data fields involved in an expression
      * allows the access of different fields by intuitive names
      *  - ident_name: identifier name
-     *  - str_data: string literal data
+     *  - str_data: string literal, still as a span of the source (see str_lit.h)
      *  - int_data: integer literal data
      *  - char_data: char literal data
      *  - bool_data: boolean literal data
@@ -51,7 +88,7 @@ union expr_data {
      *  Once I decided to use a union I might as well define fields of the same type that have more intuitive names: I never store anything extra in my union as a reuslt (which was my qualm with the struct with many NULL fields: felt like it could be simplified)
     */
     const char *ident_name;
-    const char *str_data;
+    struct str_lit *str_data;
     int   int_data;
     char  char_data;
     bool  bool_data;
@@ -63,9 +100,20 @@ union expr_data {
 struct expr {
 	/* used by all kinds of exprs */
 	expr_t kind;
+    // where an identifier is in the source (1-based; 0 for other kinds, and for nodes the compiler made up): see 'column'
+    int line;
     union expr_data *data;
 	struct symbol *symbol;
     struct expr *next;
+    // set by the typechecker: NULL if the expression has a type error
+    struct type *type;
+    // register holding the value during codegen (a reg_t, see codegen.h)
+    int reg;
+    int column;
+    // %rbp-relative slot holding the value, computed before the loop it is invariant in (see licm.h): 0 otherwise
+    int hoisted;
+    // %rbp-relative slot the value is spilled to while the registers are needed (see scratch_spill): 0 otherwise
+    int spill;
 };
 
 struct expr * expr_create( expr_t kind, union expr_data *data);
@@ -75,7 +123,7 @@ struct expr * expr_create_identifier( const char *ident );
 struct expr * expr_create_integer_literal( int c );
 struct expr * expr_create_boolean_literal( bool b );
 struct expr * expr_create_char_literal( char c );
-struct expr * expr_create_string_literal( const char *str );
+struct expr * expr_create_string_literal( struct str_lit lit );
 struct expr * expr_create_array_literal( struct expr *expr_list );
 struct expr * expr_create_array_access( struct expr *array, struct expr *index );
 struct expr * expr_create_function_call( struct expr *function, struct expr *arg_list );
@@ -87,4 +135,22 @@ void expr_print_list( struct expr *e, char *delim );
 struct scope;
 int expr_resolve( struct expr *e, struct scope *sc, bool verbose );
 
+/* typechecks 'e' and its operands (not e->next), setting their 'type': returns the number of type errors */
+int  expr_typecheck( struct expr *e );
+/* like expr_typecheck, but also accepts array literals (nested ones included): the typechecker of a declaration's initializer */
+int  expr_typecheck_initializer( struct expr *e );
+/* whether 'e' can initialize a global: a literal, a negated integer literal, or an array literal of such */
+bool expr_is_constant( struct expr *e );
+/* value of an integer literal, possibly under unary +/-: false if 'e' is not one */
+bool expr_const_int( struct expr *e, long *val );
+/* printed form of 'e' for diagnostics (arena allocated) */
+char *expr_to_str( struct expr *e );
+
+/* generates code leaving the value of 'e' in scratch register e->reg (none for an empty expression) */
+void expr_codegen( struct expr *e );
+/* generates the arguments 'args' of a call, leaving each in its register or, if spilled, in its 'spill' slot */
+void expr_codegen_args( struct expr *args );
+/* scratch registers expr_codegen takes for 'e' (not e->next) if it spills nothing */
+int  expr_codegen_regs( struct expr *e );
+
 #endif
@@ -0,0 +1,150 @@
+#include "flat.h"
+#include "scope.h"
+#include "diag.h"
+#include "output.h"
+#include "arena.h"
+#include <string.h>
+
+bool resolve_flat = false;
+
+/* list being flattened, and the indices of the roots of operands it has not attached to their operator yet */
+static struct flat_expr *flat = NULL;
+static uint32_t *pending = NULL;
+static uint32_t pending_count = 0;
+/* operands attached so far */
+static uint32_t edges = 0;
+
+/* totals over every list flattened, for flat_stats */
+static unsigned long total_nodes = 0;
+static size_t total_bytes = 0, total_tree_bytes = 0;
+
+/* internal helpers */
+void flat_count(struct expr *e, uint32_t *nodes, uint32_t *idents, uint32_t *strings);
+void flat_emit(struct expr *e);
+bool flat_operand(struct expr *op, struct expr *e);
+
+struct flat_expr *flat_create(struct expr *e){
+    uint32_t nodes = 0, idents = 0, strings = 0, roots = 0;
+    for( struct expr *r = e; r; r = r->next, roots++ ) flat_count(r, &nodes, &idents, &strings);
+
+    flat = arena_alloc(sizeof(*flat));
+    memset(flat, 0, sizeof(*flat));
+    flat->kinds    = arena_alloc(nodes * sizeof(*flat->kinds));
+    flat->first    = arena_alloc((nodes + 1) * sizeof(*flat->first));
+    // every node but the roots is the operand of one other
+    flat->operands = arena_alloc((nodes - roots) * sizeof(*flat->operands));
+    flat->values   = arena_alloc(nodes * sizeof(*flat->values));
+    flat->roots    = arena_alloc(roots * sizeof(*flat->roots));
+    flat->idents   = arena_alloc(idents * sizeof(*flat->idents));
+    flat->strings  = arena_alloc(strings * sizeof(*flat->strings));
+    pending        = arena_alloc(nodes * sizeof(*pending));
+    pending_count  = edges = 0;
+
+    for( struct expr *r = e; r; r = r->next ){
+        flat_emit(r);
+        flat->roots[flat->root_count++] = pending[--pending_count];
+    }
+    flat->first[flat->count] = edges;
+
+    total_nodes      += flat->count;
+    total_bytes      += flat_size(flat);
+    total_tree_bytes += flat_tree_size(e);
+    return flat;
+}
+
+int flat_resolve(struct flat_expr *f, struct scope *sc, bool verbose){
+    /* identifiers are numbered in the order expr_resolve reaches them, so the reports come out in the same order */
+    int err_count = 0;
+    for( uint32_t i = 0; i < f->ident_count; i++ ){
+        struct flat_ident *id = &f->idents[i];
+        id->symbol = id->node->symbol = scope_lookup(sc, id->name, false);
+        if( !id->symbol ){
+            diag_report(DIAG_RESOLVE, 0, "Variable %s used before declaration", id->name);
+            err_count++;
+        }
+        else if( verbose ){
+            fprintf(out_stream, "Variable %s resolved to ", id->name);
+            symbol_print(id->symbol);
+            fputs("\n", out_stream);
+        }
+    }
+    return err_count;
+}
+
+size_t flat_size(struct flat_expr *f){
+    return sizeof(*f) + f->count * (sizeof(*f->kinds) + sizeof(*f->first) + sizeof(*f->values)) + sizeof(*f->first)
+         + (f->count - f->root_count) * sizeof(*f->operands) + f->root_count * sizeof(*f->roots)
+         + f->ident_count * sizeof(*f->idents) + f->string_count * sizeof(*f->strings);
+}
+
+size_t flat_tree_size(struct expr *e){
+    /* the nodes and their data, placeholders included: literals' text is shared with the flattened form */
+    size_t bytes = 0;
+    for( ; e; e = e->next ){
+        bytes += sizeof(*e);
+        if( !e->data ) continue;
+        bytes += sizeof(*e->data);
+        if( e->kind == EXPR_IDENT || e->kind == EXPR_INT_LIT || e->kind == EXPR_STR_LIT
+         || e->kind == EXPR_CHAR_LIT || e->kind == EXPR_BOOL_LIT ) continue;
+        bytes += flat_tree_size(e->data->operator_args);
+    }
+    return bytes;
+}
+
+void flat_stats(FILE *f){
+    fprintf(f, "Flattened expressions: %lu nodes in %zu bytes, %zu bytes as trees\n", total_nodes, total_bytes, total_tree_bytes);
+}
+
+void flat_count(struct expr *e, uint32_t *nodes, uint32_t *idents, uint32_t *strings){
+    (*nodes)++;
+    switch( e->kind ){
+        case EXPR_IDENT:    (*idents)++;    return;
+        case EXPR_STR_LIT:  (*strings)++;   return;
+        case EXPR_EMPTY: case EXPR_INT_LIT: case EXPR_CHAR_LIT: case EXPR_BOOL_LIT:
+            return;
+        default:
+            for( struct expr *op = e->data->operator_args; op; op = op->next )
+                if( flat_operand(op, e) ) flat_count(op, nodes, idents, strings);
+    }
+}
+
+void flat_emit(struct expr *e){
+    /* emits the operands, then 'e' taking their roots off 'pending', and leaves its own index there */
+    uint32_t arity = 0;
+    int32_t value = 0;
+    switch( e->kind ){
+        case EXPR_IDENT:
+            value = flat->ident_count;
+            flat->idents[flat->ident_count++] = (struct flat_ident) { e->data->ident_name, NULL, e };
+            break;
+        case EXPR_STR_LIT:
+            value = flat->string_count;
+            flat->strings[flat->string_count++] = e->data->str_data;
+            break;
+        case EXPR_INT_LIT:  value = e->data->int_data;  break;
+        case EXPR_CHAR_LIT: value = e->data->char_data; break;
+        case EXPR_BOOL_LIT: value = e->data->bool_data; break;
+        case EXPR_EMPTY:    break;
+        default:
+            for( struct expr *op = e->data->operator_args; op; op = op->next ){
+                if( !flat_operand(op, e) ) continue;
+                flat_emit(op);
+                arity++;
+            }
+    }
+
+    uint32_t n = flat->count++;
+    flat->kinds[n]  = e->kind;
+    flat->values[n] = value;
+    flat->first[n]  = edges;
+    pending_count  -= arity;
+    memcpy(flat->operands + edges, pending + pending_count, arity * sizeof(*pending));
+    edges += arity;
+    pending[pending_count++] = n;
+}
+
+bool flat_operand(struct expr *op, struct expr *e){
+    /* whether 'op' of 'e' is an operand proper, not the placeholder on the other side of a unary operator */
+    fixity_t fix = expr_fixity(e->kind);
+    return !((fix == FIX_PREFIX || fix == FIX_POSTFIX) && op->kind == EXPR_EMPTY);
+}
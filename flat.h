@@ -0,0 +1,56 @@
+#ifndef FLAT_H
+#define FLAT_H
+
+#include "expr.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Flattened expressions (-flat): an expression list laid out as arrays indexed by node, rather than as nodes linked by
+   pointers. Nodes are in post order, so a node's operands all come before it and a pass that only needs its operands'
+   results is a loop from the first node to the last. Kinds, payloads and operand ranges are separate arrays, so a pass reads
+   only the ones it uses; operands are 32-bit node indices. The tree's placeholder operands of unary operators are dropped.
+   Identifiers and string literals are numbered, in source order, into tables of their own, which is what resolution reads:
+   it looks each name up without visiting any other node. */
+
+struct flat_ident {
+    const char    *name;
+    // set by flat_resolve
+    struct symbol *symbol;
+    // the identifier in the tree: the passes after resolution still read the symbol there
+    struct expr   *node;
+};
+
+struct flat_expr {
+    uint32_t            count;
+    // expr_t of each node
+    uint8_t            *kinds;
+    // the operands of node i are operands[first[i]] to operands[first[i + 1] - 1] (count + 1 entries)
+    uint32_t           *first;
+    uint32_t           *operands;
+    // literal value, or for an identifier or string literal its index in 'idents' or 'strings'
+    int32_t            *values;
+    // the last node of each expression of the list
+    uint32_t           *roots;
+    uint32_t            root_count;
+    struct flat_ident  *idents;
+    uint32_t            ident_count;
+    struct str_lit    **strings;
+    uint32_t            string_count;
+};
+
+/* under -flat, expr_resolve resolves through flattened expressions (see expr.c) */
+extern bool resolve_flat;
+
+/* lays out the list 'e' (e, e->next, ...) flattened, in the arena */
+struct flat_expr *flat_create( struct expr *e );
+/* resolves the identifiers of 'f' in scope 'sc' as expr_resolve does the list it was made from, with the same reports, and
+   sets their symbols in the tree too: returns the number of errors */
+int               flat_resolve( struct flat_expr *f, struct scope *sc, bool verbose );
+/* bytes 'f' takes, and bytes the trees it was made from take */
+size_t            flat_size( struct flat_expr *f );
+size_t            flat_tree_size( struct expr *e );
+/* prints how much smaller the expressions flattened so far were than their trees */
+void              flat_stats( FILE *f );
+
+#endif
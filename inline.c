@@ -0,0 +1,210 @@
+#include "inline.h"
+#include "codegen.h"
+#include "stmt.h"
+#include "arena.h"
+#include "diag.h"
+#include <stdlib.h>
+
+#define MAX(a, b)   ((a) > (b) ? (a) : (b))
+
+/* calls inlined since inline_plan, for the report: in program order, as added when their callers are merged (codegen_defer) */
+struct inline_site {
+    const char *caller;
+    const char *callee;
+    int         size;
+    struct inline_site *next;
+};
+static struct inline_site *sites = NULL, *sites_tail = NULL;
+static int site_count = 0;
+
+/* functions whose bodies the recursion search has been through */
+struct visited {
+    struct symbol **syms;
+    int count, cap;
+};
+
+/* internal helpers */
+struct expr *inline_operands(struct expr *e);
+int  inline_size_expr(struct expr *e);
+int  inline_size_stmt(struct stmt *s);
+int  inline_regs_stmt(struct stmt *s);
+bool inline_reaches_expr(struct expr *e, struct symbol *target, struct visited *v);
+bool inline_reaches_stmt(struct stmt *s, struct symbol *target, struct visited *v);
+void inline_site_add(void *site);
+
+void inline_plan(struct decl *ast){
+    sites = sites_tail = NULL;
+    site_count = 0;
+
+    for( struct decl *d = ast; d; d = d->next ){
+        if( !d->symbol || d->symbol->definition != d ) continue;
+        d->symbol->inline_info = NULL;
+        // a profile counts and times every call the program makes
+        if( codegen_opts.inline_budget <= 0 || codegen_opts.profile ) continue;
+
+        int size = inline_size_stmt(d->func_body);
+        if( size > codegen_opts.inline_budget ) continue;
+        // a function that can call itself would be inlined into its own body without end
+        struct visited v = { NULL, 0, 0 };
+        bool recursive = inline_reaches_stmt(d->func_body, d->symbol, &v);
+        free(v.syms);
+        if( recursive ) continue;
+
+        struct inline_info *info = arena_alloc(sizeof(*info));
+        info->size = size;
+        info->regs = inline_regs_stmt(d->func_body);
+        if( pthread_mutex_init(&info->lock, NULL) ) diag_fatal("Could not create the lock of %s", d->ident);
+        d->symbol->inline_info = info;
+    }
+}
+
+bool inline_call_ok(struct expr *e){
+    struct inline_info *info = e->data->func_and_args->symbol->inline_info;
+    return info && info->regs <= scratch_available();
+}
+
+void inline_codegen_call(struct expr *e){
+    struct expr *callee = e->data->func_and_args;
+    struct decl *def = callee->symbol->definition;
+
+    // recorded before the body is generated: outer calls are listed before the ones inlined into them
+    struct inline_site *site = arena_alloc(sizeof(*site));
+    site->caller = codegen_function_name();
+    site->callee = def->ident;
+    site->size   = callee->symbol->inline_info->size;
+    site->next   = NULL;
+    codegen_defer(inline_site_add, site);
+
+    // the parameters and locals live as long as the inlined body: the next call inlined here can have their slots
+    int mark = frame_mark();
+    // as for a call, every argument is evaluated before any parameter is stored
+    expr_codegen_args(callee->next);
+    inline_lock(def);
+    struct decl *p = def->type->params;
+    for( struct expr *arg = callee->next; arg; arg = arg->next, p = p->next ){
+        // a spilled argument's slot already holds the parameter
+        p->symbol->frame_offset = arg->spill ? arg->spill : frame_alloc(8);
+        if( !arg->spill ){
+            emit(OP_MOVQ, opnd_reg(arg->reg), opnd_mem(REG_RBP, p->symbol->frame_offset));
+            scratch_free(arg->reg);
+        }
+        arg->spill = 0;
+    }
+    frame_alloc_locals(def->func_body);
+
+    // returns leave their value in %rax, as in the function itself, and jump past the body
+    const char *done  = label_create();
+    const char *outer = codegen_set_return_label(done);
+    stmt_codegen(def->func_body);
+    codegen_set_return_label(outer);
+    frame_release(mark);
+    inline_unlock(def);
+    emit(OP_MOVQ, opnd_imm(0), opnd_reg(REG_RAX));
+    emit_label(done);
+    e->reg = scratch_alloc();
+    emit(OP_MOVQ, opnd_reg(REG_RAX), opnd_reg(e->reg));
+}
+
+void inline_lock(struct decl *d){
+    if( d->symbol->inline_info ) pthread_mutex_lock(&d->symbol->inline_info->lock);
+}
+
+void inline_unlock(struct decl *d){
+    if( d->symbol->inline_info ) pthread_mutex_unlock(&d->symbol->inline_info->lock);
+}
+
+void inline_site_add(void *site){
+    struct inline_site *s = site;
+    if( sites_tail ) sites_tail->next = s;
+    else             sites = s;
+    sites_tail = s;
+    site_count++;
+}
+
+void inline_report(FILE *f){
+    for( struct inline_site *s = sites; s; s = s->next )
+        fprintf(f, "Inlined %s into %s (%d nodes)\n", s->callee, s->caller, s->size);
+    fprintf(f, "Inlined %d call%s\n", site_count, site_count == 1 ? "" : "s");
+}
+
+struct expr *inline_operands(struct expr *e){
+    switch(e->kind){
+        case EXPR_ARR_LIT:      return e->data->arr_elements;
+        case EXPR_FUNC_CALL:    return e->data->func_and_args;
+        case EXPR_ARR_ACC:      return e->data->operator_args;
+        default:                return expr_fixity(e->kind) != FIX_NONE ? e->data->operator_args : NULL;
+    }
+}
+
+/* size ================================================================== */
+
+int inline_size_expr(struct expr *e){
+    /* nodes in the list 'e' and their operands */
+    int size = 0;
+    for( ; e; e = e->next ) size += 1 + inline_size_expr(inline_operands(e));
+    return size;
+}
+
+int inline_size_stmt(struct stmt *s){
+    int size = 0;
+    for( ; s; s = s->next ){
+        size += 1 + inline_size_expr(s->expr_list) + inline_size_stmt(s->body);
+        if( s->decl ) size += 1 + inline_size_expr(s->decl->init_value);
+    }
+    return size;
+}
+
+/* scratch registers ===================================================== */
+
+int inline_regs_stmt(struct stmt *s){
+    /* statements free their registers before the next one starts: the most any single expression needs */
+    int need = 0;
+    for( ; s; s = s->next ){
+        // measured into 'n' first: MAX evaluates its arguments twice
+        int n;
+        for( struct expr *e = s->expr_list; e; e = e->next ){
+            n = expr_codegen_regs(e);
+            need = MAX(need, n);
+        }
+        n = s->decl ? expr_codegen_regs(s->decl->init_value) : 0;
+        need = MAX(need, n);
+        n = inline_regs_stmt(s->body);
+        need = MAX(need, n);
+    }
+    return need;
+}
+
+/* recursion ============================================================= */
+
+bool inline_reaches_expr(struct expr *e, struct symbol *target, struct visited *v){
+    /* whether evaluating the list 'e' can call 'target', through any chain of defined functions */
+    for( ; e; e = e->next ){
+        if( e->kind == EXPR_FUNC_CALL ){
+            struct symbol *callee = e->data->func_and_args->symbol;
+            if( callee == target ) return true;
+
+            bool seen = !callee->definition;
+            for( int i = 0; i < v->count && !seen; i++ ) seen = v->syms[i] == callee;
+            if( !seen ){
+                if( v->count == v->cap ){
+                    v->cap  = v->cap ? 2 * v->cap : 8;
+                    v->syms = realloc(v->syms, v->cap * sizeof(*v->syms));
+                    if( !v->syms ) diag_fatal("Could not allocate the inliner's call graph search");
+                }
+                v->syms[v->count++] = callee;
+                if( inline_reaches_stmt(callee->definition->func_body, target, v) ) return true;
+            }
+        }
+        if( inline_reaches_expr(inline_operands(e), target, v) ) return true;
+    }
+    return false;
+}
+
+bool inline_reaches_stmt(struct stmt *s, struct symbol *target, struct visited *v){
+    for( ; s; s = s->next ){
+        if( inline_reaches_expr(s->expr_list, target, v) )                          return true;
+        if( s->decl && inline_reaches_expr(s->decl->init_value, target, v) )        return true;
+        if( inline_reaches_stmt(s->body, target, v) )                               return true;
+    }
+    return false;
+}
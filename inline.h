@@ -0,0 +1,37 @@
+#ifndef INLINE_H
+#define INLINE_H
+
+#include "decl.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+
+/* Function inlining. inline_plan marks the defined functions whose bodies are at most codegen_opts.inline_budget AST nodes
+   and that cannot reach themselves through calls: expr_codegen generates a marked function's body in place of a call to it,
+   with the parameters and locals in the caller's frame and return statements jumping past the inlined body.
+   The function is still generated on its own, for calls it is not inlined into. */
+
+struct inline_info {
+    // AST nodes (statements, declarations and expressions) in the body
+    int size;
+    // scratch registers the body needs, an upper bound: inlining into a call with fewer free would run out
+    int regs;
+    // held while the body is generated, in place of a call or on its own: generating it sets the registers of its expressions
+    // and the frame offsets of its parameters and locals, which threads generating functions at once must not share
+    pthread_mutex_t lock;
+};
+
+/* marks the functions of the (resolved and typechecked) program 'ast' that may be inlined and forgets the previous report */
+void inline_plan( struct decl *ast );
+/* whether the call 'e' is to be inlined: its callee is marked and enough scratch registers are free for the body */
+bool inline_call_ok( struct expr *e );
+/* generates the callee's body in place of the call 'e', leaving the returned value in e->reg */
+void inline_codegen_call( struct expr *e );
+/* take and give back the lock of function 'd' when it is marked, around generating it on its own. Locks are taken in the order
+   calls are inlined, from caller to callee: as marked functions cannot reach themselves, no two threads wait on each other */
+void inline_lock( struct decl *d );
+void inline_unlock( struct decl *d );
+/* prints a line for each call inlined since inline_plan, then a total */
+void inline_report( FILE *f );
+
+#endif
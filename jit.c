@@ -0,0 +1,511 @@
+#include "jit.h"
+#include "diag.h"
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* bytes of the code's stack kept below the deepest call for the C functions it calls */
+#define JIT_C_STACK     (1 << 20)
+/* bytes of stack each nested call takes: the return address, and padding keeping C calls 16-byte aligned */
+#define JIT_CALL_BYTES  16
+
+/* registers by their encoding */
+typedef enum {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8  = 8, R9  = 9, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+} jit_reg_t;
+
+/* condition codes, as the low nibble of jcc and setcc */
+typedef enum {
+    CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7, CC_L = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G = 0xf
+} jit_cc_t;
+
+/* what a runtime error stub reports (see jit_error) */
+typedef enum {
+    JIT_DIVIDE_BY_ZERO,
+    JIT_DIVIDE_OVERFLOW,
+    JIT_STACK_OVERFLOW
+} jit_error_t;
+
+/* a 32-bit displacement waiting for the offset of what it jumps or calls to */
+struct jit_fixup {
+    size_t at;
+    // the instruction jumped to, the function called, or the stub's error (see 'stub')
+    int    target;
+    // jumps to a function's entry checks rather than its first instruction
+    bool   function;
+    // for a stub: the instruction or function it reports
+    bool   stub;
+    int    arg;
+};
+
+/* the entry trampoline the code starts with, called from C:
+   int64_t entry(int64_t *frame, int64_t *globals, int64_t *frame_limit, void *stack_top, void *stack_limit, void *main)
+   it saves the registers C expects preserved (and %rsp in %r15), switches to the code's stack and calls main: main's return,
+   or a runtime error, comes back to the exit right after */
+static const unsigned char trampoline[] = {
+    0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57,     // push %rbx, %rbp, %r12, %r13, %r14, %r15
+    0x49, 0x89, 0xe7,                                               // mov %rsp, %r15
+    0x48, 0x89, 0xfb,                                               // mov %rdi, %rbx
+    0x49, 0x89, 0xf4,                                               // mov %rsi, %r12
+    0x49, 0x89, 0xd5,                                               // mov %rdx, %r13
+    0x4d, 0x89, 0xc6,                                               // mov %r8, %r14
+    0x48, 0x89, 0xcc,                                               // mov %rcx, %rsp
+    0x41, 0xff, 0xd1,                                               // call *%r9
+};
+static const unsigned char trampoline_exit[] = {
+    0x4c, 0x89, 0xfc,                                               // mov %r15, %rsp
+    0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5d, 0x5b,     // pop %r15, %r14, %r13, %r12, %rbp, %rbx
+    0xc3                                                            // ret
+};
+
+typedef int64_t (*jit_entry_fn)( int64_t *frame, int64_t *globals, int64_t *frame_limit, void *stack_top, void *stack_limit,
+                                 void *main );
+
+/* code being assembled */
+static unsigned char *buf = NULL;
+static size_t len = 0, cap = 0;
+static struct jit_fixup *fixups = NULL;
+static int fixup_count = 0, fixup_cap = 0;
+
+/* program running: for the runtime routines */
+static struct jit_program *running = NULL;
+static unsigned char *running_stack_top = NULL;
+static int run_errors = 0;
+
+/* internal helpers */
+void    jit_insn(struct vm_program *p, struct vm_insn *in, int index);
+void    jit_divide(struct vm_insn *in, int index);
+void    jit_byte(unsigned char b);
+void    jit_bytes(const unsigned char *bytes, size_t n);
+void    jit_int32(int32_t x);
+void    jit_int64(int64_t x);
+void    jit_mem(unsigned op, int reg, jit_reg_t base, int32_t disp);
+void    jit_load(jit_reg_t reg, int slot);
+void    jit_store(int slot, jit_reg_t reg);
+void    jit_call_c(void *fn);
+void    jit_set(jit_cc_t cc, int slot);
+void    jit_jump(jit_cc_t cc, int insn);
+void    jit_fixup(int target, bool function, bool stub, int arg);
+void    jit_error(int kind, int arg, unsigned char *rsp);
+void    jit_print_integer(int64_t x);
+void    jit_print_char(int64_t c);
+void    jit_print_boolean(int64_t b);
+void    jit_print_string(const char *s);
+void    jit_flush();
+
+struct jit_program *jit_compile(struct vm_program *p){
+#ifndef __x86_64__
+    diag_report(DIAG_CODEGEN, 0, "-jit generates x86-64 code, which this machine cannot run");
+    return NULL;
+#endif
+    len = 0;
+    fixup_count = 0;
+    size_t *insn_at     = malloc((p->code_len + 1) * sizeof(*insn_at));
+    size_t *function_at = malloc((p->function_count + 1) * sizeof(*function_at));
+    // the function each instruction starts, if any
+    int *starts         = malloc((p->code_len + 1) * sizeof(*starts));
+    if( !insn_at || !function_at || !starts ) diag_fatal("Could not allocate the JIT's tables");
+    for( int i = 0; i < p->code_len; i++ ) starts[i] = -1;
+    for( int f = 0; f < p->function_count; f++ ) starts[p->functions[f].entry] = f;
+
+    jit_bytes(trampoline, sizeof(trampoline));
+    size_t exit_at = len;
+    jit_bytes(trampoline_exit, sizeof(trampoline_exit));
+    // every stub ends up here, with the error's arguments loaded: nothing is run after the report, so %rsp may be realigned
+    size_t error_at = len;
+    jit_bytes((const unsigned char []) { 0x48, 0x83, 0xe4, 0xf0 }, 4);     // and $-16, %rsp
+    jit_call_c(jit_error);
+    jit_byte(0xe9);                                                         // jmp exit
+    jit_int32(exit_at - (len + 4));
+
+    for( int i = 0; i < p->code_len; i++ ){
+        int f = starts[i];
+        if( f >= 0 ){
+            // entry checks, as vm_run makes them on a call: too many calls in progress, or no room for the frame
+            function_at[f] = len;
+            jit_bytes((const unsigned char []) { 0x4c, 0x39, 0xf4, 0x0f, 0x86 }, 5);   // cmp %r14, %rsp; jbe stub
+            jit_fixup(JIT_STACK_OVERFLOW, false, true, f);
+            jit_mem(0x8d, RAX, RBX, p->functions[f].frame_size * 8);                // lea frame_size(%rbx), %rax
+            jit_bytes((const unsigned char []) { 0x4c, 0x39, 0xe8, 0x0f, 0x87 }, 5);   // cmp %r13, %rax; ja stub
+            jit_fixup(JIT_STACK_OVERFLOW, false, true, f);
+            jit_bytes((const unsigned char []) { 0x48, 0x83, 0xec, 0x08 }, 4);     // sub $8, %rsp
+        }
+        insn_at[i] = len;
+        jit_insn(p, &p->code[i], i);
+    }
+
+    // stubs go after the code, out of the way of the instructions that rarely jump to them
+    for( int i = 0; i < fixup_count; i++ ){
+        struct jit_fixup *fx = &fixups[i];
+        size_t target;
+        if( fx->stub ){
+            target = len;
+            jit_byte(0xbf);                     // mov $kind, %edi
+            jit_int32(fx->target);
+            jit_byte(0xbe);                     // mov $arg, %esi
+            jit_int32(fx->arg);
+            jit_bytes((const unsigned char []) { 0x48, 0x89, 0xe2 }, 3);   // mov %rsp, %rdx
+            jit_byte(0xe9);                     // jmp error
+            jit_int32(error_at - (len + 4));
+        }
+        else target = fx->function ? function_at[fx->target] : insn_at[fx->target];
+        int32_t rel = target - (fx->at + 4);
+        memcpy(buf + fx->at, &rel, sizeof(rel));
+    }
+
+    struct jit_program *j = calloc(1, sizeof(*j));
+    if( !j ) diag_fatal("Could not allocate a JIT program");
+    j->size     = len;
+    j->main_at  = function_at[p->main];
+    j->bytecode = p;
+    // written while writable, then made executable: never both
+    j->code = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if( j->code == MAP_FAILED ) diag_fatal("Could not map %zu bytes for the JIT's code", len);
+    memcpy(j->code, buf, len);
+    if( mprotect(j->code, len, PROT_READ | PROT_EXEC) ) diag_fatal("Could not make the JIT's code executable");
+
+    free(insn_at);
+    free(function_at);
+    free(starts);
+    return j;
+}
+
+void jit_delete(struct jit_program *j){
+    if( !j ) return;
+    munmap(j->code, j->size);
+    free(j);
+}
+
+int jit_run(struct jit_program *j, int *status){
+    struct vm_program *p = j->bytecode;
+    // globals start out with their initial values on every run
+    int64_t *globals = malloc((p->global_count + 1) * sizeof(*globals));
+    int64_t *frames  = malloc(VM_STACK_SLOTS * sizeof(*frames));
+    if( !globals || !frames ) diag_fatal("Could not allocate the JIT's stack");
+    memcpy(globals, p->globals, p->global_count * sizeof(*globals));
+
+    // main is entered with the return address into the trampoline pushed; each callee is 16 bytes deeper
+    size_t stack_size = (size_t) (VM_MAX_CALLS + 2) * JIT_CALL_BYTES + JIT_C_STACK;
+    unsigned char *stack = mmap(NULL, stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if( stack == MAP_FAILED ) diag_fatal("Could not map the JIT's stack");
+    running           = j;
+    running_stack_top = stack + stack_size;
+    run_errors        = 0;
+    unsigned char *limit = running_stack_top - 8 - (size_t) (VM_MAX_CALLS + 1) * JIT_CALL_BYTES;
+
+    int64_t result = ((jit_entry_fn) (void *) j->code)(frames, globals, frames + VM_STACK_SLOTS, running_stack_top, limit,
+                                                        j->code + j->main_at);
+    fflush(out_stream);
+    munmap(stack, stack_size);
+    free(globals);
+    free(frames);
+    running = NULL;
+    *status = run_errors ? 0 : (int) result;
+    return run_errors;
+}
+
+void jit_insn(struct vm_program *p, struct vm_insn *in, int index){
+    /* the machine code of one bytecode instruction: %rax, %rcx, %rdx, %rdi, %rsi, %r8 to %r9 and %r11 are scratch */
+    static const jit_cc_t compare[] = {
+        [VM_LT] = CC_L, [VM_LE] = CC_LE, [VM_GT] = CC_G, [VM_GE] = CC_GE, [VM_EQ] = CC_E, [VM_NE] = CC_NE
+    };
+    static const jit_reg_t arg_regs[] = { RDI, RSI, RDX, RCX, R8, R9 };
+    int a = in->a, b = in->b, c = in->c;
+    switch( in->op ){
+        case VM_MOVE:
+            jit_load(RAX, b);
+            jit_store(a, RAX);
+            break;
+        case VM_LOADI:
+            jit_mem(0xc7, 0, RBX, a * 8);           // movq $b, a
+            jit_int32(b);
+            break;
+        case VM_CONST:
+            jit_bytes((const unsigned char []) { 0x48, 0xb8 }, 2);     // movabs $constant, %rax
+            jit_int64(p->constants[b]);
+            jit_store(a, RAX);
+            break;
+        case VM_GLOBAL:
+            jit_mem(0x8b, RAX, R12, b * 8);
+            jit_store(a, RAX);
+            break;
+        case VM_SET_GLOBAL:
+            jit_load(RAX, b);
+            jit_mem(0x89, RAX, R12, a * 8);
+            break;
+        case VM_GLOBAL_ADDR:
+        case VM_LOCAL_ADDR:
+            jit_mem(0x8d, RAX, in->op == VM_GLOBAL_ADDR ? R12 : RBX, b * 8);
+            jit_store(a, RAX);
+            break;
+        case VM_LOAD:
+            jit_load(RAX, b);
+            jit_bytes((const unsigned char []) { 0x48, 0x8b, 0x00 }, 3);   // mov (%rax), %rax
+            jit_store(a, RAX);
+            break;
+        case VM_STORE:
+            jit_load(RAX, a);
+            jit_load(RCX, b);
+            jit_bytes((const unsigned char []) { 0x48, 0x89, 0x08 }, 3);   // mov %rcx, (%rax)
+            break;
+        case VM_LOAD_ELEM:
+        case VM_ELEM_ADDR:
+            jit_load(RAX, b);
+            jit_load(RCX, c);
+            // mov or lea (%rax, %rcx, 8), %rax
+            jit_bytes((const unsigned char []) { 0x48, in->op == VM_LOAD_ELEM ? 0x8b : 0x8d, 0x04, 0xc8 }, 4);
+            jit_store(a, RAX);
+            break;
+        case VM_STORE_ELEM:
+            jit_load(RAX, a);
+            jit_load(RCX, b);
+            jit_load(RDX, c);
+            jit_bytes((const unsigned char []) { 0x48, 0x89, 0x14, 0xc8 }, 4);     // mov %rdx, (%rax, %rcx, 8)
+            break;
+        case VM_ZERO:
+            jit_mem(0x8d, RDI, RBX, a * 8);         // lea a, %rdi
+            jit_byte(0xb9);                         // mov $b, %ecx
+            jit_int32(b);
+            jit_bytes((const unsigned char []) { 0x31, 0xc0, 0xf3, 0x48, 0xab }, 5);   // xor %eax, %eax; rep stosq
+            break;
+        case VM_ADD:
+        case VM_SUB:
+        case VM_MUL:
+            jit_load(RAX, b);
+            jit_mem(in->op == VM_ADD ? 0x03 : in->op == VM_SUB ? 0x2b : 0x0faf, RAX, RBX, c * 8);
+            jit_store(a, RAX);
+            break;
+        case VM_ADDI:
+            jit_load(RAX, b);
+            jit_bytes((const unsigned char []) { 0x48, 0x05 }, 2);     // add $c, %rax
+            jit_int32(c);
+            jit_store(a, RAX);
+            break;
+        case VM_MULI:
+            jit_mem(0x69, RAX, RBX, b * 8);         // imul $c, b, %rax
+            jit_int32(c);
+            jit_store(a, RAX);
+            break;
+        case VM_DIV:
+        case VM_MOD:
+            jit_divide(in, index);
+            break;
+        case VM_EXP:
+            jit_load(RDI, b);
+            jit_load(RSI, c);
+            jit_call_c(vm_power);
+            jit_store(a, RAX);
+            break;
+        case VM_NEG:
+            jit_load(RAX, b);
+            jit_bytes((const unsigned char []) { 0x48, 0xf7, 0xd8 }, 3);   // neg %rax
+            jit_store(a, RAX);
+            break;
+        case VM_NOT:
+            jit_mem(0x83, 7, RBX, b * 8);           // cmpq $0, b
+            jit_byte(0);
+            jit_set(CC_E, a);
+            break;
+        case VM_LT: case VM_LE: case VM_GT: case VM_GE: case VM_EQ: case VM_NE:
+            jit_load(RAX, b);
+            jit_mem(0x3b, RAX, RBX, c * 8);         // cmp c, %rax
+            jit_set(compare[in->op], a);
+            break;
+        case VM_STR_EQ:
+        case VM_STR_NE:
+            jit_load(RDI, b);
+            jit_load(RSI, c);
+            jit_call_c(strcmp);
+            jit_bytes((const unsigned char []) { 0x85, 0xc0 }, 2);     // test %eax, %eax
+            jit_set(in->op == VM_STR_EQ ? CC_E : CC_NE, a);
+            break;
+        case VM_JUMP:
+            jit_byte(0xe9);
+            jit_fixup(a, false, false, 0);
+            break;
+        case VM_JUMP_IF:
+        case VM_JUMP_UNLESS:
+            jit_mem(0x83, 7, RBX, b * 8);           // cmpq $0, b
+            jit_byte(0);
+            jit_jump(in->op == VM_JUMP_IF ? CC_NE : CC_E, a);
+            break;
+        case VM_JUMP_LT: case VM_JUMP_LE: case VM_JUMP_GT: case VM_JUMP_GE: case VM_JUMP_EQ: case VM_JUMP_NE:
+            jit_load(RAX, b);
+            jit_mem(0x3b, RAX, RBX, c * 8);         // cmp c, %rax
+            jit_jump(compare[VM_LT + (in->op - VM_JUMP_LT)], a);
+            break;
+        case VM_JUMP_LTI: case VM_JUMP_LEI: case VM_JUMP_GTI: case VM_JUMP_GEI: case VM_JUMP_EQI: case VM_JUMP_NEI:
+            jit_mem(0x81, 7, RBX, b * 8);           // cmpq $c, b
+            jit_int32(c);
+            jit_jump(compare[VM_LT + (in->op - VM_JUMP_LTI)], a);
+            break;
+        case VM_CALL:
+            // the callee's frame starts at the arguments
+            if( c ) jit_mem(0x8d, RBX, RBX, c * 8);
+            jit_byte(0xe8);
+            jit_fixup(b, true, false, 0);
+            if( c ) jit_mem(0x8d, RBX, RBX, -c * 8);
+            jit_store(a, RAX);
+            break;
+        case VM_CALL_NATIVE:
+            // it may write to stdout itself: what the program printed goes first
+            jit_call_c(jit_flush);
+            for( int i = 0; i < p->natives[b].params; i++ ) jit_load(arg_regs[i], c + i);
+            jit_bytes((const unsigned char []) { 0x49, 0xbb }, 2);     // movabs $fn, %r11
+            jit_int64((intptr_t) p->natives[b].fn);
+            // no vector registers hold arguments, should it take a variable number of them
+            jit_bytes((const unsigned char []) { 0x31, 0xc0, 0x41, 0xff, 0xd3 }, 5);  // xor %eax, %eax; call *%r11
+            jit_store(a, RAX);
+            break;
+        case VM_RETURN:
+            jit_load(RAX, a);
+            jit_bytes((const unsigned char []) { 0x48, 0x83, 0xc4, 0x08, 0xc3 }, 5);  // add $8, %rsp; ret
+            break;
+        case VM_PRINT_INT:
+        case VM_PRINT_CHAR:
+        case VM_PRINT_BOOL:
+        case VM_PRINT_STR:
+            jit_load(RDI, a);
+            jit_call_c(in->op == VM_PRINT_INT  ? (void *) jit_print_integer :
+                       in->op == VM_PRINT_CHAR ? (void *) jit_print_char :
+                       in->op == VM_PRINT_BOOL ? (void *) jit_print_boolean : (void *) jit_print_string);
+            break;
+        default:
+            diag_fatal("The JIT has no translation for bytecode %d", in->op);
+    }
+}
+
+void jit_divide(struct vm_insn *in, int index){
+    /* a = b / c or b % c, checking first for what vm_run reports: dividing by -1 is a negation, the one that overflows an error */
+    bool mod = in->op == VM_MOD;
+    jit_load(RAX, in->b);
+    jit_load(RCX, in->c);
+    jit_bytes((const unsigned char []) { 0x48, 0x85, 0xc9, 0x0f, 0x84 }, 5);   // test %rcx, %rcx; jz stub
+    jit_fixup(JIT_DIVIDE_BY_ZERO, false, true, index);
+    jit_bytes((const unsigned char []) { 0x48, 0x83, 0xf9, 0xff, 0x74 }, 5);   // cmp $-1, %rcx; je negate
+    jit_byte(mod ? 10 : 7);
+    jit_bytes((const unsigned char []) { 0x48, 0x99, 0x48, 0xf7, 0xf9 }, 5);   // cqo; idiv %rcx
+    if( mod ) jit_bytes((const unsigned char []) { 0x48, 0x89, 0xd0 }, 3);     // mov %rdx, %rax
+    jit_byte(0xeb);                                                             // jmp done
+    jit_byte(mod ? 11 : 9);
+    jit_bytes((const unsigned char []) { 0x48, 0xf7, 0xd8, 0x0f, 0x80 }, 5);   // negate: neg %rax; jo stub
+    jit_fixup(JIT_DIVIDE_OVERFLOW, false, true, index);
+    if( mod ) jit_bytes((const unsigned char []) { 0x31, 0xc0 }, 2);           // xor %eax, %eax
+    jit_store(in->a, RAX);                                                      // done:
+}
+
+/* encoding ============================================================= */
+
+void jit_byte(unsigned char b){
+    if( len == cap ){
+        cap = cap ? 2 * cap : 1 << 16;
+        unsigned char *bigger = realloc(buf, cap);
+        if( !bigger ) diag_fatal("Could not allocate %zu bytes of machine code", cap);
+        buf = bigger;
+    }
+    buf[len++] = b;
+}
+
+void jit_bytes(const unsigned char *bytes, size_t n){
+    for( size_t i = 0; i < n; i++ ) jit_byte(bytes[i]);
+}
+
+void jit_int32(int32_t x){
+    jit_bytes((const unsigned char *) &x, sizeof(x));
+}
+
+void jit_int64(int64_t x){
+    jit_bytes((const unsigned char *) &x, sizeof(x));
+}
+
+void jit_mem(unsigned op, int reg, jit_reg_t base, int32_t disp){
+    /* a 64-bit instruction with opcode 'op' (one byte, or 0x0f and one) between register (or opcode extension) 'reg' and
+       disp(base) */
+    jit_byte(0x48 | (reg >> 3) << 2 | base >> 3);
+    if( op > 0xff ) jit_byte(op >> 8);
+    jit_byte(op);
+    bool short_disp = disp >= -128 && disp < 128;
+    jit_byte((short_disp ? 0x40 : 0x80) | (reg & 7) << 3 | (base & 7));
+    // %rsp and %r12 as a base take a SIB byte
+    if( (base & 7) == RSP ) jit_byte(0x24);
+    if( short_disp ) jit_byte(disp);
+    else jit_int32(disp);
+}
+
+void jit_load(jit_reg_t reg, int slot){
+    jit_mem(0x8b, reg, RBX, slot * 8);
+}
+
+void jit_store(int slot, jit_reg_t reg){
+    jit_mem(0x89, reg, RBX, slot * 8);
+}
+
+void jit_call_c(void *fn){
+    /* the stack is 16-byte aligned in function bodies, as C expects it */
+    jit_bytes((const unsigned char []) { 0x48, 0xb8 }, 2);         // movabs $fn, %rax
+    jit_int64((intptr_t) fn);
+    jit_bytes((const unsigned char []) { 0xff, 0xd0 }, 2);         // call *%rax
+}
+
+void jit_set(jit_cc_t cc, int slot){
+    /* slot = the condition, 0 or 1 */
+    jit_bytes((const unsigned char []) { 0x0f, 0x90 | cc, 0xc0, 0x0f, 0xb6, 0xc0 }, 6);  // setcc %al; movzbl %al, %eax
+    jit_store(slot, RAX);
+}
+
+void jit_jump(jit_cc_t cc, int insn){
+    jit_bytes((const unsigned char []) { 0x0f, 0x80 | cc }, 2);
+    jit_fixup(insn, false, false, 0);
+}
+
+void jit_fixup(int target, bool function, bool stub, int arg){
+    /* leaves room for the 32-bit displacement at the end of the instruction just begun */
+    if( fixup_count == fixup_cap ){
+        fixup_cap = fixup_cap ? 2 * fixup_cap : 256;
+        struct jit_fixup *bigger = realloc(fixups, fixup_cap * sizeof(*bigger));
+        if( !bigger ) diag_fatal("Could not allocate %d JIT fixups", fixup_cap);
+        fixups = bigger;
+    }
+    fixups[fixup_count++] = (struct jit_fixup) { len, target, function, stub, arg };
+    jit_int32(0);
+}
+
+/* runtime ============================================================== */
+
+void jit_error(int kind, int arg, unsigned char *rsp){
+    /* reports as vm_run does; the code then returns to jit_run */
+    struct vm_program *p = running->bytecode;
+    fflush(out_stream);
+    if( kind == JIT_STACK_OVERFLOW ){
+        // main was entered 8 bytes below the top, each callee another JIT_CALL_BYTES lower: the calls in progress exclude it
+        long calls = (running_stack_top - 8 - rsp) / JIT_CALL_BYTES - 1;
+        diag_report(DIAG_RUNTIME, 0, "Stack overflow: %s called with %ld calls in progress", p->functions[arg].name,
+                    calls < 0 ? 0 : calls);
+    }
+    else diag_report(DIAG_RUNTIME, 0, "%s %s in %s", p->code[arg].op == VM_DIV ? "Division" : "Remainder",
+                     kind == JIT_DIVIDE_OVERFLOW ? "overflows" : "by zero", vm_function_at(p, arg));
+    run_errors++;
+}
+
+void jit_print_integer(int64_t x){
+    fprintf(out_stream, "%ld", (long) x);
+}
+
+void jit_print_char(int64_t c){
+    putc((char) c, out_stream);
+}
+
+void jit_print_boolean(int64_t b){
+    fputs(b ? "true" : "false", out_stream);
+}
+
+void jit_print_string(const char *s){
+    fputs(s, out_stream);
+}
+
+void jit_flush(){
+    fflush(out_stream);
+}
@@ -0,0 +1,33 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "vm.h"
+#include <stddef.h>
+
+/* In-memory x86-64 compiler (-run -jit): translates the bytecode vm_compile lowers a program to into machine code, written
+   straight into memory mapped for it and then made executable, and runs main there: no assembly file, assembler or linker.
+   Each bytecode instruction becomes a short sequence of machine instructions working on the same frame of slots, which %rbx
+   points to ([%rbx + 8 * slot]); globals are addressed from %r12. Calls between functions are direct call instructions whose
+   targets are filled in once every function has been laid out; printing goes through a few C routines of jit.c, and a
+   function the program only declares is called at the address vm_compile found it at. The code runs on a stack of its own,
+   each function's return address taking 16 bytes of it, so that it nests calls as deep as the interpreter does; the checks
+   on entry to each function, and the checks on division, report the same runtime errors vm_run does. */
+
+struct jit_program {
+    // the code and trampoline (see jit.c), mapped read and execute
+    unsigned char     *code;
+    size_t             size;
+    // offset of main's first instruction
+    size_t             main_at;
+    // the bytecode program it was compiled from, for its globals and for naming functions in errors
+    struct vm_program *bytecode;
+};
+
+/* compiles the bytecode of 'p', which must outlive the result: NULL once errors have been reported */
+struct jit_program *jit_compile( struct vm_program *p );
+void                jit_delete( struct jit_program *j );
+
+/* runs the program's main function as vm_run does, with the same results: returns the number of runtime errors */
+int jit_run( struct jit_program *j, int *status );
+
+#endif
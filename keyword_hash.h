@@ -0,0 +1,8 @@
+#ifndef KEYWORD_HASH_H
+#define KEYWORD_HASH_H
+
+/* Classifies an {IDENT} match: returns the keyword's token if the 'len' bytes at 's' spell a keyword in keywords.txt, IDENT otherwise.
+   Implemented by keyword_hash.c, which the Makefile generates with scripts/gen_keyword_hash.c */
+int keyword_lookup( const char *s, int len );
+
+#endif
@@ -0,0 +1,156 @@
+#include "libbminor.h"
+#include "token.h"
+#include "decl.h"
+#include "scope.h"
+#include "output.h"
+#include "arena.h"
+#include "codegen.h"
+#include "pratt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern void  scanner_set_source( char *src, size_t len );
+extern int   yylex();
+extern int   yylineno;
+extern char *yytext;
+extern struct decl *ast;
+
+struct bminor_ctx {
+    char        *out_buf;
+    size_t       out_len;
+    struct diag *diags;
+};
+
+/* copy of the source being compiled, padded for the scanner: string literals in the AST point into it, so it lives as long as the AST (until the next compile) */
+static char  *src_copy = NULL;
+static size_t src_cap  = 0;
+
+/* internal helpers */
+void bminor_ctx_reset(struct bminor_ctx *ctx);
+void bminor_scan_source();
+void bminor_run_stages(const char *src, size_t len, bminor_stage_t stage, bool verbose);
+
+struct bminor_ctx *bminor_ctx_create(){
+    // no diag_fatal here: the caller gets NULL instead
+    struct bminor_ctx *ctx = malloc(sizeof(*ctx));
+    if( !ctx ) return NULL;
+
+    ctx->out_buf = NULL;
+    ctx->out_len = 0;
+    ctx->diags   = NULL;
+    return ctx;
+}
+
+void bminor_ctx_delete(struct bminor_ctx *ctx){
+    if( !ctx ) return;
+    bminor_ctx_reset(ctx);
+    free(ctx);
+}
+
+void bminor_ctx_reset(struct bminor_ctx *ctx){
+    free(ctx->out_buf);
+    ctx->out_buf = NULL;
+    ctx->out_len = 0;
+    diag_delete(ctx->diags);
+    ctx->diags = NULL;
+}
+
+int bminor_compile(struct bminor_ctx *ctx, const char *src, size_t len, bminor_stage_t stage, bool verbose){
+    bminor_ctx_reset(ctx);
+
+    bool  was_echoing = diag_set_echo(false);
+    FILE *prev_out    = out_stream;
+    out_stream = open_memstream(&ctx->out_buf, &ctx->out_len);
+    if( !out_stream ){
+        diag_report(DIAG_INTERNAL, 0, "Could not open output memory stream");
+    }
+    else {
+        // everything that used to exit the process unwinds to here instead
+        jmp_buf recovery;
+        diag_set_recovery(&recovery);
+        if( !setjmp(recovery) )
+            bminor_run_stages(src, len, stage, verbose);
+        diag_set_recovery(NULL);
+        fclose(out_stream);
+    }
+    out_stream = prev_out;
+    diag_set_echo(was_echoing);
+
+    ctx->diags = diag_take();
+    return diag_count(ctx->diags);
+}
+
+void bminor_run_stages(const char *src, size_t len, bminor_stage_t stage, bool verbose){
+    // the previous compile's AST is unreachable through this interface: recycle its memory
+    arena_reset();
+    ast = NULL;
+
+    // grow-only, so steady-state compiles do not allocate for it
+    if( len + 2 > src_cap ){
+        char *bigger = realloc(src_copy, len + 2);
+        if( !bigger ) diag_fatal("Could not allocate %zu bytes for the source", len + 2);
+        src_copy = bigger;
+        src_cap  = len + 2;
+    }
+    memcpy(src_copy, src, len);
+    src_copy[len] = src_copy[len + 1] = '\0';
+    scanner_set_source(src_copy, len);
+
+    if( stage == BMINOR_SCAN ){
+        bminor_scan_source();
+        return;
+    }
+
+    // the parser has already recorded why the parse failed
+    if( parser_parse(src_copy, len) ) return;
+
+    if( stage == BMINOR_PRINT ){
+        decl_print_list(ast, 0, ";", "\n");
+        fputs("\n", out_stream);
+    }
+    else if( stage >= BMINOR_RESOLVE ){
+        struct scope *sc = scope_enter(NULL);
+        int err_count = decl_resolve(ast, sc, false, verbose && stage == BMINOR_RESOLVE);
+        scope_exit(sc);
+        // each later stage needs the previous one to have succeeded
+        if( err_count || stage == BMINOR_RESOLVE ) return;
+        if( decl_typecheck(ast) || stage == BMINOR_TYPECHECK ) return;
+        codegen_program(ast);
+    }
+}
+
+void bminor_scan_source(){
+    int t;
+    do {
+        t = yylex();
+        switch(t){
+            case SCAN_ERR:
+                diag_report(DIAG_SCAN, yylineno, "Invalid token: %s", yytext);
+                break;
+            case INTERNAL_ERR:
+                diag_report(DIAG_INTERNAL, yylineno, "Scanner failed to allocate memory");
+                break;
+            default:
+                break;
+        }
+    } while( !(t == TOKEN_EOF || t == SCAN_ERR || t == INTERNAL_ERR) );
+}
+
+const char *bminor_output(struct bminor_ctx *ctx, size_t *len){
+    if( len ) *len = ctx->out_len;
+    return ctx->out_buf ? ctx->out_buf : "";
+}
+
+size_t bminor_copy_output(struct bminor_ctx *ctx, char *buf, size_t cap){
+    if( cap > 0 ){
+        size_t n = ctx->out_len < cap - 1 ? ctx->out_len : cap - 1;
+        if( n ) memcpy(buf, ctx->out_buf, n);
+        buf[n] = '\0';
+    }
+    return ctx->out_len;
+}
+
+struct diag *bminor_diags(struct bminor_ctx *ctx){
+    return ctx->diags;
+}
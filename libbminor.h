@@ -0,0 +1,36 @@
+#ifndef LIBBMINOR_H
+#define LIBBMINOR_H
+
+/* Embeddable interface to the compiler: compiles from memory, collects output in memory and diagnostics as records, and never exits the process.
+   The scanner and parser keep global state, so only one compile may be in flight per process at a time. */
+
+#include "diag.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef enum {
+    BMINOR_SCAN,        // scan only: reports invalid tokens
+    BMINOR_PARSE,       // scan and parse
+    BMINOR_PRINT,       // parse, then pretty print the program to the output
+    BMINOR_RESOLVE,     // parse, then resolve names (verbose: resolutions are written to the output)
+    BMINOR_TYPECHECK,   // resolve, then typecheck
+    BMINOR_CODEGEN      // typecheck, then write x86-64 assembly to the output
+} bminor_stage_t;
+
+struct bminor_ctx;
+
+struct bminor_ctx *bminor_ctx_create();
+void               bminor_ctx_delete( struct bminor_ctx *ctx );
+
+/* Compiles the 'len' bytes at 'src' through 'stage'. Output and diagnostics of any previous compile on 'ctx' are discarded.
+   Returns 0 on success, otherwise the number of diagnostics recorded (allocation failures are recorded as DIAG_INTERNAL). */
+int bminor_compile( struct bminor_ctx *ctx, const char *src, size_t len, bminor_stage_t stage, bool verbose );
+
+/* output of the last compile, nul terminated and owned by 'ctx'; its length is stored in 'len' if non-NULL */
+const char  *bminor_output( struct bminor_ctx *ctx, size_t *len );
+/* copies at most 'cap' - 1 bytes of output (nul terminated) into 'buf': returns the full output length, like snprintf */
+size_t       bminor_copy_output( struct bminor_ctx *ctx, char *buf, size_t cap );
+/* diagnostics of the last compile in report order, owned by 'ctx' */
+struct diag *bminor_diags( struct bminor_ctx *ctx );
+
+#endif
@@ -0,0 +1,300 @@
+#include "licm.h"
+#include "codegen.h"
+#include "bounds.h"
+#include "diag.h"
+#include <stdlib.h>
+
+/* what the iterations of a loop may change */
+struct licm_writes {
+    // variables assigned, incremented or declared
+    struct symbol **syms;
+    int             count, cap;
+    // an array element may be stored to: by the loop itself, or by a function that is not pure
+    bool            memory;
+    // a function that is not pure is called: it may assign globals
+    bool            globals;
+    // a return may leave the loop part way through an iteration
+    bool            exits;
+};
+
+/* for -stats: since licm_plan */
+static int hoisted_count = 0, loop_count = 0;
+
+/* internal helpers */
+struct expr *licm_operands(struct expr *e);
+bool licm_pure_stmt(struct stmt *s);
+bool licm_pure_expr(struct expr *e);
+bool licm_safe_divisor(struct expr *e);
+void licm_writes_stmt(struct stmt *s, struct licm_writes *w);
+void licm_writes_expr(struct expr *e, struct licm_writes *w);
+void licm_written(struct licm_writes *w, struct symbol *sym);
+bool licm_invariant(struct expr *e, struct licm_writes *w, bool every_iteration);
+bool licm_worth(struct expr *e);
+void licm_select_stmt(struct stmt *s, struct licm_writes *w, struct licm_loop *loop, bool every_iteration);
+void licm_select(struct expr *e, struct licm_writes *w, struct licm_loop *loop, bool every_iteration);
+
+void licm_plan(struct decl *ast){
+    hoisted_count = loop_count = 0;
+
+    // a function is pure once every function it calls is: one pass per level of the call graph, and recursion never is
+    for( struct decl *d = ast; d; d = d->next )
+        if( d->symbol && d->symbol->definition == d ) d->symbol->pure = false;
+    bool changed = codegen_opts.licm;
+    while( changed ){
+        changed = false;
+        for( struct decl *d = ast; d; d = d->next ){
+            if( !d->symbol || d->symbol->definition != d || d->symbol->pure ) continue;
+            if( licm_pure_stmt(d->func_body) ) d->symbol->pure = changed = true;
+        }
+    }
+}
+
+struct licm_loop licm_loop_plan(struct stmt *s){
+    struct licm_loop loop = { NULL, 0, 0, 0 };
+    if( !codegen_opts.licm ) return loop;
+
+    // the initialization runs once, before the loop
+    struct expr *cond = s->expr_list->next, *step = cond->next;
+    struct licm_writes w = { NULL, 0, 0, false, false, false };
+    licm_writes_expr(cond, &w);
+    licm_writes_stmt(s->body, &w);
+
+    // without a return, every iteration runs the whole body and the step
+    licm_select(cond, &w, &loop, true);
+    licm_select_stmt(s->body, &w, &loop, !w.exits);
+    licm_select(step, &w, &loop, !w.exits);
+    free(w.syms);
+    return loop;
+}
+
+void licm_loop_hoist(struct licm_loop *loop){
+    loop->frame_mark = frame_mark();
+    for( int i = 0; i < loop->count; i++ ){
+        struct expr *e = loop->hoisted[i];
+        expr_codegen(e);
+        int slot = frame_alloc(8);
+        emit(OP_MOVQ, opnd_reg(e->reg), opnd_mem(REG_RBP, slot));
+        scratch_free(e->reg);
+        e->hoisted = slot;
+    }
+    codegen_count(hoisted_count, loop->count);
+    codegen_count(loop_count, 1);
+}
+
+void licm_loop_end(struct licm_loop *loop){
+    // an inlined function's loop is generated again wherever it is inlined, and planned again there
+    for( int i = 0; i < loop->count; i++ ) loop->hoisted[i]->hoisted = 0;
+    if( loop->count ) frame_release(loop->frame_mark);
+    free(loop->hoisted);
+}
+
+void licm_report(FILE *f){
+    fprintf(f, "Loop-invariant code motion: %d expressions hoisted out of %d loops\n", hoisted_count, loop_count);
+}
+
+struct expr *licm_operands(struct expr *e){
+    /* the callee of a call is not an operand: calling it reads no variable */
+    switch(e->kind){
+        case EXPR_ARR_LIT:      return e->data->arr_elements;
+        case EXPR_FUNC_CALL:    return e->data->func_and_args->next;
+        case EXPR_ARR_ACC:      return e->data->operator_args;
+        default:                return expr_fixity(e->kind) != FIX_NONE ? e->data->operator_args : NULL;
+    }
+}
+
+/* pure functions ======================================================== */
+
+bool licm_pure_stmt(struct stmt *s){
+    for( ; s; s = s->next ){
+        if( s->kind == STMT_FOR || s->kind == STMT_PRINT )               return false;
+        if( s->decl && !licm_pure_expr(s->decl->init_value) )           return false;
+        if( !licm_pure_expr(s->expr_list) || !licm_pure_stmt(s->body) ) return false;
+    }
+    return true;
+}
+
+bool licm_pure_expr(struct expr *e){
+    for( ; e; e = e->next ){
+        struct expr *target;
+        switch(e->kind){
+            case EXPR_IDENT:
+                if( e->symbol->kind == SYMBOL_GLOBAL ) return false;
+                break;
+            case EXPR_ARR_ACC:
+            case EXPR_ARR_LIT:
+                return false;
+            case EXPR_ASGN:
+            case EXPR_POST_INC:
+            case EXPR_POST_DEC:
+                target = e->data->operator_args;
+                if( target->kind != EXPR_IDENT || target->symbol->kind == SYMBOL_GLOBAL ) return false;
+                break;
+            case EXPR_DIV:
+            case EXPR_MOD:
+                if( !licm_safe_divisor(e->data->operator_args->next) ) return false;
+                break;
+            case EXPR_FUNC_CALL:
+                if( !e->data->func_and_args->symbol->pure ) return false;
+                break;
+            default:
+                break;
+        }
+        if( !licm_pure_expr(licm_operands(e)) ) return false;
+    }
+    return true;
+}
+
+bool licm_safe_divisor(struct expr *e){
+    /* a constant the division cannot trap on: not 0, and not -1, which overflows the most negative dividend */
+    long c;
+    return expr_const_int(e, &c) && c != 0 && c != -1;
+}
+
+/* what a loop changes ==================================================== */
+
+void licm_writes_stmt(struct stmt *s, struct licm_writes *w){
+    for( ; s; s = s->next ){
+        if( s->kind == STMT_RETURN ) w->exits = true;
+        if( s->decl ){
+            // declared in the loop: initialized again on every iteration, arrays element by element
+            licm_written(w, s->decl->symbol);
+            if( s->decl->type->kind == TYPE_ARRAY ) w->memory = true;
+            licm_writes_expr(s->decl->init_value, w);
+        }
+        licm_writes_expr(s->expr_list, w);
+        licm_writes_stmt(s->body, w);
+    }
+}
+
+void licm_writes_expr(struct expr *e, struct licm_writes *w){
+    for( ; e; e = e->next ){
+        if( e->kind == EXPR_ASGN || e->kind == EXPR_POST_INC || e->kind == EXPR_POST_DEC ){
+            struct expr *target = e->data->operator_args;
+            if( target->kind == EXPR_IDENT ) licm_written(w, target->symbol);
+            else                             w->memory = true;
+        }
+        else if( e->kind == EXPR_FUNC_CALL && !e->data->func_and_args->symbol->pure )
+            w->memory = w->globals = true;
+        licm_writes_expr(licm_operands(e), w);
+    }
+}
+
+void licm_written(struct licm_writes *w, struct symbol *sym){
+    for( int i = 0; i < w->count; i++ )
+        if( w->syms[i] == sym ) return;
+    if( w->count == w->cap ){
+        w->cap  = w->cap ? 2 * w->cap : 16;
+        w->syms = realloc(w->syms, w->cap * sizeof(*w->syms));
+        if( !w->syms ) diag_fatal("Could not allocate the variables a loop assigns");
+    }
+    w->syms[w->count++] = sym;
+}
+
+/* invariant expressions ================================================== */
+
+bool licm_invariant(struct expr *e, struct licm_writes *w, bool every_iteration){
+    /* whether 'e' (not e->next) has the same value on every iteration, and may be computed before the loop */
+    if( e->hoisted ) return true;
+    switch(e->kind){
+        case EXPR_EMPTY:
+        case EXPR_INT_LIT:
+        case EXPR_STR_LIT:
+        case EXPR_CHAR_LIT:
+        case EXPR_BOOL_LIT:
+            return true;
+        case EXPR_IDENT:
+            for( int i = 0; i < w->count; i++ )
+                if( w->syms[i] == e->symbol ) return false;
+            return !(w->globals && e->symbol->kind == SYMBOL_GLOBAL);
+        case EXPR_ASGN:
+        case EXPR_POST_INC:
+        case EXPR_POST_DEC:
+        case EXPR_ARR_LIT:
+            return false;
+        case EXPR_ARR_ACC:
+            // an element that is itself an array is only an address: reading one is a load, which an index out of bounds
+            // may fault on, and a checked index fails in bounds_check, so either is only moved from where the loop would
+            // have done it anyway
+            if( e->type->kind != TYPE_ARRAY && (w->memory || !every_iteration) ) return false;
+            if( !every_iteration && bounds_checked(e) ) return false;
+            break;
+        case EXPR_FUNC_CALL:
+            if( !e->data->func_and_args->symbol->pure ) return false;
+            break;
+        case EXPR_DIV:
+        case EXPR_MOD:
+            if( !licm_safe_divisor(e->data->operator_args->next) ) return false;
+            break;
+        default:
+            break;
+    }
+    // the right operand of && and || is not evaluated on every iteration that evaluates the left one
+    bool logical = e->kind == EXPR_AND || e->kind == EXPR_OR;
+    for( struct expr *op = licm_operands(e); op; op = op->next )
+        if( !licm_invariant(op, w, every_iteration && !(logical && op != e->data->operator_args)) ) return false;
+    return true;
+}
+
+bool licm_worth(struct expr *e){
+    /* loading a variable or a constant costs as much as loading the slot it would be hoisted to */
+    long c;
+    switch(e->kind){
+        case EXPR_EMPTY:
+        case EXPR_IDENT:
+        case EXPR_INT_LIT:
+        case EXPR_STR_LIT:
+        case EXPR_CHAR_LIT:
+        case EXPR_BOOL_LIT:
+            return false;
+        default:
+            return !e->hoisted && !expr_const_int(e, &c);
+    }
+}
+
+void licm_select_stmt(struct stmt *s, struct licm_writes *w, struct licm_loop *loop, bool every_iteration){
+    for( ; s; s = s->next ){
+        struct expr *e = s->expr_list;
+        switch(s->kind){
+            case STMT_DECL:
+                licm_select(s->decl->init_value, w, loop, every_iteration);
+                break;
+            case STMT_IF_ELSE:
+                licm_select(e, w, loop, every_iteration);
+                // the branches, the else hanging off the then
+                licm_select_stmt(s->body, w, loop, false);
+                break;
+            case STMT_FOR:
+                // the initialization and the first test run whenever the statement does, the rest maybe never
+                licm_select(e, w, loop, every_iteration);
+                licm_select(e->next, w, loop, every_iteration);
+                licm_select(e->next->next, w, loop, false);
+                licm_select_stmt(s->body, w, loop, false);
+                break;
+            case STMT_EXPR:
+            case STMT_PRINT:
+            case STMT_RETURN:
+                for( ; e; e = e->next ) licm_select(e, w, loop, every_iteration);
+                break;
+            case STMT_BLOCK:
+                licm_select_stmt(s->body, w, loop, every_iteration);
+                break;
+        }
+    }
+}
+
+void licm_select(struct expr *e, struct licm_writes *w, struct licm_loop *loop, bool every_iteration){
+    /* hoists 'e' (not e->next) if it is invariant and worth it, or else the largest such expressions among its operands */
+    if( !e || e->hoisted ) return;
+    if( licm_worth(e) && licm_invariant(e, w, every_iteration) ){
+        if( loop->count == loop->cap ){
+            loop->cap     = loop->cap ? 2 * loop->cap : 8;
+            loop->hoisted = realloc(loop->hoisted, loop->cap * sizeof(*loop->hoisted));
+            if( !loop->hoisted ) diag_fatal("Could not allocate a loop's invariant expressions");
+        }
+        loop->hoisted[loop->count++] = e;
+        return;
+    }
+    bool logical = e->kind == EXPR_AND || e->kind == EXPR_OR;
+    for( struct expr *op = licm_operands(e); op; op = op->next )
+        licm_select(op, w, loop, every_iteration && !(logical && op != e->data->operator_args));
+}
@@ -0,0 +1,41 @@
+#ifndef LICM_H
+#define LICM_H
+
+#include "stmt.h"
+#include "expr.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Loop-invariant code motion for for loops, applied during code generation (stmt_codegen).
+   An expression in a loop's condition, step or body is invariant when every value it reads is the same on each iteration:
+   no variable it reads is assigned, incremented or declared in the loop, no array element it reads may be stored to (any
+   element store, or any call to a function that is not pure, counts as one), and a global it reads is not passed to a
+   function that is not pure. The largest invariant expressions that do more than load a value are computed once into frame
+   slots before the loop, and read from there on every iteration.
+   What is computed before the loop must not be able to fail where the loop would not have: the loop is inverted so that its
+   condition is tested once before the hoisted expressions, which are computed only if the loop runs; division by anything
+   but a constant is never hoisted, and an array element only from where every iteration reads it.
+   A function is pure when calling it has no effect and its result depends only on its arguments, and it cannot fail or run
+   forever: it prints nothing, assigns only its own scalar variables, reads no global or array element, divides only by
+   constants, has no loop, and calls only pure functions (so none of them recursive). */
+
+/* invariant expressions of one loop */
+struct licm_loop {
+    struct expr **hoisted;
+    int           count, cap;
+    // frame slots in use before the loop's were taken
+    int           frame_mark;
+};
+
+/* marks the pure functions of the (resolved and typechecked) program 'ast' and forgets the counts of the last program */
+void licm_plan( struct decl *ast );
+/* finds the invariant expressions of the for statement 's' worth hoisting: none unless codegen_opts.licm */
+struct licm_loop licm_loop_plan( struct stmt *s );
+/* generates the hoisted expressions into their slots: from here on, expr_codegen reads them from there */
+void licm_loop_hoist( struct licm_loop *loop );
+/* ends the loop: its expressions are generated in full again, and its slots are free for reuse */
+void licm_loop_end( struct licm_loop *loop );
+/* prints how many expressions were hoisted out of how many loops since licm_plan */
+void licm_report( FILE *f );
+
+#endif
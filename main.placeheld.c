@@ -2,35 +2,89 @@
 #include "token.h"
 #include "decl.h"
 #include "scope.h"
+#include "diag.h"
+#include "output.h"
+#include "server.h"
+#include "str_lit.h"
+#include "codegen.h"
+#include "inline.h"
+#include "pch.h"
+#include "pratt.h"
+#include "stream.h"
+#include "arena.h"
+#include "xref.h"
+#include "profile.h"
+#include "vm.h"
+#include "jit.h"
+#include "flat.h"
 #include <string.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 typedef enum yytokentype token_t;
 
-extern FILE *yyin;
 extern int   yylex();
 extern char *yytext;
+extern int   yylineno;
 extern int   last_int_literal;
 extern char  last_char_literal;
-extern char *last_string_literal;
+extern struct str_lit last_string_literal;
 extern struct decl *ast;
 
-extern int yyparse();
+extern void scanner_set_source(char *src, size_t len);
 
 char *indent_space(int indents);
-int scan_file(char *filename, bool verbose);
-int parse_file(char *filename);
+char *read_source(char *filename, size_t *len);
+int scan_source(char *src, size_t len, bool verbose);
+int parse_source(char *src, size_t len);
+int parse_stream(char *filename, bool print_only);
+void collect_decl(struct decl *d, void *tail);
+void print_decl(struct decl *d, void *sink);
 void print_ast(struct decl *ast);
 int resolve_ast(struct decl *ast, bool verbose);
-void process_cl_args(int argc, char** argv, bool* stages, char** to_compile);
+struct decl *prepend_included(struct decl *ast);
+int generate_code(struct decl *ast, char *asm_path);
+int lookup_xref(char *index_path, char *line, char *column);
+int run_program(struct decl *ast, int *status);
+void process_cl_args(int argc, char** argv, bool* stages, char** to_compile, char** socket_path, char** out_path);
 
 /* stages */
 int SCAN  = 0,
     PARSE = 1,
     PPRINT = 2,
-    RESOLVE = 3;
+    RESOLVE = 3,
+    SERVER = 4,
+    TYPECHECK = 5,
+    CODEGEN = 6,
+    PRECOMPILE = 7,
+    XREF = 8,
+    RUN = 9;
+
+/* -inline-report: list the inlined calls after code generation */
+bool report_inlining = false;
+/* -stats: print what the optimizations did after code generation (and under -flat, what flattening saved after resolution) */
+bool print_stats = false;
+/* -include: precompiled header loaded into the global scope before resolving, and the declarations it holds */
+char *include_path = NULL;
+struct decl *included = NULL;
+/* -stream: parse the file as it is read, -chunk-size bytes at a time, rather than once all of it is in memory */
+bool stream_input = false;
+size_t stream_chunk = 65536;
+/* -xref-lookup: the index to query, and the position (line, then column) to query it at */
+char *xref_query[3] = { NULL, NULL, NULL };
+/* -jit: -run compiles the bytecode to machine code in memory and runs that, instead of interpreting it */
+bool jit_bytecode = false;
+/* -profile-report: the profile to print */
+char *profile_path = NULL;
+
+/* -print of a stream when nothing needs the AST afterwards: each declaration is printed as soon as it is parsed, then released */
+struct print_sink {
+    struct arena_mark start;
+    int printed;
+};
 
 void usage(int return_code, char *called_as){
     printf(
@@ -41,33 +95,99 @@ void usage(int return_code, char *called_as){
 "   -parse <file>   Scans <file> quietly and reports whether parse was successful\n"
 "   -print <file>   Scans and parses <file> quietly and outputs a nicely formatted version of the bminor program <file>\n"
 "   -resolve <file> Scans, parses, and builds AST for program <file> quietly, then resolves all variable references\n"
-            , called_as);
+"   -typecheck <file>\n"
+"                   Resolves <file> quietly, then typechecks it\n"
+"   -codegen <file> <asm file>\n"
+"                   Compiles <file> to x86-64 assembly written to <asm file>, to be linked with runtime.o\n"
+"   -run <file>     Typechecks <file> and runs it with the bytecode interpreter: the exit status is what main returns\n"
+"   -jit            Under -run, compiles the bytecode to x86-64 machine code in memory and runs that instead\n"
+"   -parser <engine>\n"
+"                   Parses with <engine>: bison (the default), pratt (hand-written), or compare (both, failing unless they build the same AST)\n"
+"   -flat           Resolves through flattened expressions: arrays of nodes in post order instead of trees of pointers (see flat.h)\n"
+"   -stream         Parses <file> ('-' for standard input) as it is read instead of reading all of it first, with the bison parser\n"
+"                   (with -print alone, each declaration is printed as soon as it is parsed, and then released)\n"
+"   -chunk-size <n> Reads at most <n> bytes at a time under -stream (default 65536)\n"
+"   -O0             Disables optimizations (strength reduction, inlining, peephole, loop-invariant code motion,\n"
+"                   bounds check elimination) in code generation\n"
+"   -no-bounds-check\n"
+"                   Leaves array indices unchecked in code generation (see bounds.h)\n"
+"   -profile        Instruments the code -codegen generates to count calls and loop iterations, and to write the counts\n"
+"                   to $BMINOR_PROFILE (or bminor.prof) when the program exits (see profile.h)\n"
+"   -profile-cycles As -profile, and also counts the cycles spent in each function with the time stamp counter\n"
+"   -profile-report <profile file> [<file>]\n"
+"                   Prints the functions and loops of a profile, the hottest first, with their lines of <file> if given\n"
+"   -inline-budget <n>\n"
+"                   Inlines calls to non-recursive functions of at most <n> AST nodes (default %d, 0 disables)\n"
+"   -inline-report  Lists the calls -codegen inlined\n"
+"   -jobs <n>       Generates code for <n> functions at once, on as many threads (0: one per processor; default 1):\n"
+"                   the assembly is the same whatever <n>\n"
+"   -stats          Prints how often each -codegen optimization applied, and with -flat the size of the flattened expressions\n"
+"   -precompile <file> <header file>\n"
+"                   Resolves and typechecks <file>, which may only declare (no function bodies), and saves its globals to <header file>\n"
+"   -include <header file>\n"
+"                   Starts from the globals of <header file>, as if the file it was precompiled from came first in the program\n"
+"   -xref <file> <index file>\n"
+"                   Resolves <file> quietly and writes where each of its symbols is defined and used to <index file>\n"
+"   -xref-lookup <index file> <line> <column>\n"
+"                   Prints the definition and every use of the symbol named at <line>, <column> (both from 1) of an -xref index\n"
+"   -server         Stays resident, serving compile requests framed on stdin and answering on stdout (see server.h)\n"
+"   -socket <path>  Like -server, but serves requests over a Unix domain socket created at <path>\n"
+            , called_as, DEFAULT_INLINE_BUDGET);
     exit(return_code);
 }
 
 int main(int argc, char **argv){
     // default values
-    bool stages[] = {false, false, false, false, false};
+    bool stages[] = {false, false, false, false, false, false, false, false, false, false};
     char *to_compile = "";
+    char *socket_path = NULL;
+    // the assembly file -codegen writes, or the header file -precompile does
+    char *out_path = NULL;
 
     bool run_all = true;
+    bool print_only;
+
+    out_stream = stdout;
 
     /* process CL args */
-    process_cl_args(argc, argv, stages, &to_compile);
+    process_cl_args(argc, argv, stages, &to_compile, &socket_path, &out_path);
+
+    if (stages[SERVER])
+        return socket_path ? server_run_socket(socket_path) : server_run_stdio();
+    // queries an index written earlier: there is no source to compile
+    if (xref_query[0])
+        return lookup_xref(xref_query[0], xref_query[1], xref_query[2]) ? EXIT_FAILURE : EXIT_SUCCESS;
+    // reads a profile a program wrote, and the source it was compiled from if there is one to quote
+    if (profile_path){
+        size_t len;
+        char *src = NULL;
+        if (*to_compile && !(src = read_source(to_compile, &len))) return EXIT_FAILURE;
+        int err_count = profile_report(profile_path, src);
+        free(src);
+        return err_count ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
 
     for(int i = 0; i < 4; i++)      run_all = run_all && !stages[i];
+    print_only = stages[PPRINT] && !(stages[RESOLVE] || stages[TYPECHECK] || stages[CODEGEN] || stages[PRECOMPILE] || stages[XREF] || stages[RUN]);
 
-    /* scan */
-    if (scan_file(to_compile, stages[SCAN])){
-        puts("Scan unsuccessful");
-        return EXIT_FAILURE;
+    /* every stage scans the same in-memory copy of the file: string literals in the AST point into it */
+    size_t src_len = 0;
+    char *src = NULL;
+
+    /* scan: a streamed file is only scanned as it is parsed, and the parser reports its invalid tokens */
+    if (!stream_input || stages[SCAN]){
+        src = read_source(to_compile, &src_len);
+        if (!src || scan_source(src, src_len, stages[SCAN])){
+            puts("Scan unsuccessful");
+            return EXIT_FAILURE;
+        }
+        else if (stages[SCAN])
+            puts("Scan successful");
     }
-    else if (stages[SCAN])
-        puts("Scan successful");
 
     /* parse */
-    if (stages[PARSE] || stages[PPRINT] || stages[RESOLVE]) {
-        if (parse_file(to_compile)) {
+    if (stages[PARSE] || stages[PPRINT] || stages[RESOLVE] || stages[TYPECHECK] || stages[CODEGEN] || stages[PRECOMPILE] || stages[XREF] || stages[RUN]) {
+        if (stream_input ? parse_stream(to_compile, print_only) : parse_source(src, src_len)) {
             puts("Parse unsuccessful");
             return EXIT_FAILURE;
         }
@@ -76,13 +196,12 @@ int main(int argc, char **argv){
     }
     
     /* print */
-    if (stages[PPRINT]) { print_ast(ast); puts(""); }
+    if (stages[PPRINT] && !(stream_input && print_only)) { print_ast(ast); puts(""); }
 
     /* resolve */
-    // if resolve or typecheck or...
-    if (stages[RESOLVE]){
+    if (stages[RESOLVE] || stages[TYPECHECK] || stages[CODEGEN] || stages[PRECOMPILE] || stages[XREF] || stages[RUN]){
         int err_count = resolve_ast(ast, stages[RESOLVE]);
-        puts("");
+        if (stages[RESOLVE]) puts("");
         if(err_count){
             printf("Encountered %d name resolution error%s\n", err_count, err_count == 1 ? "" : "s");
             puts("Name resolution unsuccessful");
@@ -91,12 +210,57 @@ int main(int argc, char **argv){
         else if(stages[RESOLVE]){
             puts("Name resolution successful");
         }
+        if (print_stats && resolve_flat) flat_stats(stdout);
+    }
+
+    /* typecheck */
+    if (stages[TYPECHECK] || stages[CODEGEN] || stages[PRECOMPILE] || stages[RUN]){
+        // the included declarations too: a snapshot is only a file, and may not be what pch_write wrote
+        int err_count = decl_typecheck(included) + decl_typecheck(ast);
+        if(err_count){
+            printf("Encountered %d type error%s\n", err_count, err_count == 1 ? "" : "s");
+            puts("Type checking unsuccessful");
+            return EXIT_FAILURE;
+        }
+        else if(stages[TYPECHECK]){
+            puts("Type checking successful");
+        }
+    }
+
+    /* cross-reference: only the file's own declarations, before the included ones join them */
+    if (stages[XREF] && xref_write(ast, out_path)){
+        puts("Cross-reference unsuccessful");
+        return EXIT_FAILURE;
+    }
+
+    ast = prepend_included(ast);
+
+    /* precompile */
+    if (stages[PRECOMPILE] && pch_write(ast, out_path)){
+        puts("Precompilation unsuccessful");
+        return EXIT_FAILURE;
+    }
+
+    /* codegen */
+    if (stages[CODEGEN] && generate_code(ast, out_path)){
+        puts("Code generation unsuccessful");
+        return EXIT_FAILURE;
+    }
+    else if (stages[CODEGEN]){
+        if (report_inlining) inline_report(stdout);
+        if (print_stats)     codegen_stats(stdout);
+    }
+
+    /* run: what main returns is the exit status, as it is for a compiled program */
+    if (stages[RUN]){
+        int status;
+        return run_program(ast, &status) ? EXIT_FAILURE : status;
     }
 
     return EXIT_SUCCESS;
 }
 
-void process_cl_args(int argc, char **argv, bool *stages, char **to_compile){ 
+void process_cl_args(int argc, char **argv, bool *stages, char **to_compile, char **socket_path, char **out_path){ 
 
     for (int i = 1; i < argc; i++){
         if (!strcmp("-scan", argv[i])){
@@ -111,6 +275,111 @@ void process_cl_args(int argc, char **argv, bool *stages, char **to_compile){
         else if (!strcmp("-resolve", argv[i])){
             stages[RESOLVE] = true;
         }
+        else if (!strcmp("-typecheck", argv[i])){
+            stages[TYPECHECK] = true;
+        }
+        else if (!strcmp("-run", argv[i])){
+            stages[RUN] = true;
+        }
+        else if (!strcmp("-codegen", argv[i])){
+            // the file to compile, then the assembly file to write
+            if (i + 2 >= argc || **to_compile)  usage(EXIT_FAILURE, argv[0]);
+            stages[CODEGEN] = true;
+            *to_compile = argv[++i];
+            *out_path = argv[++i];
+        }
+        else if (!strcmp("-precompile", argv[i])){
+            // the declarations to precompile, then the header file to write
+            if (i + 2 >= argc || **to_compile)  usage(EXIT_FAILURE, argv[0]);
+            stages[PRECOMPILE] = true;
+            *to_compile = argv[++i];
+            *out_path = argv[++i];
+        }
+        else if (!strcmp("-xref", argv[i])){
+            // the file to index, then the index file to write
+            if (i + 2 >= argc || **to_compile)  usage(EXIT_FAILURE, argv[0]);
+            stages[XREF] = true;
+            *to_compile = argv[++i];
+            *out_path = argv[++i];
+        }
+        else if (!strcmp("-xref-lookup", argv[i])){
+            if (i + 3 >= argc)  usage(EXIT_FAILURE, argv[0]);
+            for (int j = 0; j < 3; j++) xref_query[j] = argv[++i];
+        }
+        else if (!strcmp("-include", argv[i])){
+            if (++i == argc)    usage(EXIT_FAILURE, argv[0]);
+            include_path = argv[i];
+        }
+        else if (!strcmp("-parser", argv[i])){
+            if (++i == argc)                    usage(EXIT_FAILURE, argv[0]);
+            if (!strcmp("bison", argv[i]))      parser_engine = PARSER_BISON;
+            else if (!strcmp("pratt", argv[i])) parser_engine = PARSER_PRATT;
+            else if (!strcmp("compare", argv[i])) parser_engine = PARSER_COMPARE;
+            else                                usage(EXIT_FAILURE, argv[0]);
+        }
+        else if (!strcmp("-flat", argv[i])){
+            resolve_flat = true;
+        }
+        else if (!strcmp("-jit", argv[i])){
+            jit_bytecode = true;
+        }
+        else if (!strcmp("-stream", argv[i])){
+            stream_input = true;
+        }
+        else if (!strcmp("-chunk-size", argv[i])){
+            char *end;
+            if (++i == argc)    usage(EXIT_FAILURE, argv[0]);
+            long n = strtol(argv[i], &end, 10);
+            if (*end || n <= 0) usage(EXIT_FAILURE, argv[0]);
+            stream_chunk = n;
+        }
+        else if (!strcmp("-O0", argv[i])){
+            codegen_opts.strength_reduce = false;
+            codegen_opts.inline_budget = 0;
+            codegen_opts.peephole = false;
+            codegen_opts.licm = false;
+            codegen_opts.bounds_elim = false;
+        }
+        else if (!strcmp("-profile", argv[i])){
+            codegen_opts.profile = true;
+        }
+        else if (!strcmp("-profile-cycles", argv[i])){
+            codegen_opts.profile = codegen_opts.profile_cycles = true;
+        }
+        else if (!strcmp("-profile-report", argv[i])){
+            if (++i == argc)    usage(EXIT_FAILURE, argv[0]);
+            profile_path = argv[i];
+        }
+        else if (!strcmp("-no-bounds-check", argv[i])){
+            codegen_opts.bounds_check = false;
+        }
+        else if (!strcmp("-inline-budget", argv[i])){
+            char *end;
+            if (++i == argc)    usage(EXIT_FAILURE, argv[0]);
+            codegen_opts.inline_budget = strtol(argv[i], &end, 10);
+            if (*end || codegen_opts.inline_budget < 0)  usage(EXIT_FAILURE, argv[0]);
+        }
+        else if (!strcmp("-inline-report", argv[i])){
+            report_inlining = true;
+        }
+        else if (!strcmp("-jobs", argv[i])){
+            char *end;
+            if (++i == argc)    usage(EXIT_FAILURE, argv[0]);
+            long n = strtol(argv[i], &end, 10);
+            if (*end || n < 0 || n > 1024)  usage(EXIT_FAILURE, argv[0]);
+            codegen_opts.jobs = n ? n : sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        else if (!strcmp("-stats", argv[i])){
+            print_stats = true;
+        }
+        else if (!strcmp("-server", argv[i])){
+            stages[SERVER] = true;
+        }
+        else if (!strcmp("-socket", argv[i])){
+            if (++i == argc)    usage(EXIT_FAILURE, argv[0]);
+            stages[SERVER] = true;
+            *socket_path = argv[i];
+        }
         else if ( !strcmp("-help", argv[i]) || !strcmp("-h", argv[i]) ){
             usage(EXIT_SUCCESS, argv[0]);
         }
@@ -127,52 +396,205 @@ void print_ast(struct decl *ast){ decl_print_list(ast, 0, ";", "\n"); }
 
 int resolve_ast(struct decl *ast, bool verbose){
     struct scope *sc = scope_enter(NULL);
-    int err_count = decl_resolve(ast, sc, false, verbose);
+    int err_count = include_path ? pch_load(include_path, sc, &included) : 0;
+    if (!err_count) err_count = decl_resolve(ast, sc, false, verbose);
     scope_exit(sc);
     return err_count;
 }
 
-int parse_file(char *filename){
-    yyin = fopen(filename, "r");
-    if(!yyin) {
-        printf("[ERROR|file] Could not open %s! %s\n", filename, strerror(errno));
+struct decl *prepend_included(struct decl *ast){
+    /* the included declarations go first, where the source they were precompiled from would have been */
+    if (!included) return ast;
+    struct decl *last = included;
+    while (last->next) last = last->next;
+    last->next = ast;
+    return included;
+}
+
+int generate_code(struct decl *ast, char *asm_path){
+    /* returns the number of errors */
+    FILE *asm_file = fopen(asm_path, "w");
+    if (!asm_file){
+        diag_report(DIAG_FILE, 0, "Could not open %s! %s", asm_path, strerror(errno));
+        return 1;
+    }
+    out_stream = asm_file;
+    int err_count = codegen_program(ast);
+    out_stream = stdout;
+    fclose(asm_file);
+    // don't leave a truncated file for the assembler to trip over
+    if (err_count) remove(asm_path);
+    return err_count;
+}
+
+int run_program(struct decl *ast, int *status){
+    /* returns the number of errors, compiling to bytecode or running */
+    struct vm_program *program = vm_compile(ast);
+    if (!program){
+        puts("Bytecode compilation unsuccessful");
+        return 1;
+    }
+    int err_count;
+    if (jit_bytecode){
+        struct jit_program *native = jit_compile(program);
+        if (!native){
+            puts("JIT compilation unsuccessful");
+            vm_delete(program);
+            return 1;
+        }
+        err_count = jit_run(native, status);
+        jit_delete(native);
+    }
+    else
+        err_count = vm_run(program, status);
+    vm_delete(program);
+    return err_count;
+}
+
+int lookup_xref(char *index_path, char *line, char *column){
+    /* prints the symbol at 'line', 'column' of the index, its definition, and its other sites in source order
+        - returns the number of errors */
+    static const char *kinds[] = { [SYMBOL_LOCAL] = "local", [SYMBOL_PARAM] = "parameter", [SYMBOL_GLOBAL] = "global" };
+    char *line_end, *column_end;
+    long l = strtol(line, &line_end, 10), c = strtol(column, &column_end, 10);
+    if (*line_end || *column_end || l <= 0 || c <= 0 || l > UINT32_MAX || c > UINT32_MAX){
+        diag_report(DIAG_FILE, 0, "Not a position: %s, %s", line, column);
         return 1;
     }
+
+    struct xref_index idx;
+    if (xref_open(index_path, &idx)) return 1;
+    const struct xref_symbol *sym = xref_lookup(&idx, l, c);
+    if (!sym){
+        printf("No symbol at %ld:%ld\n", l, c);
+        xref_close(&idx);
+        return 1;
+    }
+
+    const char *kind = sym->kind <= SYMBOL_GLOBAL ? kinds[sym->kind] : "unknown";
+    if (sym->line) printf("%s (%s) defined at %u:%u\n", xref_name(&idx, sym), kind, sym->line, sym->column);
+    else           printf("%s (%s) defined in an included header\n", xref_name(&idx, sym), kind);
+    uint32_t count;
+    const struct xref_site *sites = xref_sites(&idx, sym, &count);
+    for (uint32_t i = 0; i < count; i++)
+        printf("    %s at %u:%u\n", sites[i].kind == XREF_DECLARATION ? "declared" : "used", sites[i].line, sites[i].column);
+    xref_close(&idx);
+    return 0;
+}
+
+char *read_source(char *filename, size_t *len){
+    /* Reads all of 'filename' into a malloc'd buffer followed by the two nul bytes the scanner needs to scan it in place
+        - returns NULL on failure */
+    FILE *f = fopen(filename, "r");
+    if(!f) {
+        diag_report(DIAG_FILE, 0, "Could not open %s! %s", filename, strerror(errno));
+        return NULL;
+    }
+    size_t cap = 4096, n = 0;
+    char *src = malloc(cap);
+    while (src){
+        n += fread(src + n, 1, cap - n - 2, f);
+        if (n < cap - 2) break;
+        char *bigger = realloc(src, cap *= 2);
+        if (!bigger) free(src);
+        src = bigger;
+    }
+    if (!src || ferror(f)){
+        diag_report(DIAG_FILE, 0, "Could not read %s! %s", filename, src ? strerror(errno) : "Out of memory");
+        free(src);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    src[n] = src[n + 1] = '\0';
+    *len = n;
+    return src;
+}
+
+int parse_source(char *src, size_t len){
     // 0 for success, 1 for failure
-    int to_return = yyparse();
-    fclose(yyin);
-    return to_return;
+    return parser_parse(src, len);
 }
 
-int scan_file(char *filename, bool verbose){
-    /* Runs the flex-generated scanner on the file with name given by 'filename'
+int parse_stream(char *filename, bool print_only){
+    /* Parses 'filename' ('-' for standard input) a chunk at a time as reads return, instead of waiting for all of it, then
+       sets 'ast' to its declarations, unless they are to be printed and released one at a time ('print_only')
+        - returns 1 on failure, 0 on success */
+    int fd = strcmp(filename, "-") ? open(filename, O_RDONLY) : STDIN_FILENO;
+    if (fd < 0){
+        diag_report(DIAG_FILE, 0, "Could not open %s! %s", filename, strerror(errno));
+        return 1;
+    }
+    char *chunk = malloc(stream_chunk);
+    if (!chunk) diag_fatal("Could not allocate %zu bytes to read %s", stream_chunk, filename);
+
+    // the grammar sets 'ast' to what it kept of the program, which is nothing once the stream has taken every declaration
+    struct decl *decls = NULL, **tail = &decls;
+    struct print_sink sink = { arena_mark(), 0 };
+    struct stream *s = print_only ? stream_create(print_decl, &sink) : stream_create(collect_decl, &tail);
+    int failed = 0;
+    ssize_t n = 0;
+    while (!failed && (n = read(fd, chunk, stream_chunk)) > 0)
+        failed = stream_feed(s, chunk, n);
+    if (n < 0){
+        diag_report(DIAG_FILE, 0, "Could not read %s! %s", filename, strerror(errno));
+        failed = 1;
+    }
+    else if (!failed)
+        failed = stream_finish(s);
+
+    stream_delete(s);
+    free(chunk);
+    ast = decls;
+    // an empty program prints as an empty line, as it does when printed whole
+    if (print_only && !failed && !sink.printed) puts("");
+    if (fd != STDIN_FILENO) close(fd);
+    return failed;
+}
+
+void collect_decl(struct decl *d, void *tail){
+    /* appends each declaration the stream hands over to the program */
+    struct decl ***t = tail;
+    **t = d;
+    *t = &d->next;
+}
+
+void print_decl(struct decl *d, void *sink){
+    /* prints each declaration the stream hands over the way print_ast would have, then releases the memory it was parsed into:
+       the parser reduces a declaration as soon as its last token is pushed, before the next one is scanned, so nothing past
+       it has been allocated yet */
+    struct print_sink *p = sink;
+    decl_print(d, 0, ";");
+    fputs("\n", out_stream);
+    p->printed++;
+    arena_release(p->start);
+}
+
+int scan_source(char *src, size_t len, bool verbose){
+    /* Runs the flex-generated scanner on the 'len' bytes of source at 'src'
         - returns 1 on failure, 0 on success */
 
     /* An array of strings, where token_strs[<token>] = "<token name as str>", where <token> is a value of the enum token_t and <token name as str> is the symbolic name given to <token> in the enum token_t. Substituted by the Makefile via sed, ensuring the array is up to date with token.h */
     char* token_strs[] = <token_str_arr_placeholder>;
 
-    yyin = fopen(filename, "r");
     token_t t = TOKEN_EOF;
-    if(!yyin) {
-        printf("[ERROR|file] Could not open %s! %s\n", filename, strerror(errno));
-        return 1;
-    }
+    scanner_set_source(src, len);
     do {
         t = yylex();
         int t_str_idx = t - TOKEN_EOF;
-        if (verbose) {
+        if (t == SCAN_ERR)
+            diag_report(DIAG_SCAN, yylineno, "Invalid token: %s", yytext);
+        else if (t == INTERNAL_ERR)
+            diag_report(DIAG_INTERNAL, yylineno, "Internal error: %s (sorry!)", strerror(errno));
+        else if (verbose) {
             switch(t){
-                case SCAN_ERR:
-                    fprintf(stdout, "[ERROR|scan] Invalid token: %s\n", yytext);
-                    break;
-                case INTERNAL_ERR:
-                    fprintf(stdout, "[ERROR|internal] Internal error: %s (sorry!)\n", strerror(errno));
-                    break;
                 case IDENT:
                     printf("%s %s\n", token_strs[t_str_idx], yytext);
                     break;
                 case STR_LIT:
-                    printf("%s %s\n", token_strs[t_str_idx], last_string_literal);
+                    printf("%s ", token_strs[t_str_idx]);
+                    fwrite(str_lit_bytes(&last_string_literal), 1, last_string_literal.len, stdout);
+                    puts("");
                     break;
                 case INT_LIT:
                     printf("%s %d\n", token_strs[t_str_idx], last_int_literal);
@@ -185,12 +607,6 @@ int scan_file(char *filename, bool verbose){
                     break;
             }
         } 
-        if( t == STR_LIT ) free(last_string_literal);
     } while( !(t == TOKEN_EOF || t == SCAN_ERR || t == INTERNAL_ERR) );
-    fclose(yyin);
     return t != TOKEN_EOF;
 }
-
-void indent(int indents){
-    for(int i = 0; i < indents; i++) fputs("\t", stdout);
-}
@@ -0,0 +1,36 @@
+#include "output.h"
+#include "arena.h"
+#include <stdlib.h>
+
+// set by whoever drives the stages (main, bminor_compile): stdout is not a constant expression, so it cannot be the initializer
+FILE *out_stream = NULL;
+
+// stream out_stream pointed to before output_capture_begin, and the capture's memory stream state
+static FILE  *captured_stream = NULL;
+static char  *capture_buf     = NULL;
+static size_t capture_len     = 0;
+
+void indent(int indents){
+    for(int i = 0; i < indents; i++) fputs("\t", out_stream);
+}
+
+void output_capture_begin(){
+    FILE *capture = open_memstream(&capture_buf, &capture_len);
+    if( !capture ) return;
+    captured_stream = out_stream;
+    out_stream = capture;
+}
+
+char *output_capture_end(){
+    // open_memstream failed: whatever was printed went to the real stream
+    if( !captured_stream ) return "?";
+
+    fclose(out_stream);
+    out_stream = captured_stream;
+    captured_stream = NULL;
+
+    char *s = arena_strndup(capture_buf, capture_len);
+    free(capture_buf);
+    capture_buf = NULL;
+    return s;
+}
@@ -0,0 +1,15 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdio.h>
+
+/* stream all printing stages write to: stdout for the command line tool, a memory stream owned by a libbminor context otherwise */
+extern FILE *out_stream;
+
+void indent( int indents );
+
+/* redirect out_stream into a string until output_capture_end, which returns what was printed (arena allocated): lets diagnostics quote AST printers. Does not nest */
+void  output_capture_begin();
+char *output_capture_end();
+
+#endif
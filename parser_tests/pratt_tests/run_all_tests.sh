@@ -0,0 +1,27 @@
+#!/bin/bash
+
+# the hand-written parser on its own cases, then against bison on every test input of every stage:
+# -parser compare fails when the two disagree on whether a file parses or build different ASTs for it
+for testfile in good*.bminor; do
+    if ./bminor -parse -parser pratt $testfile > ${testfile}.out 2>&1; then
+        echo "$testfile success (as expected)"
+    else
+        echo "$testfile failure (INCORRECT)"
+    fi
+done
+
+for testfile in bad*.bminor; do
+    if ./bminor -parse -parser pratt $testfile > ${testfile}.out 2>&1; then
+        echo "$testfile success (INCORRECT)"
+    else
+        echo "$testfile failure (as expected)"
+    fi
+done
+
+for testfile in ../../*_tests/*_tests/*.bminor ../../codegen_tests/*_tests/*.header; do
+    if ./bminor -parse -parser compare $testfile 2>&1 | grep -q "Parsers disagree"; then
+        echo "$testfile parsers disagree (INCORRECT)"
+    else
+        echo "$testfile parsers agree (as expected)"
+    fi
+done
@@ -11,3 +11,15 @@ cd thain_tests
 ./run_all_tests.sh
 echo "-----------------"
 cd ..
+
+echo "[Pratt parser tests]"
+cd pratt_tests
+./run_all_tests.sh
+echo "-----------------"
+cd ..
+
+echo "[Streaming parser tests]"
+cd stream_tests
+./run_all_tests.sh
+echo "-----------------"
+cd ..
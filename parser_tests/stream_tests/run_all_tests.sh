@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# -stream parses a file as it arrives instead of once all of it is read: fed through a pipe a few bytes at a time, chunk
+# boundaries fall inside every kind of token, and the parse must come out as if the file had been read whole
+for testfile in good*.bminor; do
+    if ./bminor -parse -stream -chunk-size 1 - < $testfile > ${testfile}.out 2>&1 &&
+       ./bminor -parse -stream -chunk-size 7 - < $testfile >> ${testfile}.out 2>&1; then
+        echo "$testfile success (as expected)"
+    else
+        echo "$testfile failure (INCORRECT)"
+    fi
+done
+
+for testfile in bad*.bminor; do
+    if ./bminor -parse -stream -chunk-size 7 - < $testfile > ${testfile}.out 2>&1; then
+        echo "$testfile success (INCORRECT)"
+    else
+        echo "$testfile failure (as expected)"
+    fi
+done
+
+# every test input of every stage that scans: the same program (or the same syntax error, on the same line) either way;
+# a streamed -print prints each declaration as it is parsed, so it only matches -print on the files that parse
+for testfile in ../../*_tests/*_tests/*.bminor ../../codegen_tests/*_tests/*.header; do
+    ./bminor -scan $testfile > /dev/null 2>&1 || continue
+    stage=-print
+    ./bminor -parse $testfile > /dev/null 2>&1 || stage=-parse
+    if diff <(./bminor $stage $testfile 2>&1) <(./bminor $stage -stream -chunk-size 3 - < $testfile 2>&1) > /dev/null &&
+       diff <(./bminor $stage -resolve $testfile 2>&1) <(./bminor $stage -resolve -stream - < $testfile 2>&1) > /dev/null; then
+        echo "$testfile streamed parse matches (as expected)"
+    else
+        echo "$testfile streamed parse differs (INCORRECT)"
+    fi
+done
@@ -0,0 +1,374 @@
+#include "pch.h"
+#include "diag.h"
+#include "arena.h"
+#include "hash_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+
+/* identifies a snapshot, and the layout version: bump the last byte when the layout changes */
+static const char pch_magic[8] = { 'B', 'M', 'P', 'C', 'H', '\0', '\0', 2 };
+
+/* the layout, in order (integers are fixed width, strings a u32 length then their bytes):
+ *  magic, u32 globals, then per global:    str name, type, u8 initialized, [expr]
+ *  type:   u8 kind, then for arrays        u8 sized, [i64 length], type element
+ *                        for functions     type result, u32 params, (str name, type) per parameter
+ *  expr:   u8 kind, then for integers      i32 value
+ *                        chars, booleans   u8 value
+ *                        strings           str source span (its unescaped length is measured again on loading)
+ *                        array literals    u32 elements, expr per element
+ *                        unary + and -     expr operand                                                        */
+
+/* a snapshot being decoded: every read checks the bounds, and a short or corrupt file just sets 'bad' */
+struct pch_reader {
+    const unsigned char *p, *end;
+    bool bad;
+};
+
+/* internal helpers */
+int  pch_write_type(FILE *f, struct type *t, const char *ident);
+int  pch_write_expr(FILE *f, struct expr *e, const char *ident);
+void pch_write_u8(FILE *f, unsigned v);
+void pch_write_u32(FILE *f, uint32_t v);
+void pch_write_i64(FILE *f, int64_t v);
+void pch_write_str(FILE *f, const char *s, size_t len);
+struct type *pch_read_type(struct pch_reader *r, int depth);
+struct expr *pch_read_expr(struct pch_reader *r, int depth);
+const void  *pch_read_bytes(struct pch_reader *r, size_t n);
+unsigned     pch_read_u8(struct pch_reader *r);
+uint32_t     pch_read_u32(struct pch_reader *r);
+int64_t      pch_read_i64(struct pch_reader *r);
+char        *pch_read_str(struct pch_reader *r, uint32_t *len);
+
+// nesting past this in a snapshot can only be corruption: stops a bad file from recursing without end
+#define PCH_MAX_DEPTH   256
+
+int pch_write(struct decl *ast, const char *path){
+    int err_count = 0;
+    for( struct decl *d = ast; d; d = d->next ){
+        if( d->func_body ){
+            diag_report(DIAG_FILE, 0, "Function %s has a body: a precompiled header holds declarations only", d->ident);
+            err_count++;
+        }
+    }
+    if( err_count ) return err_count;
+
+    FILE *f = fopen(path, "wb");
+    if( !f ){
+        diag_report(DIAG_FILE, 0, "Could not open %s! %s", path, strerror(errno));
+        return 1;
+    }
+    // a function prototyped more than once is a single global
+    struct hash_table *written = hash_table_create(0, 0);
+    if( !written ) diag_fatal("Could not allocate the table of precompiled globals");
+    uint32_t globals = 0;
+    for( struct decl *d = ast; d; d = d->next )
+        if( hash_table_insert(written, d->ident, d) ) globals++;
+    hash_table_clear(written);
+
+    fwrite(pch_magic, 1, sizeof(pch_magic), f);
+    pch_write_u32(f, globals);
+    for( struct decl *d = ast; d; d = d->next ){
+        if( !hash_table_insert(written, d->ident, d) ) continue;
+        // the symbol's type is the first declaration's, which later ones were checked against
+        pch_write_str(f, d->ident, strlen(d->ident));
+        err_count += pch_write_type(f, d->symbol->type, d->ident);
+        pch_write_u8(f, d->init_value != NULL);
+        if( d->init_value ) err_count += pch_write_expr(f, d->init_value, d->ident);
+    }
+    hash_table_delete(written);
+
+    if( ferror(f) ){
+        diag_report(DIAG_FILE, 0, "Could not write %s! %s", path, strerror(errno));
+        err_count++;
+    }
+    if( fclose(f) && !err_count ){
+        diag_report(DIAG_FILE, 0, "Could not write %s! %s", path, strerror(errno));
+        err_count++;
+    }
+    // don't leave a partial snapshot for a later compile to load
+    if( err_count ) remove(path);
+    return err_count;
+}
+
+int pch_load(const char *path, struct scope *sc, struct decl **decls){
+    *decls = NULL;
+    FILE *f = fopen(path, "rb");
+    if( !f ){
+        diag_report(DIAG_FILE, 0, "Could not open %s! %s", path, strerror(errno));
+        return 1;
+    }
+    size_t cap = 4096, n = 0;
+    unsigned char *buf = malloc(cap);
+    while( buf ){
+        n += fread(buf + n, 1, cap - n, f);
+        if( n < cap ) break;
+        unsigned char *bigger = realloc(buf, cap *= 2);
+        if( !bigger ) free(buf);
+        buf = bigger;
+    }
+    if( !buf || ferror(f) ){
+        diag_report(DIAG_FILE, 0, "Could not read %s! %s", path, buf ? strerror(errno) : "Out of memory");
+        free(buf);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    struct pch_reader r = { buf, buf + n, false };
+    const void *magic = pch_read_bytes(&r, sizeof(pch_magic));
+    if( !magic || memcmp(magic, pch_magic, sizeof(pch_magic)) ){
+        diag_report(DIAG_FILE, 0, "%s is not a precompiled header, or was written by another version of bminor", path);
+        free(buf);
+        return 1;
+    }
+
+    int err_count = 0;
+    struct decl *tail = NULL;
+    uint32_t globals = pch_read_u32(&r);
+    for( uint32_t i = 0; i < globals && !r.bad; i++ ){
+        char *name = pch_read_str(&r, NULL);
+        struct type *t = pch_read_type(&r, 0);
+        struct expr *init = pch_read_u8(&r) ? pch_read_expr(&r, 0) : NULL;
+        if( r.bad ) break;
+        // no declaration the typechecker passes is one of these, and neither has storage to initialize: the rest is left to the typechecker
+        if( init && (t->kind == TYPE_VOID || t->kind == TYPE_FUNCTION) ){
+            diag_report(DIAG_FILE, 0, "%s initializes %s, which is %s", path, name, type_to_str(t));
+            err_count++;
+            continue;
+        }
+
+        struct decl *d = decl_create(name, t, init, NULL);
+        d->symbol = scope_bind(sc, name, symbol_create(SYMBOL_GLOBAL, t, name, false));
+        if( !d->symbol ){
+            diag_report(DIAG_RESOLVE, 0, "%s declares %s twice", path, name);
+            err_count++;
+            continue;
+        }
+        // the parameters get their symbols too, which the typechecker looks at
+        if( t->kind == TYPE_FUNCTION ){
+            struct scope *params = scope_enter(sc);
+            err_count += decl_resolve(t->params, params, true, false);
+            scope_exit(params);
+        }
+        if( tail ) tail->next = d;
+        else       *decls = d;
+        tail = d;
+    }
+    if( r.bad || r.p != r.end ){
+        diag_report(DIAG_FILE, 0, "%s is truncated or corrupt", path);
+        err_count++;
+    }
+    free(buf);
+    return err_count;
+}
+
+/* writing =============================================================== */
+
+int pch_write_type(FILE *f, struct type *t, const char *ident){
+    pch_write_u8(f, t->kind);
+    if( t->kind == TYPE_ARRAY ){
+        long len;
+        pch_write_u8(f, t->arr_sz != NULL);
+        if( t->arr_sz ){
+            // the typechecker only lets constant lengths through
+            if( !expr_const_int(t->arr_sz, &len) ){
+                diag_report(DIAG_INTERNAL, 0, "Length of array %s is not a constant", ident);
+                return 1;
+            }
+            pch_write_i64(f, len);
+        }
+        return pch_write_type(f, t->subtype, ident);
+    }
+    if( t->kind == TYPE_FUNCTION ){
+        int err_count = pch_write_type(f, t->subtype, ident);
+        uint32_t params = 0;
+        for( struct decl *p = t->params; p; p = p->next ) params++;
+        pch_write_u32(f, params);
+        for( struct decl *p = t->params; p; p = p->next ){
+            pch_write_str(f, p->ident, strlen(p->ident));
+            err_count += pch_write_type(f, p->type, ident);
+        }
+        return err_count;
+    }
+    return 0;
+}
+
+int pch_write_expr(FILE *f, struct expr *e, const char *ident){
+    /* global initializers are constants (see expr_is_constant) */
+    pch_write_u8(f, e->kind);
+    switch(e->kind){
+        case EXPR_INT_LIT:
+            pch_write_u32(f, (uint32_t) e->data->int_data);
+            return 0;
+        case EXPR_CHAR_LIT:
+            pch_write_u8(f, (unsigned char) e->data->char_data);
+            return 0;
+        case EXPR_BOOL_LIT:
+            pch_write_u8(f, e->data->bool_data);
+            return 0;
+        case EXPR_STR_LIT: {
+            // the source span, so the literal prints and unescapes exactly as it would have from the header's source
+            struct str_lit *lit = e->data->str_data;
+            pch_write_str(f, lit->src, lit->src_len);
+            return 0;
+        }
+        case EXPR_ARR_LIT: {
+            int err_count = 0;
+            uint32_t elements = 0;
+            for( struct expr *el = e->data->arr_elements; el; el = el->next ) elements++;
+            pch_write_u32(f, elements);
+            for( struct expr *el = e->data->arr_elements; el; el = el->next ) err_count += pch_write_expr(f, el, ident);
+            return err_count;
+        }
+        case EXPR_ADD_ID:
+        case EXPR_ADD_INV:
+            return pch_write_expr(f, e->data->operator_args->next, ident);
+        default:
+            diag_report(DIAG_INTERNAL, 0, "Initializer %s of %s is not a constant", expr_to_str(e), ident);
+            return 1;
+    }
+}
+
+void pch_write_u8(FILE *f, unsigned v){ fputc(v, f); }
+void pch_write_u32(FILE *f, uint32_t v){ fwrite(&v, sizeof(v), 1, f); }
+void pch_write_i64(FILE *f, int64_t v){ fwrite(&v, sizeof(v), 1, f); }
+
+void pch_write_str(FILE *f, const char *s, size_t len){
+    pch_write_u32(f, len);
+    fwrite(s, 1, len, f);
+}
+
+/* reading =============================================================== */
+
+struct type *pch_read_type(struct pch_reader *r, int depth){
+    if( depth > PCH_MAX_DEPTH ) r->bad = true;
+    if( r->bad ) return NULL;
+
+    type_t kind = pch_read_u8(r);
+    switch(kind){
+        case TYPE_VOID:
+        case TYPE_BOOLEAN:
+        case TYPE_CHAR:
+        case TYPE_INTEGER:
+        case TYPE_STRING:
+            return type_create(kind, NULL, NULL, NULL);
+        case TYPE_ARRAY: {
+            struct expr *arr_sz = NULL;
+            if( pch_read_u8(r) ){
+                // the typechecker only lets positive integers through
+                int64_t len = pch_read_i64(r);
+                if( len <= 0 || len > INT32_MAX ) r->bad = true;
+                arr_sz = expr_create_integer_literal(len);
+            }
+            struct type *subtype = pch_read_type(r, depth + 1);
+            return type_create(TYPE_ARRAY, subtype, arr_sz, NULL);
+        }
+        case TYPE_FUNCTION: {
+            struct type *subtype = pch_read_type(r, depth + 1);
+            struct decl *params = NULL, *tail = NULL;
+            uint32_t n = pch_read_u32(r);
+            for( uint32_t i = 0; i < n && !r->bad; i++ ){
+                char *name = pch_read_str(r, NULL);
+                struct decl *p = decl_create(name, pch_read_type(r, depth + 1), NULL, NULL);
+                if( tail ) tail->next = p;
+                else       params = p;
+                tail = p;
+            }
+            return type_create(TYPE_FUNCTION, subtype, NULL, params);
+        }
+        default:
+            r->bad = true;
+            return NULL;
+    }
+}
+
+struct expr *pch_read_expr(struct pch_reader *r, int depth){
+    if( depth > PCH_MAX_DEPTH ) r->bad = true;
+    if( r->bad ) return NULL;
+
+    expr_t kind = pch_read_u8(r);
+    switch(kind){
+        case EXPR_INT_LIT:
+            return expr_create_integer_literal((int32_t) pch_read_u32(r));
+        case EXPR_CHAR_LIT:
+            return expr_create_char_literal(pch_read_u8(r));
+        case EXPR_BOOL_LIT:
+            return expr_create_boolean_literal(pch_read_u8(r));
+        case EXPR_STR_LIT: {
+            uint32_t src_len;
+            struct str_lit lit = { .bytes = NULL };
+            lit.src     = pch_read_str(r, &src_len);
+            lit.src_len = src_len;
+            // a span the scanner couldn't have produced would have str_lit_bytes write past the end of its copy
+            if( src_len > INT_MAX || !str_lit_measure(&lit) ) r->bad = true;
+            return expr_create_string_literal(lit);
+        }
+        case EXPR_ARR_LIT: {
+            struct expr *elements = NULL, *tail = NULL;
+            uint32_t n = pch_read_u32(r);
+            // neither parser makes an empty one
+            if( !n ) r->bad = true;
+            for( uint32_t i = 0; i < n && !r->bad; i++ ){
+                struct expr *el = pch_read_expr(r, depth + 1);
+                if( !el ) break;
+                if( tail ) tail->next = el;
+                else       elements = el;
+                tail = el;
+            }
+            return expr_create_array_literal(elements);
+        }
+        case EXPR_ADD_ID:
+        case EXPR_ADD_INV: {
+            struct expr *operand = pch_read_expr(r, depth + 1);
+            return operand ? expr_create_oper(kind, NULL, operand) : NULL;
+        }
+        default:
+            r->bad = true;
+            return NULL;
+    }
+}
+
+const void *pch_read_bytes(struct pch_reader *r, size_t n){
+    if( r->bad || (size_t) (r->end - r->p) < n ){
+        r->bad = true;
+        return NULL;
+    }
+    const void *bytes = r->p;
+    r->p += n;
+    return bytes;
+}
+
+unsigned pch_read_u8(struct pch_reader *r){
+    const unsigned char *b = pch_read_bytes(r, 1);
+    return b ? *b : 0;
+}
+
+uint32_t pch_read_u32(struct pch_reader *r){
+    uint32_t v = 0;
+    const void *b = pch_read_bytes(r, sizeof(v));
+    if( b ) memcpy(&v, b, sizeof(v));
+    return v;
+}
+
+int64_t pch_read_i64(struct pch_reader *r){
+    int64_t v = 0;
+    const void *b = pch_read_bytes(r, sizeof(v));
+    if( b ) memcpy(&v, b, sizeof(v));
+    return v;
+}
+
+char *pch_read_str(struct pch_reader *r, uint32_t *len){
+    /* arena copy, nul terminated: the AST outlives the snapshot's buffer */
+    uint32_t n = pch_read_u32(r);
+    const char *b = pch_read_bytes(r, n);
+    if( !b ) n = 0;
+    char *s = arena_alloc(n + 1);
+    memcpy(s, b ? b : "", n);
+    s[n] = '\0';
+    if( len ) *len = n;
+    return s;
+}
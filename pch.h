@@ -0,0 +1,20 @@
+#ifndef PCH_H
+#define PCH_H
+
+#include "decl.h"
+#include "scope.h"
+
+/* Precompiled declaration headers: the global scope a declaration-only file resolves to, saved so that compiles sharing the file
+   load its symbols and types straight into their global scope instead of scanning, parsing and resolving it again.
+   A snapshot holds one entry per global: its name, its type and, for variables, the constant initializer.
+   Loading one is equivalent to prepending the file it was made from to the program: its declarations come first in the AST,
+   and the program may define the functions it prototypes.
+   Snapshots are binary, in the byte order of the machine that wrote them: they are a build cache, not an interchange format. */
+
+/* writes the globals declared in 'ast' (resolved and typechecked, with no function bodies) to 'path': returns the number of errors */
+int pch_write( struct decl *ast, const char *path );
+/* binds the globals of the snapshot at 'path' in the global scope 'sc', and sets '*decls' to their declarations, which are
+   still to be typechecked: returns the number of errors */
+int pch_load( const char *path, struct scope *sc, struct decl **decls );
+
+#endif
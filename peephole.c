@@ -0,0 +1,319 @@
+#include "peephole.h"
+#include "hash_table.h"
+#include "diag.h"
+#include <stdint.h>
+#include <string.h>
+
+// instructions, and labels, the liveness search looks at before giving up and calling a register live
+#define LIVENESS_BUDGET 64
+#define LIVENESS_LABELS 16
+
+typedef bool (*peep_fn)(struct insn *i);
+
+/* internal helpers */
+#define PEEP_PROTO(name, fn, desc) bool fn(struct insn *i);
+PEEPHOLE_TABLE(PEEP_PROTO)
+#undef PEEP_PROTO
+bool is_op(struct insn *i, opcode_t op);
+bool is_jump(opcode_t op);
+bool opnd_equal(struct operand *a, struct operand *b);
+bool opnd_mentions(struct operand *o, reg_t r);
+bool opnd_imm32(struct operand *o);
+void insn_regs(struct insn *i, reg_t r, bool *reads, bool *writes);
+bool reg_dead_after(struct insn *i, reg_t r);
+bool reg_dead_from(struct insn *j, reg_t r, int *budget, struct insn **seen, int *nseen);
+
+static const peep_fn peep_fns[PEEP_COUNT] = {
+#define PEEP_FN(name, fn, desc) [name] = fn,
+    PEEPHOLE_TABLE(PEEP_FN)
+#undef PEEP_FN
+};
+static const char *peep_descs[PEEP_COUNT] = {
+#define PEEP_DESC(name, fn, desc) [name] = desc,
+    PEEPHOLE_TABLE(PEEP_DESC)
+#undef PEEP_DESC
+};
+
+static int peep_hits[PEEP_COUNT];
+/* label name -> its INSN_LABEL, for following jumps: rules never remove labels */
+static __thread struct hash_table *labels = NULL;
+
+void peephole_run(){
+    labels = hash_table_create(0, 0);
+    if( !labels ) diag_fatal("Could not allocate the peephole label table");
+    for( struct insn *i = codegen_insns(); i; i = i->next )
+        if( i->kind == INSN_LABEL ) hash_table_insert(labels, i->text, i);
+
+    bool changed = true;
+    while( changed ){
+        changed = false;
+        for( struct insn *i = codegen_insns(), *next; i; i = next ){
+            next = i->next;
+            struct insn *prev = i->prev;
+            for( int r = 0; r < PEEP_COUNT; r++ ){
+                if( peep_fns[r](i) ){
+                    codegen_count(peep_hits[r], 1);
+                    changed = true;
+                    // 'i' may be gone: look again from where it was, so the rewrite can enable another rule there
+                    next = prev ? prev : codegen_insns();
+                    break;
+                }
+            }
+        }
+    }
+    hash_table_delete(labels);
+    labels = NULL;
+}
+
+void peephole_report(FILE *f){
+    for( int r = 0; r < PEEP_COUNT; r++ )
+        fprintf(f, "Peephole: %d %s\n", peep_hits[r], peep_descs[r]);
+}
+
+void peephole_reset(){
+    memset(peep_hits, 0, sizeof(peep_hits));
+}
+
+/* rules ================================================================= */
+
+bool peep_self_move(struct insn *i){
+    /* movq %r, %r */
+    if( !is_op(i, OP_MOVQ) || i->opnd[0].kind != OPND_REG || !opnd_equal(&i->opnd[0], &i->opnd[1]) ) return false;
+    insn_remove(i);
+    return true;
+}
+
+bool peep_unreachable(struct insn *i){
+    /* nothing jumps into the middle of a block: what follows an unconditional transfer up to the next label never runs */
+    if( !is_op(i, OP_JMP) && !is_op(i, OP_RET) ) return false;
+    if( !i->next || i->next->kind != INSN_OP ) return false;
+    insn_remove(i->next);
+    return true;
+}
+
+bool peep_jump_next(struct insn *i){
+    /* jmp L; L: (possibly among other labels) */
+    if( i->kind != INSN_OP || !is_jump(i->op) ) return false;
+    for( struct insn *j = i->next; j && j->kind == INSN_LABEL; j = j->next ){
+        if( !strcmp(j->text, i->opnd[0].label) ){
+            insn_remove(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool peep_jump_over_jump(struct insn *i){
+    /* je L1; jmp L2; L1:  =>  jne L2; L1: */
+    if( !is_op(i, OP_JE) && !is_op(i, OP_JNE) ) return false;
+    struct insn *jmp = i->next;
+    if( !is_op(jmp, OP_JMP) ) return false;
+    bool over = false;
+    for( struct insn *j = jmp->next; j && j->kind == INSN_LABEL && !over; j = j->next )
+        over = !strcmp(j->text, i->opnd[0].label);
+    if( !over ) return false;
+
+    i->op = i->op == OP_JE ? OP_JNE : OP_JE;
+    i->opnd[0] = jmp->opnd[0];
+    insn_remove(jmp);
+    return true;
+}
+
+bool peep_push_pop(struct insn *i){
+    /* pushq x; popq y  =>  movq x, y (nothing, if x is y) */
+    struct insn *pop = i->next;
+    if( !is_op(i, OP_PUSHQ) || !is_op(pop, OP_POPQ) ) return false;
+    struct operand *x = &i->opnd[0], *y = &pop->opnd[0];
+    if( x->kind == OPND_MEM && y->kind == OPND_MEM ) return false;
+    if( !opnd_imm32(x) ) return false;
+
+    if( opnd_equal(x, y) ){
+        insn_remove(pop);
+        insn_remove(i);
+        return true;
+    }
+    i->op = OP_MOVQ;
+    i->opnd[1] = *y;
+    insn_remove(pop);
+    return true;
+}
+
+bool peep_store_load(struct insn *i){
+    /* movq %r, m; movq m, %s  =>  movq %r, m; movq %r, %s (left to peep_self_move when s is r) */
+    struct insn *load = i->next;
+    if( !is_op(i, OP_MOVQ) || !is_op(load, OP_MOVQ) ) return false;
+    if( i->opnd[0].kind != OPND_REG || i->opnd[1].kind != OPND_MEM ) return false;
+    if( load->opnd[1].kind != OPND_REG || !opnd_equal(&i->opnd[1], &load->opnd[0]) ) return false;
+
+    load->opnd[0] = i->opnd[0];
+    return true;
+}
+
+bool peep_copy_forward(struct insn *i){
+    /* movq x, %r; movq %r, y  =>  movq x, y when %r is not read afterwards */
+    struct insn *copy = i->next;
+    if( !is_op(i, OP_MOVQ) || !is_op(copy, OP_MOVQ) ) return false;
+    struct operand *x = &i->opnd[0], *r = &i->opnd[1], *y = &copy->opnd[1];
+    if( r->kind != OPND_REG || !opnd_equal(r, &copy->opnd[0]) || opnd_equal(r, y) ) return false;
+    // no memory to memory moves, and only 32-bit immediates have a form with a memory destination
+    if( y->kind == OPND_MEM && (x->kind == OPND_MEM || !opnd_imm32(x)) ) return false;
+    if( !reg_dead_after(copy, r->reg) ) return false;
+
+    i->opnd[1] = *y;
+    insn_remove(copy);
+    return true;
+}
+
+bool peep_fold_operand(struct insn *i){
+    /* movq x, %r; op %r, %s  =>  op x, %s when %r is not read afterwards and x is an immediate or a memory operand */
+    struct insn *use = i->next;
+    if( !is_op(i, OP_MOVQ) || !use || use->kind != INSN_OP ) return false;
+    switch(use->op){
+        case OP_ADDQ: case OP_SUBQ: case OP_IMULQ: case OP_ANDQ: case OP_XORQ: case OP_CMPQ: case OP_TESTQ:
+            break;
+        default:
+            return false;
+    }
+    struct operand *x = &i->opnd[0], *r = &i->opnd[1], *s = &use->opnd[1];
+    if( x->kind != OPND_IMM && x->kind != OPND_MEM ) return false;
+    if( !opnd_imm32(x) || r->kind != OPND_REG || s->kind != OPND_REG ) return false;
+    if( !opnd_equal(r, &use->opnd[0]) || opnd_equal(r, s) ) return false;
+    if( !reg_dead_after(use, r->reg) ) return false;
+
+    use->opnd[0] = *x;
+    insn_remove(i);
+    return true;
+}
+
+/* operands and registers ================================================ */
+
+bool is_op(struct insn *i, opcode_t op){
+    return i && i->kind == INSN_OP && i->op == op;
+}
+
+bool is_jump(opcode_t op){
+    return op == OP_JMP || op == OP_JE || op == OP_JNE || op == OP_JLE || op == OP_JAE;
+}
+
+bool opnd_equal(struct operand *a, struct operand *b){
+    if( a->kind != b->kind ) return false;
+    switch(a->kind){
+        case OPND_REG:
+        case OPND_REG8:
+            return a->reg == b->reg;
+        case OPND_IMM:
+            return a->val == b->val;
+        case OPND_LABEL:
+            return !strcmp(a->label, b->label);
+        case OPND_MEM:
+            if( (a->label == NULL) != (b->label == NULL) ) return false;
+            if( a->label ) return !strcmp(a->label, b->label) && a->val == b->val;
+            return a->reg == b->reg && a->index == b->index && (a->index == REG_NONE || a->scale == b->scale) && a->val == b->val;
+        default:
+            return true;
+    }
+}
+
+bool opnd_mentions(struct operand *o, reg_t r){
+    switch(o->kind){
+        case OPND_REG:
+        case OPND_REG8:
+        case OPND_MEM:
+            return o->reg == r || o->index == r;
+        default:
+            return false;
+    }
+}
+
+bool opnd_imm32(struct operand *o){
+    return o->kind != OPND_IMM || (o->val >= INT32_MIN && o->val <= INT32_MAX);
+}
+
+void insn_regs(struct insn *i, reg_t r, bool *reads, bool *writes){
+    /* whether 'i' reads 'r', and whether it overwrites all of it */
+    struct operand *src = &i->opnd[0], *dst = &i->opnd[1];
+    *reads = *writes = false;
+    // address registers are read whatever the operand's role
+    for( int n = 0; n < 2; n++ )
+        if( i->opnd[n].kind == OPND_MEM && opnd_mentions(&i->opnd[n], r) ) *reads = true;
+
+    switch(i->op){
+        case OP_MOVQ: case OP_MOVZBQ: case OP_LEAQ:
+            if( src->kind != OPND_MEM && opnd_mentions(src, r) ) *reads = true;
+            if( dst->kind == OPND_REG && dst->reg == r ) *writes = true;
+            break;
+        case OP_POPQ:
+            if( src->kind == OPND_REG && src->reg == r ) *writes = true;
+            *reads = *reads || r == REG_RSP;
+            break;
+        case OP_IDIVQ:
+            *reads = *reads || opnd_mentions(src, r) || r == REG_RAX || r == REG_RDX;
+            break;
+        case OP_CQO:
+            *reads  = r == REG_RAX;
+            *writes = r == REG_RDX;
+            break;
+        case OP_CLTQ:
+            *reads = r == REG_RAX;
+            break;
+        case OP_RDTSC:
+            *writes = r == REG_RAX || r == REG_RDX;
+            break;
+        case OP_REP_STOSQ:
+            *reads = r == REG_RAX || r == REG_RCX || r == REG_RDI;
+            break;
+        case OP_REP_MOVSQ:
+            *reads = r == REG_RSI || r == REG_RCX || r == REG_RDI;
+            break;
+        case OP_PUSHQ:
+            *reads = *reads || opnd_mentions(src, r) || r == REG_RSP;
+            break;
+        default:
+            // read and written in place (a partial write, for setcc), or only read (cmpq, testq)
+            *reads = *reads || opnd_mentions(src, r) || opnd_mentions(dst, r);
+            break;
+    }
+}
+
+bool reg_dead_after(struct insn *i, reg_t r){
+    /* whether every path from after 'i' overwrites 'r' before reading it */
+    struct insn *seen[LIVENESS_LABELS];
+    int budget = LIVENESS_BUDGET, nseen = 0;
+    return reg_dead_from(i->next, r, &budget, seen, &nseen);
+}
+
+bool reg_dead_from(struct insn *j, reg_t r, int *budget, struct insn **seen, int *nseen){
+    for( ; j; j = j->next ){
+        if( --*budget < 0 ) return false;
+        if( j->kind == INSN_DIRECTIVE ) return false;
+        if( j->kind == INSN_LABEL ){
+            // a label already searched from adds no new paths (a loop back to it)
+            for( int n = 0; n < *nseen; n++ )
+                if( seen[n] == j ) return true;
+            if( *nseen == LIVENESS_LABELS ) return false;
+            seen[(*nseen)++] = j;
+            continue;
+        }
+        switch(j->op){
+            case OP_CALL:
+                // the argument registers and %rax (%al, for variadic callees) are read: of the scratch registers, the callee clobbers %r10 and %r11
+                return r == REG_R10 || r == REG_R11;
+            case OP_RET:
+                return r != REG_RAX;
+            case OP_JMP: case OP_JE: case OP_JNE: case OP_JLE: case OP_JAE: {
+                struct insn *target = hash_table_lookup(labels, j->opnd[0].label);
+                if( !target || !reg_dead_from(target, r, budget, seen, nseen) ) return false;
+                if( j->op == OP_JMP ) return true;
+                // conditional: the fall through path too
+                continue;
+            }
+            default:
+                break;
+        }
+        bool reads, writes;
+        insn_regs(j, r, &reads, &writes);
+        if( reads )  return false;
+        if( writes ) return true;
+    }
+    return false;
+}
@@ -0,0 +1,38 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "codegen.h"
+#include <stdio.h>
+
+/* Peephole optimization of the instruction list, after instruction selection and before it is printed.
+   Each rule looks at a short window starting at one instruction and rewrites it in place when it matches.
+   Rules that drop a register write ask whether the register is read again before being overwritten: the search follows jumps,
+   and gives up, taking the register to be live, after a fixed number of instructions. */
+
+/* Rule table: each row expands into a peep_t enumerator, the rule's function and the description -stats prints.
+ *      name                function                description     */
+#define PEEPHOLE_TABLE(X) \
+    X(PEEP_SELF_MOVE,       peep_self_move,         "moves of a register to itself") \
+    X(PEEP_UNREACHABLE,     peep_unreachable,       "unreachable instructions after jmp or ret") \
+    X(PEEP_JUMP_NEXT,       peep_jump_next,         "jumps to the next instruction") \
+    X(PEEP_JUMP_OVER_JUMP,  peep_jump_over_jump,    "conditional jumps over a jmp, inverted") \
+    X(PEEP_PUSH_POP,        peep_push_pop,          "pushq/popq pairs turned into moves") \
+    X(PEEP_STORE_LOAD,      peep_store_load,        "loads of the value just stored") \
+    X(PEEP_COPY_FORWARD,    peep_copy_forward,      "moves into a register only copied on") \
+    X(PEEP_FOLD_OPERAND,    peep_fold_operand,      "immediates and loads folded into their use")
+
+typedef enum {
+#define PEEP_ENUM(name, fn, desc) name,
+    PEEPHOLE_TABLE(PEEP_ENUM)
+#undef PEEP_ENUM
+    PEEP_COUNT
+} peep_t;
+
+/* rewrites the instruction list (codegen_insns: a function's, run as it is generated) until no rule matches, counting the hits
+   of each rule */
+void peephole_run();
+/* prints the hits of each rule since the last peephole_reset */
+void peephole_report( FILE *f );
+void peephole_reset();
+
+#endif
@@ -0,0 +1,613 @@
+#include "pratt.h"
+#include "token.h"
+#include "stmt.h"
+#include "diag.h"
+#include "arena.h"
+#include <setjmp.h>
+#include <string.h>
+
+extern int   yylex();
+extern int   yyparse();
+extern char *yytext;
+extern int   yylineno;
+extern int   last_int_literal;
+extern char  last_char_literal;
+extern struct str_lit last_string_literal;
+extern void  scanner_set_source(char *src, size_t len);
+extern struct decl *ast;
+
+parser_engine_t parser_engine = PARSER_BISON;
+
+/* Operator tokens and the expression kind each one makes in prefix position, and after an operand (infix or postfix).
+ * Everything else about an operator comes from EXPR_TABLE.
+ *      token       prefix              after an operand    */
+#define PRATT_OPERATOR_TABLE(X) \
+    X(ASGN,         EXPR_EMPTY,         EXPR_ASGN) \
+    X(OR,           EXPR_EMPTY,         EXPR_OR) \
+    X(AND,          EXPR_EMPTY,         EXPR_AND) \
+    X(LT,           EXPR_EMPTY,         EXPR_LT) \
+    X(LT_EQ,        EXPR_EMPTY,         EXPR_LT_EQ) \
+    X(GT,           EXPR_EMPTY,         EXPR_GT) \
+    X(GT_EQ,        EXPR_EMPTY,         EXPR_GT_EQ) \
+    X(EQ,           EXPR_EMPTY,         EXPR_EQ) \
+    X(NOT_EQ,       EXPR_EMPTY,         EXPR_NOT_EQ) \
+    X(PLUS,         EXPR_ADD_ID,        EXPR_ADD) \
+    X(MINUS,        EXPR_ADD_INV,       EXPR_SUB) \
+    X(STAR,         EXPR_EMPTY,         EXPR_MUL) \
+    X(SLASH,        EXPR_EMPTY,         EXPR_DIV) \
+    X(PRCT,         EXPR_EMPTY,         EXPR_MOD) \
+    X(CARET,        EXPR_EMPTY,         EXPR_EXP) \
+    X(NOT,          EXPR_NOT,           EXPR_EMPTY) \
+    X(INC,          EXPR_EMPTY,         EXPR_POST_INC) \
+    X(DEC,          EXPR_EMPTY,         EXPR_POST_DEC)
+
+/* a scanned token, with what the scanner's globals held for it: the parser looks one token past the current one */
+struct pratt_token {
+    int  kind;
+    int  line;
+    // identifiers only, as the scanner gives it in yylloc
+    int  column;
+    // identifiers and invalid tokens (arena copy)
+    char *text;
+    int  int_val;
+    char char_val;
+    struct str_lit str_val;
+};
+
+/* what a '{' turned out to open: a block (or function body) or an array literal */
+struct pratt_brace {
+    struct stmt *stmts;
+    struct expr *lit;
+};
+
+static struct pratt_token cur, peeked;
+static bool    has_peeked = false;
+// where a syntax error unwinds to: the parse stops at the first one, as yyparse does
+static jmp_buf pratt_error;
+
+/* internal helpers */
+void  pratt_scan(struct pratt_token *t);
+void  pratt_advance();
+int   pratt_peek();
+void  pratt_expect(int kind);
+void  pratt_fail() __attribute__((noreturn));
+expr_t pratt_prefix(int token);
+expr_t pratt_after(int token);
+char *pratt_ident();
+struct decl *pratt_at(struct decl *d, struct pratt_token *name);
+struct decl *pratt_decls();
+struct decl *pratt_decl();
+struct decl *pratt_params();
+struct type *pratt_type();
+struct stmt *pratt_stmt();
+void  pratt_stmt_or_expr(struct stmt **s, struct expr **e);
+struct stmt *pratt_stmts_until_brace(struct stmt *first);
+struct stmt *pratt_if();
+struct stmt *pratt_for();
+bool  pratt_dangles(struct stmt *s);
+void  pratt_brace(struct pratt_brace *b);
+struct expr *pratt_expr(int min_prec);
+struct expr *pratt_binary(struct expr *left, int min_prec);
+struct expr *pratt_unary();
+struct expr *pratt_postfix(struct expr *e);
+struct expr *pratt_primary();
+struct expr *pratt_expr_list(int close);
+struct expr *pratt_maybe_expr(int close);
+bool  pratt_same_decl(struct decl *a, struct decl *b);
+bool  pratt_same_type(struct type *a, struct type *b);
+bool  pratt_same_stmt(struct stmt *a, struct stmt *b);
+bool  pratt_same_expr(struct expr *a, struct expr *b);
+
+int parser_parse(char *src, size_t len){
+    scanner_set_source(src, len);
+    if( parser_engine == PARSER_BISON ) return yyparse();
+    if( parser_engine == PARSER_PRATT ) return pratt_parse();
+
+    int bison_failed = yyparse();
+    struct decl *bison_ast = ast;
+    // bison has already reported whatever is wrong with the source
+    bool was_echoing = diag_set_echo(false);
+    scanner_set_source(src, len);
+    int pratt_failed = pratt_parse();
+    diag_set_echo(was_echoing);
+
+    if( !bison_failed != !pratt_failed ){
+        diag_report(DIAG_INTERNAL, 0, "Parsers disagree: bison %s the source, pratt %s it",
+                    bison_failed ? "rejects" : "accepts", pratt_failed ? "rejects" : "accepts");
+        return 1;
+    }
+    if( !bison_failed && !pratt_same_decl(bison_ast, ast) ){
+        diag_report(DIAG_INTERNAL, 0, "Parsers disagree: bison and pratt build different ASTs");
+        return 1;
+    }
+    return bison_failed;
+}
+
+int pratt_parse(){
+    ast = NULL;
+    has_peeked = false;
+    if( setjmp(pratt_error) ) return 1;
+
+    pratt_advance();
+    struct decl *decls = pratt_decls();
+    if( cur.kind != TOKEN_EOF ) pratt_fail();
+    ast = decls;
+    return 0;
+}
+
+/* tokens ================================================================ */
+
+void pratt_scan(struct pratt_token *t){
+    t->kind = yylex();
+    t->line = yylineno;
+    switch(t->kind){
+        case IDENT:
+            t->column = yylloc.first_column;
+            // fall through
+        case SCAN_ERR:
+            t->text = arena_strdup(yytext);
+            break;
+        case INT_LIT:
+            t->int_val = last_int_literal;
+            break;
+        case CHAR_LIT:
+            t->char_val = last_char_literal;
+            break;
+        case STR_LIT:
+            t->str_val = last_string_literal;
+            break;
+        default:
+            break;
+    }
+}
+
+void pratt_advance(){
+    if( has_peeked ){
+        cur = peeked;
+        has_peeked = false;
+    }
+    else pratt_scan(&cur);
+}
+
+int pratt_peek(){
+    if( !has_peeked ){
+        pratt_scan(&peeked);
+        has_peeked = true;
+    }
+    return peeked.kind;
+}
+
+void pratt_expect(int kind){
+    if( cur.kind != kind ) pratt_fail();
+    pratt_advance();
+}
+
+void pratt_fail(){
+    /* 'cur' cannot continue the program: reported the way yyerror reports it */
+    switch(cur.kind){
+        case SCAN_ERR:
+            diag_report(DIAG_SCAN, cur.line, "Invalid token: %s", cur.text);
+            break;
+        case INTERNAL_ERR:
+            diag_report(DIAG_INTERNAL, cur.line, "Scanner failed to allocate memory");
+            break;
+        default:
+            diag_report(DIAG_PARSE, cur.line, "syntax error");
+            break;
+    }
+    longjmp(pratt_error, 1);
+}
+
+expr_t pratt_prefix(int token){
+    switch(token){
+#define PRATT_PREFIX(tok, prefix, after) case tok: return prefix;
+        PRATT_OPERATOR_TABLE(PRATT_PREFIX)
+#undef PRATT_PREFIX
+        default: return EXPR_EMPTY;
+    }
+}
+
+expr_t pratt_after(int token){
+    switch(token){
+#define PRATT_AFTER(tok, prefix, after) case tok: return after;
+        PRATT_OPERATOR_TABLE(PRATT_AFTER)
+#undef PRATT_AFTER
+        default: return EXPR_EMPTY;
+    }
+}
+
+char *pratt_ident(){
+    if( cur.kind != IDENT ) pratt_fail();
+    char *name = cur.text;
+    pratt_advance();
+    return name;
+}
+
+/* declarations ========================================================== */
+
+struct decl *pratt_decls(){
+    struct decl *head = NULL, *tail = NULL;
+    while( cur.kind == IDENT ){
+        struct decl *d = pratt_decl();
+        if( tail ) tail->next = d;
+        else       head = d;
+        tail = d;
+    }
+    return head;
+}
+
+struct decl *pratt_decl(){
+    /* ident : type ;  |  ident : type = expr ;  |  ident : type = { stmts } */
+    struct pratt_token at = cur;
+    char *name = pratt_ident();
+    pratt_expect(COLON);
+    struct type *t = pratt_type();
+    if( cur.kind == S_COL ){
+        pratt_advance();
+        return pratt_at(decl_create(name, t, NULL, NULL), &at);
+    }
+    pratt_expect(ASGN);
+    if( cur.kind != L_BRC ){
+        struct expr *init = pratt_expr(0);
+        pratt_expect(S_COL);
+        return pratt_at(decl_create(name, t, init, NULL), &at);
+    }
+
+    struct pratt_brace b;
+    pratt_brace(&b);
+    if( !b.lit ) return pratt_at(decl_create(name, t, NULL, b.stmts), &at);
+    // an initializer that starts with an array literal
+    struct expr *init = pratt_binary(pratt_postfix(b.lit), 0);
+    pratt_expect(S_COL);
+    return pratt_at(decl_create(name, t, init, NULL), &at);
+}
+
+struct decl *pratt_at(struct decl *d, struct pratt_token *name){
+    /* 'd', declared by the identifier token 'name' */
+    d->line   = name->line;
+    d->column = name->column;
+    return d;
+}
+
+struct type *pratt_type(){
+    type_t kind;
+    switch(cur.kind){
+        case INTEGER:   kind = TYPE_INTEGER;    break;
+        case STRING:    kind = TYPE_STRING;     break;
+        case CHAR:      kind = TYPE_CHAR;       break;
+        case BOOLEAN:   kind = TYPE_BOOLEAN;    break;
+        case VOID:      kind = TYPE_VOID;       break;
+        case ARRAY: {
+            pratt_advance();
+            pratt_expect(L_BRK);
+            struct expr *arr_sz = cur.kind == R_BRK ? NULL : pratt_expr(0);
+            pratt_expect(R_BRK);
+            struct type *subtype = pratt_type();
+            return type_create(TYPE_ARRAY, subtype, arr_sz, NULL);
+        }
+        case FUNCTION: {
+            pratt_advance();
+            struct type *subtype = pratt_type();
+            pratt_expect(L_PAR);
+            struct decl *params = pratt_params();
+            pratt_expect(R_PAR);
+            return type_create(TYPE_FUNCTION, subtype, NULL, params);
+        }
+        default:
+            pratt_fail();
+    }
+    pratt_advance();
+    return type_create(kind, NULL, NULL, NULL);
+}
+
+struct decl *pratt_params(){
+    if( cur.kind == R_PAR ) return NULL;
+    struct decl *head = NULL, *tail = NULL;
+    for( ;; ){
+        struct pratt_token at = cur;
+        char *name = pratt_ident();
+        pratt_expect(COLON);
+        struct decl *p = pratt_at(decl_create(name, pratt_type(), NULL, NULL), &at);
+        if( tail ) tail->next = p;
+        else       head = p;
+        tail = p;
+        if( cur.kind != COMMA ) return head;
+        pratt_advance();
+    }
+}
+
+/* statements ============================================================ */
+
+struct stmt *pratt_stmt(){
+    struct stmt *s;
+    struct expr *e;
+    pratt_stmt_or_expr(&s, &e);
+    if( s ) return s;
+    pratt_expect(S_COL);
+    return stmt_create(STMT_EXPR, NULL, e, NULL);
+}
+
+void pratt_stmt_or_expr(struct stmt **s, struct expr **e){
+    /* a whole statement in '*s', or an expression that may yet be an expression statement or an array literal element in '*e' */
+    *s = NULL;
+    *e = NULL;
+    switch(cur.kind){
+        case IDENT:
+            if( pratt_peek() == COLON ){
+                *s = stmt_create(STMT_DECL, pratt_decl(), NULL, NULL);
+                return;
+            }
+            break;
+        case PRINT:
+            pratt_advance();
+            *s = stmt_create(STMT_PRINT, NULL, pratt_expr_list(S_COL), NULL);
+            pratt_expect(S_COL);
+            return;
+        case RETURN:
+            pratt_advance();
+            *s = stmt_create(STMT_RETURN, NULL, pratt_maybe_expr(S_COL), NULL);
+            pratt_expect(S_COL);
+            return;
+        case IF:
+            *s = pratt_if();
+            return;
+        case FOR:
+            *s = pratt_for();
+            return;
+        case L_BRC: {
+            struct pratt_brace b;
+            pratt_brace(&b);
+            if( b.lit ) *e = pratt_binary(pratt_postfix(b.lit), 0);
+            else        *s = stmt_create(STMT_BLOCK, NULL, NULL, b.stmts);
+            return;
+        }
+        default:
+            break;
+    }
+    *e = pratt_expr(0);
+}
+
+struct stmt *pratt_stmts_until_brace(struct stmt *first){
+    /* the statements after 'first' up to the closing brace, which is consumed: returns the list starting at 'first' */
+    struct stmt *tail = first;
+    while( cur.kind != R_BRC ){
+        struct stmt *s = pratt_stmt();
+        if( tail ) tail->next = s;
+        else       first = s;
+        tail = s;
+    }
+    pratt_advance();
+    return first;
+}
+
+struct stmt *pratt_if(){
+    pratt_advance();
+    pratt_expect(L_PAR);
+    struct expr *cond = pratt_expr(0);
+    pratt_expect(R_PAR);
+    struct stmt *then = pratt_stmt();
+    if( cur.kind == ELSE ){
+        // an else belongs to the nearest if, and the grammar only lets it follow a then branch that cannot take one itself
+        if( pratt_dangles(then) ) pratt_fail();
+        pratt_advance();
+        then->next = pratt_stmt();
+    }
+    return stmt_create(STMT_IF_ELSE, NULL, cond, then);
+}
+
+struct stmt *pratt_for(){
+    pratt_advance();
+    pratt_expect(L_PAR);
+    struct expr *init = pratt_maybe_expr(S_COL);
+    pratt_expect(S_COL);
+    struct expr *cond = pratt_maybe_expr(S_COL);
+    pratt_expect(S_COL);
+    struct expr *next = pratt_maybe_expr(R_PAR);
+    pratt_expect(R_PAR);
+    struct stmt *body = pratt_stmt();
+
+    // missing parts as the grammar fills them in: nothing to do, and a condition that always holds
+    if( !init ) init = expr_create_empty();
+    if( !cond ) cond = expr_create_boolean_literal(true);
+    if( !next ) next = expr_create_empty();
+    init->next = cond;
+    cond->next = next;
+    return stmt_create(STMT_FOR, NULL, init, body);
+}
+
+bool pratt_dangles(struct stmt *s){
+    /* whether 's' is not a non_dangling_stmt of the grammar: a declaration, or ends in an if without an else */
+    switch(s->kind){
+        case STMT_DECL:     return true;
+        case STMT_IF_ELSE:  return !s->body->next || pratt_dangles(s->body->next);
+        case STMT_FOR:      return pratt_dangles(s->body);
+        default:            return false;
+    }
+}
+
+void pratt_brace(struct pratt_brace *b){
+    /* '{' then either statements or array literal elements: the first item decides which */
+    b->stmts = NULL;
+    b->lit   = NULL;
+    pratt_expect(L_BRC);
+    if( cur.kind == R_BRC ){
+        pratt_advance();
+        return;
+    }
+
+    struct stmt *s;
+    struct expr *e;
+    pratt_stmt_or_expr(&s, &e);
+    if( !s && cur.kind == S_COL ){
+        pratt_advance();
+        s = stmt_create(STMT_EXPR, NULL, e, NULL);
+    }
+    if( s ){
+        b->stmts = pratt_stmts_until_brace(s);
+        return;
+    }
+
+    struct expr *tail = e;
+    while( cur.kind == COMMA ){
+        pratt_advance();
+        tail->next = pratt_expr(0);
+        tail = tail->next;
+    }
+    pratt_expect(R_BRC);
+    b->lit = expr_create_array_literal(e);
+}
+
+/* expressions =========================================================== */
+
+struct expr *pratt_expr(int min_prec){
+    return pratt_binary(pratt_unary(), min_prec);
+}
+
+struct expr *pratt_binary(struct expr *left, int min_prec){
+    /* extends the operand 'left' with the binary operators binding at least as tightly as 'min_prec' */
+    for( ;; ){
+        expr_t kind = pratt_after(cur.kind);
+        if( expr_fixity(kind) != FIX_BINARY || expr_precedence(kind) < min_prec ) return left;
+        pratt_advance();
+        // the right operand of a left associative operator only takes tighter operators, that of a right associative one the same too
+        struct expr *right = pratt_expr(expr_precedence(kind) + !expr_right_assoc(kind));
+        left = expr_create_oper(kind, left, right);
+    }
+}
+
+struct expr *pratt_unary(){
+    expr_t kind = pratt_prefix(cur.kind);
+    if( kind == EXPR_EMPTY ) return pratt_postfix(pratt_primary());
+    pratt_advance();
+    return expr_create_oper(kind, NULL, pratt_expr(expr_precedence(kind)));
+}
+
+struct expr *pratt_postfix(struct expr *e){
+    /* subscripts and calls, then postfix operators: as in the grammar, nothing is subscripted or called after a ++ or -- */
+    for( ;; ){
+        if( cur.kind == L_BRK ){
+            pratt_advance();
+            struct expr *index = pratt_expr(0);
+            pratt_expect(R_BRK);
+            e = expr_create_array_access(e, index);
+        }
+        else if( cur.kind == L_PAR ){
+            pratt_advance();
+            struct expr *args = pratt_expr_list(R_PAR);
+            pratt_expect(R_PAR);
+            e = expr_create_function_call(e, args);
+        }
+        else break;
+    }
+    for( expr_t kind; expr_fixity(kind = pratt_after(cur.kind)) == FIX_POSTFIX; ){
+        pratt_advance();
+        e = expr_create_oper(kind, e, NULL);
+    }
+    return e;
+}
+
+struct expr *pratt_primary(){
+    struct expr *e;
+    switch(cur.kind){
+        case IDENT:
+            e = expr_create_identifier(cur.text);
+            e->line   = cur.line;
+            e->column = cur.column;
+            break;
+        case STR_LIT:   e = expr_create_string_literal(cur.str_val);    break;
+        case INT_LIT:   e = expr_create_integer_literal(cur.int_val);   break;
+        case CHAR_LIT:  e = expr_create_char_literal(cur.char_val);     break;
+        case TRUE:      e = expr_create_boolean_literal(true);          break;
+        case FALSE:     e = expr_create_boolean_literal(false);         break;
+        case L_PAR:
+            pratt_advance();
+            e = pratt_expr(0);
+            pratt_expect(R_PAR);
+            return e;
+        case L_BRC: {
+            // inside an expression, braces can only hold an array literal
+            pratt_advance();
+            struct expr *elements = pratt_expr_list(R_BRC);
+            if( !elements ) pratt_fail();
+            pratt_expect(R_BRC);
+            return expr_create_array_literal(elements);
+        }
+        default:
+            pratt_fail();
+    }
+    pratt_advance();
+    return e;
+}
+
+struct expr *pratt_expr_list(int close){
+    /* comma separated expressions, possibly none when 'close' comes first: 'close' is left for the caller */
+    if( cur.kind == close ) return NULL;
+    struct expr *head = pratt_expr(0), *tail = head;
+    while( cur.kind == COMMA ){
+        pratt_advance();
+        tail->next = pratt_expr(0);
+        tail = tail->next;
+    }
+    return head;
+}
+
+struct expr *pratt_maybe_expr(int close){
+    return cur.kind == close ? NULL : pratt_expr(0);
+}
+
+/* comparison ============================================================ */
+
+bool pratt_same_decl(struct decl *a, struct decl *b){
+    for( ; a && b; a = a->next, b = b->next ){
+        if( strcmp(a->ident, b->ident)
+            || a->line != b->line || a->column != b->column
+            || !pratt_same_type(a->type, b->type)
+            || !pratt_same_expr(a->init_value, b->init_value)
+            || !pratt_same_stmt(a->func_body, b->func_body) ) return false;
+    }
+    return !a && !b;
+}
+
+bool pratt_same_type(struct type *a, struct type *b){
+    if( !a || !b ) return a == b;
+    return a->kind == b->kind
+        && pratt_same_type(a->subtype, b->subtype)
+        && pratt_same_expr(a->arr_sz, b->arr_sz)
+        && pratt_same_decl(a->params, b->params);
+}
+
+bool pratt_same_stmt(struct stmt *a, struct stmt *b){
+    for( ; a && b; a = a->next, b = b->next ){
+        if( a->kind != b->kind
+            || !pratt_same_decl(a->decl, b->decl)
+            || !pratt_same_expr(a->expr_list, b->expr_list)
+            || !pratt_same_stmt(a->body, b->body) ) return false;
+    }
+    return !a && !b;
+}
+
+bool pratt_same_expr(struct expr *a, struct expr *b){
+    /* the lists starting at 'a' and 'b' */
+    for( ; a && b; a = a->next, b = b->next ){
+        if( a->kind != b->kind ) return false;
+        bool same;
+        switch(a->kind){
+            case EXPR_EMPTY:        same = true;                                                            break;
+            case EXPR_IDENT:        same = !strcmp(a->data->ident_name, b->data->ident_name)
+                                           && a->line == b->line && a->column == b->column;                 break;
+            case EXPR_INT_LIT:      same = a->data->int_data == b->data->int_data;                          break;
+            case EXPR_CHAR_LIT:     same = a->data->char_data == b->data->char_data;                        break;
+            case EXPR_BOOL_LIT:     same = a->data->bool_data == b->data->bool_data;                        break;
+            case EXPR_STR_LIT: {
+                struct str_lit *x = a->data->str_data, *y = b->data->str_data;
+                same = x->src_len == y->src_len && !memcmp(x->src, y->src, x->src_len);
+                break;
+            }
+            case EXPR_ARR_LIT:      same = pratt_same_expr(a->data->arr_elements, b->data->arr_elements);   break;
+            case EXPR_FUNC_CALL:    same = pratt_same_expr(a->data->func_and_args, b->data->func_and_args); break;
+            default:                same = pratt_same_expr(a->data->operator_args, b->data->operator_args); break;
+        }
+        if( !same ) return false;
+    }
+    return !a && !b;
+}
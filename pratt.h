@@ -0,0 +1,28 @@
+#ifndef PRATT_H
+#define PRATT_H
+
+#include "decl.h"
+#include <stddef.h>
+
+/* Hand-written parser: recursive descent for declarations and statements, and Pratt parsing for expressions, driven by the
+   precedence, fixity and associativity columns of EXPR_TABLE (expr.h) instead of one grammar level per precedence.
+   It accepts the same language as bminor.bison and builds the same AST, node for node; where the grammar needs more than
+   one token of lookahead to tell a function body from an array literal after '= {', or a block from an array literal at the
+   start of a statement, the choice is put off until the first item inside the braces gives it away. */
+
+typedef enum {
+    PARSER_BISON,       // the generated LALR parser (yyparse)
+    PARSER_PRATT,       // pratt_parse
+    PARSER_COMPARE      // both, failing with a diagnostic unless they agree on whether the source parses and on its AST
+} parser_engine_t;
+
+/* engine parser_parse runs: -parser on the command line */
+extern parser_engine_t parser_engine;
+
+/* parses the 'len' bytes at 'src' (padded as for scanner_set_source) with parser_engine, setting 'ast': 0 on success, like yyparse */
+int parser_parse( char *src, size_t len );
+
+/* parses what the scanner was last set to, setting 'ast': 0 on success, 1 after reporting a syntax error */
+int pratt_parse();
+
+#endif
@@ -0,0 +1,253 @@
+#include "profile.h"
+#include "codegen.h"
+#include "runtime.h"
+#include "diag.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* a site of the table being generated: its counters are a struct bminor_profile_site at 'label' */
+struct profile_site {
+    const char *label;
+    const char *function;
+    int         line, column;
+    long        kind;
+};
+
+/* a site read back from a profile */
+struct profile_entry {
+    char  kind[16];
+    char  function[256];
+    long  line, column;
+    long  count, iterations, cycles;
+};
+
+/* the functions' sites, numbered by profile_plan, then the loops' in program order (added as codegen_defer merges their functions) */
+static struct profile_site *sites = NULL;
+static int site_count = 0, site_cap = 0;
+/* function being generated (on this thread): the one its loops are in */
+static __thread const char *function_name = NULL;
+/* slot of the time stamp the function being generated started at */
+static __thread int start_slot = 0;
+
+/* internal helpers */
+void profile_site_add(void *site);
+struct operand profile_counter(const char *site, int field);
+void profile_read_tsc();
+bool profile_position(struct expr *e, int *line, int *column);
+int  profile_entry_place(const void *a, const void *b);
+int  profile_entry_heat(const void *a, const void *b);
+void profile_quote(char **lines, long line_count, long line);
+
+void profile_plan(struct decl *ast){
+    site_count = 0;
+    if( !codegen_opts.profile ) return;
+    for( struct decl *d = ast; d; d = d->next ){
+        if( !d->func_body ) continue;
+        d->symbol->profile_site = site_count;
+        profile_site_add(&(struct profile_site) { label_create(), d->ident, d->line, d->column, BMINOR_PROFILE_FUNCTION });
+    }
+}
+
+void profile_function_begin(struct decl *d){
+    function_name = d->ident;
+    if( !codegen_opts.profile ) return;
+    // loops' sites are added as functions are merged into the program, never while a worker thread is generating one
+    const char *site = sites[d->symbol->profile_site].label;
+    emit(OP_ADDQ, opnd_imm(1), profile_counter(site, 0));
+    if( !codegen_opts.profile_cycles ) return;
+    // only the outermost call is timed: it is the one that finds no other active
+    const char *nested = label_create();
+    emit(OP_ADDQ, opnd_imm(1), profile_counter(site, 3));
+    emit(OP_CMPQ, opnd_imm(1), profile_counter(site, 3));
+    emit1(OP_JNE, opnd_label(nested));
+    start_slot = frame_alloc(8);
+    profile_read_tsc();
+    emit(OP_MOVQ, opnd_reg(REG_RAX), opnd_mem(REG_RBP, start_slot));
+    emit_label(nested);
+}
+
+void profile_function_end(struct decl *d){
+    if( !codegen_opts.profile || !codegen_opts.profile_cycles ) return;
+    // the outermost call of the function is the one that leaves none active
+    const char *site = sites[d->symbol->profile_site].label, *nested = label_create();
+    emit(OP_SUBQ, opnd_imm(1), profile_counter(site, 3));
+    emit1(OP_JNE, opnd_label(nested));
+    // %rcx is no scratch register: nothing else is live here
+    emit(OP_MOVQ, opnd_reg(REG_RAX), opnd_reg(REG_RCX));
+    profile_read_tsc();
+    emit(OP_SUBQ, opnd_mem(REG_RBP, start_slot), opnd_reg(REG_RAX));
+    emit(OP_ADDQ, opnd_reg(REG_RAX), profile_counter(site, 2));
+    emit(OP_MOVQ, opnd_reg(REG_RCX), opnd_reg(REG_RAX));
+    emit_label(nested);
+}
+
+const char *profile_loop_enter(struct stmt *s){
+    if( !codegen_opts.profile ) return NULL;
+    int line = 0, column = 0;
+    for( struct expr *e = s->expr_list; e && !profile_position(e, &line, &column); e = e->next );
+    struct profile_site *site = arena_alloc(sizeof(*site));
+    *site = (struct profile_site) { label_create(), function_name, line, column, BMINOR_PROFILE_LOOP };
+    codegen_defer(profile_site_add, site);
+    emit(OP_ADDQ, opnd_imm(1), profile_counter(site->label, 0));
+    return site->label;
+}
+
+void profile_loop_iteration(const char *site){
+    if( site ) emit(OP_ADDQ, opnd_imm(1), profile_counter(site, 1));
+}
+
+void profile_table(){
+    if( !codegen_opts.profile ) return;
+    emit_directive(".data");
+    emit_directive(".globl %s", RUNTIME_PROFILE);
+    emit_directive(".align 8");
+    emit_label(RUNTIME_PROFILE);
+    emit_directive(".quad %d", site_count);
+    for( int i = 0; i < site_count; i++ ){
+        struct profile_site *site = &sites[i];
+        emit_label(site->label);
+        emit_directive(".quad 0, 0, 0, 0");
+        emit_directive(".quad %s", codegen_string(site->function, strlen(site->function)));
+        emit_directive(".quad %d, %d, %ld", site->line, site->column, site->kind);
+    }
+}
+
+int profile_report(const char *profile_path, char *src){
+    FILE *f = fopen(profile_path, "r");
+    if( !f ){
+        diag_report(DIAG_FILE, 0, "Could not open %s! %s", profile_path, strerror(errno));
+        return 1;
+    }
+    struct profile_entry *entries = NULL, e;
+    int count = 0, cap = 0, err_count = 0, fields;
+    while( (fields = fscanf(f, "%15s %255s %ld %ld %ld %ld %ld", e.kind, e.function, &e.line, &e.column, &e.count,
+                            &e.iterations, &e.cycles)) == 7 ){
+        if( strcmp(e.kind, "function") && strcmp(e.kind, "loop") ) break;
+        if( count == cap ){
+            cap     = cap ? 2 * cap : 64;
+            entries = realloc(entries, cap * sizeof(*entries));
+            if( !entries ) diag_fatal("Could not allocate the profile");
+        }
+        entries[count++] = e;
+    }
+    if( fields != EOF ){
+        diag_report(DIAG_FILE, 0, "%s is not a profile written by a program compiled with -profile", profile_path);
+        err_count++;
+    }
+    fclose(f);
+
+    // the lines of the source, to quote
+    char **lines = NULL;
+    long line_count = 0;
+    if( !err_count ){
+        for( char *p = src; p && *p; line_count++ ){
+            lines = realloc(lines, (line_count + 1) * sizeof(*lines));
+            if( !lines ) diag_fatal("Could not allocate the lines of the source");
+            lines[line_count] = p;
+            p += strcspn(p, "\n");
+            if( *p ) *p++ = '\0';
+        }
+    }
+
+    if( !err_count ){
+        qsort(entries, count, sizeof(*entries), profile_entry_heat);
+
+        long total = 0;
+        for( int i = 0; i < count; i++ )
+            if( !strcmp(entries[i].kind, "function") && entries[i].cycles > total ) total = entries[i].cycles;
+        printf("Functions, by cycles (with the calls they make), then calls:\n");
+        printf("%16s %7s %12s %14s  %s\n", "cycles", "%", "calls", "cycles/call", "function");
+        for( int i = 0; i < count; i++ ){
+            struct profile_entry *p = &entries[i];
+            if( strcmp(p->kind, "function") ) continue;
+            printf("%16ld %6.1f%% %12ld %14ld  %s at %ld:%ld\n", p->cycles, total ? 100.0 * p->cycles / total : 0.0, p->count,
+                   p->count ? p->cycles / p->count : 0, p->function, p->line, p->column);
+            profile_quote(lines, line_count, p->line);
+        }
+        printf("Loops, by iterations, then entries:\n");
+        printf("%16s %12s %14s  %s\n", "iterations", "entries", "per entry", "loop");
+        for( int i = 0; i < count; i++ ){
+            struct profile_entry *p = &entries[i];
+            if( strcmp(p->kind, "loop") ) continue;
+            printf("%16ld %12ld %14ld  in %s at %ld:%ld\n", p->iterations, p->count, p->count ? p->iterations / p->count : 0,
+                   p->function, p->line, p->column);
+            profile_quote(lines, line_count, p->line);
+        }
+    }
+    free(lines);
+    free(entries);
+    return err_count;
+}
+
+void profile_site_add(void *site){
+    if( site_count == site_cap ){
+        site_cap = site_cap ? 2 * site_cap : 64;
+        sites    = realloc(sites, site_cap * sizeof(*sites));
+        if( !sites ) diag_fatal("Could not allocate the profile sites");
+    }
+    sites[site_count++] = *(struct profile_site *) site;
+}
+
+struct operand profile_counter(const char *site, int field){
+    /* the 'field'th quadword of the site labelled 'site': its count, iterations, cycles or active calls */
+    struct operand o = opnd_sym(site);
+    o.val = 8 * field;
+    return o;
+}
+
+void profile_read_tsc(){
+    /* leaves the time stamp counter in %rax, and clobbers %rdx */
+    emit0(OP_RDTSC);
+    emit(OP_SALQ, opnd_imm(32), opnd_reg(REG_RDX));
+    emit(OP_ADDQ, opnd_reg(REG_RDX), opnd_reg(REG_RAX));
+}
+
+bool profile_position(struct expr *e, int *line, int *column){
+    /* the position of the first identifier in 'e' (not e->next): returns whether there is one */
+    if( e->kind == EXPR_IDENT ){
+        *line   = e->line;
+        *column = e->column;
+        return e->line != 0;
+    }
+    switch(e->kind){
+        case EXPR_EMPTY:
+        case EXPR_INT_LIT:
+        case EXPR_STR_LIT:
+        case EXPR_CHAR_LIT:
+        case EXPR_BOOL_LIT:
+            return false;
+        default:
+            // calls and array literals keep their operands in the same place as operators
+            for( struct expr *op = e->data->operator_args; op; op = op->next )
+                if( profile_position(op, line, column) ) return true;
+            return false;
+    }
+}
+
+int profile_entry_place(const void *a, const void *b){
+    const struct profile_entry *x = a, *y = b;
+    int c = strcmp(x->kind, y->kind);
+    if( !c ) c = strcmp(x->function, y->function);
+    if( !c ) c = (x->line > y->line) - (x->line < y->line);
+    if( !c ) c = (x->column > y->column) - (x->column < y->column);
+    return c;
+}
+
+int profile_entry_heat(const void *a, const void *b){
+    /* functions by cycles then calls, loops by iterations then entries, the most first: ties in source order */
+    const struct profile_entry *x = a, *y = b;
+    long hx = x->cycles + x->iterations, hy = y->cycles + y->iterations;
+    if( hx != hy )                  return hx < hy ? 1 : -1;
+    if( x->count != y->count )      return x->count < y->count ? 1 : -1;
+    return profile_entry_place(a, b);
+}
+
+void profile_quote(char **lines, long line_count, long line){
+    if( line < 1 || line > line_count ) return;
+    const char *text = lines[line - 1];
+    text += strspn(text, " \t");
+    printf("%16s | %s\n", "", text);
+}
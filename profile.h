@@ -0,0 +1,38 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "stmt.h"
+#include "decl.h"
+#include <stdbool.h>
+
+/* Profiling builds (-profile, codegen_opts.profile): the generated code counts, in a table it exports as RUNTIME_PROFILE
+   (see runtime.h), the calls of each function, and for each for loop how many times it is entered and how many iterations
+   it runs; with codegen_opts.profile_cycles (-profile-cycles), also the cycles spent in each function, read from the time
+   stamp counter (rdtsc). At exit the runtime writes the table to the file named by $BMINOR_PROFILE, or bminor.prof, one
+   site per line:
+       function <name> <line> <column> <calls> <iterations: 0> <cycles: 0 without -profile-cycles>
+       loop <function> <line> <column> <entries> <iterations> <cycles: 0>
+   A function's position is its name's in its declaration, a loop's that of the first identifier in its initialization,
+   condition or step (0 where there is none). A function's cycles are those from its outermost call to that call's return,
+   calls it makes included, and nested calls of a recursive function not counted again. Nothing is inlined (see inline.h)
+   in a profiling build: every call is counted and timed. */
+
+/* numbers a site for each function of the (resolved and typechecked) program 'ast' and forgets the last program's */
+void profile_plan( struct decl *ast );
+/* after the prologue of function 'd': counts the call, and under profile_cycles reads the time stamp counter */
+void profile_function_begin( struct decl *d );
+/* at the return label, where %rax holds the return value: adds the cycles since profile_function_begin, unless this is a
+   nested call of a recursive function */
+void profile_function_end( struct decl *d );
+/* at the start of for statement 's': counts the entry, and returns its site for profile_loop_iteration (NULL when not profiling) */
+const char *profile_loop_enter( struct stmt *s );
+/* at the start of each iteration of the body of the loop of site 'site' */
+void profile_loop_iteration( const char *site );
+/* emits the table of counters, after every function */
+void profile_table();
+
+/* prints the sites of the profile at 'profile_path', the hottest first, each with its line of the program's source 'src' when
+   that is not NULL (it is split into lines in place): returns the number of errors */
+int  profile_report( const char *profile_path, char *src );
+
+#endif
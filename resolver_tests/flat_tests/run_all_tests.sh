@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# -flat resolves through flattened expressions: on every program of the resolver's and the code generator's tests, it must
+# report exactly what resolving the trees does, and succeed or fail with it
+for testfile in good*.bminor ../my_tests/*.bminor ../../codegen_tests/my_tests/good*.bminor; do
+    out=$(basename ${testfile}).out
+    ./bminor -resolve $testfile > ${out}.tree 2>&1
+    tree_status=$?
+    ./bminor -resolve -flat $testfile > $out 2>&1
+    flat_status=$?
+    if [ $flat_status -ne $tree_status ] || ! cmp -s $out ${out}.tree; then
+        echo "$testfile differs (INCORRECT)"
+    elif [ $flat_status -eq 0 ]; then
+        echo "$testfile success (as expected)"
+    else
+        echo "$testfile failure (as expected)"
+    fi
+    rm -f ${out}.tree
+done
@@ -6,6 +6,18 @@ cd my_tests
 echo "-----------------"
 cd ..
 
+echo "[Cross-reference tests]"
+cd xref_tests
+./run_all_tests.sh
+echo "-----------------"
+cd ..
+
+echo "[Flattened expression tests]"
+cd flat_tests
+./run_all_tests.sh
+echo "-----------------"
+cd ..
+
 #echo "[Thain's tests]"
 #cd thain_tests
 #./run_all_tests.sh
@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# -xref writes an index of where each symbol is defined and used; each good test answers the lookups in its .queries file
+# (a line and a column each) from the index, which must print what its .expected file holds
+for testfile in good*.bminor; do
+    ./bminor -xref $testfile ${testfile}.idx > ${testfile}.out 2>&1 &&
+    while read line column; do
+        echo "> $line $column"
+        ./bminor -xref-lookup ${testfile}.idx $line $column
+    done < ${testfile}.queries >> ${testfile}.out 2>&1
+    if diff ${testfile}.out ${testfile}.expected > /dev/null; then
+        echo "$testfile success (as expected)"
+    else
+        echo "$testfile failure (INCORRECT)"
+    fi
+    rm -f ${testfile}.idx
+done
+
+for testfile in bad*.bminor; do
+    if ./bminor -xref $testfile ${testfile}.idx > ${testfile}.out 2>&1 || [ -e ${testfile}.idx ]; then
+        echo "$testfile success (INCORRECT)"
+    else
+        echo "$testfile failure (as expected)"
+    fi
+    rm -f ${testfile}.idx
+done
+
+# a source file is not an index
+if ./bminor -xref-lookup good1.bminor 1 1 > /dev/null 2>&1; then
+    echo "lookup in a source file success (INCORRECT)"
+else
+    echo "lookup in a source file failure (as expected)"
+fi
+
+# the name resolution tests that resolve: both parsers record the same positions, so they write the same index
+for testfile in ../my_tests/good*.bminor; do
+    if ./bminor -xref $testfile bison.idx > /dev/null 2>&1 && ./bminor -parser pratt -xref $testfile pratt.idx > /dev/null 2>&1 &&
+       cmp -s bison.idx pratt.idx; then
+        echo "$testfile indexed alike (as expected)"
+    else
+        echo "$testfile indexed differently (INCORRECT)"
+    fi
+    rm -f bison.idx pratt.idx
+done
@@ -0,0 +1,91 @@
+#include "runtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_SIZE (1 << 16)
+
+static char   buffer[BUFFER_SIZE];
+static size_t used = 0;
+
+/* defined only by a program compiled with -profile */
+extern struct bminor_profile bminor_profile __attribute__((weak));
+
+/* internal helpers: static, unlike the compiler's, so they cannot collide with the program's own functions */
+static void runtime_reserve(size_t n);
+static void runtime_profile_save();
+
+__attribute__((constructor))
+static void runtime_init(){
+    // exit handlers run before stdio flushes its streams, so this output still lands ahead of anything stdio holds back
+    atexit(bminor_flush);
+    if( &bminor_profile ) atexit(runtime_profile_save);
+}
+
+void bminor_print_integer(long x){
+    // digits come out least significant first: 20 covers the magnitude of any long
+    char digits[20];
+    int n = 0;
+    unsigned long m = x < 0 ? -(unsigned long) x : (unsigned long) x;
+    do {
+        digits[n++] = '0' + m % 10;
+        m /= 10;
+    } while( m );
+
+    runtime_reserve(n + 1);
+    if( x < 0 ) buffer[used++] = '-';
+    while( n ) buffer[used++] = digits[--n];
+}
+
+void bminor_print_char(long c){
+    runtime_reserve(1);
+    buffer[used++] = c;
+}
+
+void bminor_print_boolean(long b){
+    bminor_print_string(b ? "true" : "false");
+}
+
+void bminor_print_string(const char *s){
+    size_t len = strlen(s);
+    if( len > BUFFER_SIZE ){
+        bminor_flush();
+        fwrite(s, 1, len, stdout);
+        return;
+    }
+    runtime_reserve(len);
+    memcpy(buffer + used, s, len);
+    used += len;
+}
+
+void bminor_flush(){
+    if( !used ) return;
+    fwrite(buffer, 1, used, stdout);
+    used = 0;
+}
+
+void bminor_bounds_error(long index, long length, const char *function){
+    // what was printed before the access still goes out, at exit
+    fprintf(stderr, "[ERROR|runtime] Index %ld out of bounds of array of length %ld in %s\n", index, length, function);
+    exit(1);
+}
+
+static void runtime_reserve(size_t n){
+    if( used + n > BUFFER_SIZE ) bminor_flush();
+}
+
+static void runtime_profile_save(){
+    const char *path = getenv("BMINOR_PROFILE");
+    if( !path ) path = "bminor.prof";
+    FILE *f = fopen(path, "w");
+    if( !f ){
+        fprintf(stderr, "[ERROR|runtime] Could not write the profile to %s\n", path);
+        return;
+    }
+    for( long i = 0; i < bminor_profile.count; i++ ){
+        struct bminor_profile_site *s = &bminor_profile.sites[i];
+        fprintf(f, "%s %s %ld %ld %ld %ld %ld\n", s->kind == BMINOR_PROFILE_LOOP ? "loop" : "function", s->function,
+                s->line, s->column, s->count, s->iterations, s->cycles);
+    }
+    fclose(f);
+}
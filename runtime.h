@@ -0,0 +1,49 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+/* Runtime library linked with every program -codegen compiles (cc prog.s runtime.o).
+   print statements call the routine for each value's type, chosen at compile time. The routines append to a buffer that is
+   written to stdout when full, when the program exits, and before each call to a function the program only declares:
+   such a function may write to stdout itself, and its output has to come after what was printed before the call.
+   The buffer goes out through stdio, so output from C functions stays in order with it. */
+
+/* symbols the code generator calls */
+#define RUNTIME_PRINT_INTEGER   "bminor_print_integer"
+#define RUNTIME_PRINT_CHAR      "bminor_print_char"
+#define RUNTIME_PRINT_BOOLEAN   "bminor_print_boolean"
+#define RUNTIME_PRINT_STRING    "bminor_print_string"
+#define RUNTIME_FLUSH           "bminor_flush"
+#define RUNTIME_BOUNDS_ERROR    "bminor_bounds_error"
+#define RUNTIME_PROFILE         "bminor_profile"
+
+/* the table of counters a program compiled with -profile exports as RUNTIME_PROFILE: the runtime writes it out at exit
+   (see profile.h) */
+enum { BMINOR_PROFILE_FUNCTION, BMINOR_PROFILE_LOOP };
+struct bminor_profile_site {
+    // a function's calls, or the times a loop is entered
+    long count;
+    long iterations;
+    // cycles spent in a function, with the calls it makes, and its calls not returned from yet
+    long cycles;
+    long active;
+    // the function the site is in, and where
+    const char *function;
+    long line, column;
+    long kind;
+};
+struct bminor_profile {
+    long count;
+    struct bminor_profile_site sites[];
+};
+
+void bminor_print_integer( long x );
+void bminor_print_char( long c );
+/* "true" or "false" */
+void bminor_print_boolean( long b );
+/* up to the first nul byte */
+void bminor_print_string( const char *s );
+void bminor_flush();
+/* reports an array index out of bounds in 'function', and exits with status 1 */
+void bminor_bounds_error( long index, long length, const char *function );
+
+#endif
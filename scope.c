@@ -1,15 +1,26 @@
 #include "scope.h"
+#include "diag.h"
 #include <stdio.h>
 #include <stdlib.h>
 
+// exited scopes, tables already cleared: reused by scope_create so a long-running process (e.g. -server) stops allocating bucket arrays once warm
+static struct scope *free_scopes = NULL;
+
 struct scope *scope_create(struct scope *next){
-    struct scope *sc = malloc(sizeof(*sc));
-    if( !sc ){
-        puts("[ERROR] Failed to allocate memory for struct scope. Exiting...");
-        exit(EXIT_FAILURE);
+    struct scope *sc = free_scopes;
+    if( sc ){
+        free_scopes = sc->next;
+    }
+    else {
+        sc = malloc(sizeof(*sc));
+        if( !sc ) diag_fatal("Failed to allocate memory for struct scope");
+        // allocated memory that needs to be freed later
+        sc->table = hash_table_create(0,0);
+        if( !sc->table ){
+            free(sc);
+            diag_fatal("Failed to allocate hash table for struct scope");
+        }
     }
-    // allocated memory that needs to be freed later
-    sc->table = hash_table_create(0,0);
     sc->next = next;
     sc->locals = 0;
     sc->params = 0;
@@ -17,9 +28,10 @@ struct scope *scope_create(struct scope *next){
 }
 
 void scope_delete(struct scope *sc){
-    // hash table is only member needing to be freed
-    hash_table_delete(sc->table);
-    free(sc);
+    // keep the table's buckets for the next scope_create: only the entries are freed
+    hash_table_clear(sc->table);
+    sc->next = free_scopes;
+    free_scopes = sc;
 }
 
 struct symbol *scope_bind(struct scope *sc, const char *name, struct symbol *sym){
@@ -51,7 +63,7 @@ struct symbol *scope_bind(struct scope *sc, const char *name, struct symbol *sym
             sym->which = sc->params++;
             break;
         default:
-            puts("Uh-oh. Here come a flock o' Wah-Wahs");
+            diag_report(DIAG_INTERNAL, 0, "Uh-oh. Here come a flock o' Wah-Wahs");
             break;
     }
     return sym;
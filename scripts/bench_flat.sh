@@ -0,0 +1,39 @@
+#! /usr/bin/env bash
+
+# Compares resolving through expression trees with resolving through flattened expressions (-flat) on a generated
+# expression-heavy corpus: the memory each takes (from -stats), and the time to typecheck the corpus either way, best of
+# the repetitions.
+# usage: scripts/bench_flat.sh [corpus lines] [repetitions]
+
+PARENT="$( cd "$( dirname "${BASH_SOURCE[0]}" )" >/dev/null 2>&1 && pwd )"
+cd "${PARENT}/.."
+
+lines=${1:-100000}
+reps=${2:-5}
+corpus=$(mktemp)
+trap 'rm -f "${corpus}"' EXIT
+
+# the corpus of scripts/bench_parser.sh
+awk -v n="${lines}" 'BEGIN {
+    for (i = 0; i < n; i++) {
+        if (i % 10 == 0) printf("f%d: function integer (a: integer, b: array [] integer) = {\n", i);
+        printf("    x%d: integer = a * %d + b[%d] - (a %% 7) ^ 2;\n", i, i, i % 5);
+        printf("    if (x%d < %d && !(a == b[0]) || x%d >= 3) x%d = -x%d; else print x%d, \"\\n\";\n", i, i, i, i, i, i);
+        if (i % 10 == 9) printf("    return a;\n}\n");
+    }
+    if (n % 10) printf("    return a;\n}\n");
+}' > "${corpus}"
+
+make -s bminor > /dev/null || exit 1
+./bminor -resolve -flat -stats "${corpus}" | tail -n 1
+
+for flags in "" "-flat"; do
+    best=0
+    for ((i = 0; i < reps; i++)); do
+        start=$(date +%s%N)
+        ./bminor -typecheck ${flags} "${corpus}" > /dev/null || exit 1
+        ms=$(( ($(date +%s%N) - start) / 1000000 ))
+        (( best == 0 || ms < best )) && best=${ms}
+    done
+    printf '%-6s -typecheck: %6d ms\n' "${flags:-trees}" "${best}"
+done
@@ -0,0 +1,51 @@
+#! /usr/bin/env bash
+
+# Compares parser throughput between the bison parser and the hand-written one (-parser pratt) on a generated expression-heavy
+# corpus. Parsing is timed through -server parse requests so process startup is not measured; the time of scan requests over
+# the same corpus is subtracted to leave the parsers' own share.
+# usage: scripts/bench_parser.sh [corpus lines] [repetitions]
+
+PARENT="$( cd "$( dirname "${BASH_SOURCE[0]}" )" >/dev/null 2>&1 && pwd )"
+cd "${PARENT}/.."
+
+lines=${1:-100000}
+reps=${2:-10}
+corpus=$(mktemp)
+trap 'rm -f "${corpus}" "${corpus}".*' EXIT
+
+# declarations with initializers and function bodies full of short expressions, where each atom used to cost a chain of unit reductions
+awk -v n="${lines}" 'BEGIN {
+    for (i = 0; i < n; i++) {
+        if (i % 10 == 0) printf("f%d: function integer (a: integer, b: array [] integer) = {\n", i);
+        printf("    x%d: integer = a * %d + b[%d] - (a %% 7) ^ 2;\n", i, i, i % 5);
+        printf("    if (x%d < %d && !(a == b[0]) || x%d >= 3) x%d = -x%d; else print x%d, \"\\n\";\n", i, i, i, i, i, i);
+        if (i % 10 == 9) printf("    return a;\n}\n");
+    }
+    if (n % 10) printf("    return a;\n}\n");
+}' > "${corpus}"
+
+size=$(wc -c < "${corpus}")
+for stage in scan parse; do
+    for ((i = 0; i < reps; i++)); do
+        printf '%s 0 %d\n' "${stage}" "${size}"
+        cat "${corpus}"
+    done > "${corpus}.${stage}"
+done
+
+make -s bminor > /dev/null || exit 1
+./bminor -parse -parser compare "${corpus}" > /dev/null || { echo "the parsers disagree on the corpus"; exit 1; }
+
+time_requests(){
+    local start=$(date +%s%N)
+    ./bminor "$@" -server < "${corpus}.${stage}" > /dev/null
+    echo $(( $(date +%s%N) - start ))
+}
+
+stage=scan
+scan_ns=$(time_requests)
+stage=parse
+for engine in bison pratt; do
+    ns=$(time_requests -parser ${engine})
+    awk -v e="${engine}" -v b="${size}" -v r="${reps}" -v ns="${ns}" -v sns="${scan_ns}" \
+        'BEGIN { printf("%-6s scan+parse: %8.1f MB/s   parse alone: %8.1f ms per pass\n", e, b * r / (ns / 1e9) / 1e6, (ns - sns) / r / 1e6) }'
+done
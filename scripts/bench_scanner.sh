@@ -0,0 +1,42 @@
+#! /usr/bin/env bash
+
+# Compares scanner throughput (tokens/sec) and scanner table size between the default (compressed tables) build and FAST_SCANNER=1 (-CF)
+# on a generated identifier-heavy corpus. Scanning is timed through -server scan requests so process startup is not measured.
+# usage: scripts/bench_scanner.sh [corpus lines] [repetitions]
+
+PARENT="$( cd "$( dirname "${BASH_SOURCE[0]}" )" >/dev/null 2>&1 && pwd )"
+cd "${PARENT}/.."
+
+lines=${1:-200000}
+reps=${2:-10}
+corpus=$(mktemp)
+requests=$(mktemp)
+trap 'rm -f "${corpus}" "${requests}"' EXIT
+
+# identifiers of varied length, including near-misses of keywords, plus enough keywords to exercise the hash hits
+awk -v n="${lines}" 'BEGIN {
+    split("array boolean char else false for function if integer print return string true void while", kw, " ");
+    for (i = 0; i < n; i++)
+        printf("ident_%d: integer = %s%d + x%d * forx%d; %s iff_%d whilst %s;\n", i, "count", i % 97, i % 13, i, kw[i % 15 + 1], i, kw[(i * 7) % 15 + 1]);
+}' > "${corpus}"
+
+size=$(wc -c < "${corpus}")
+for ((i = 0; i < reps; i++)); do
+    printf 'scan 0 %d\n' "${size}"
+    cat "${corpus}"
+done > "${requests}"
+
+for config in default fast; do
+    make -s clean
+    if [ "${config}" = fast ]; then make -s FAST_SCANNER=1 bminor > /dev/null; else make -s bminor > /dev/null; fi || exit 1
+
+    tokens=$(( $(./bminor -scan "${corpus}" | wc -l) - 1 ))
+    tables=$(size -A bminor_scan.o | awk '$1 == ".rodata" { print $2 }')
+    start=$(date +%s%N)
+    ./bminor -server < "${requests}" > /dev/null
+    end=$(date +%s%N)
+    awk -v c="${config}" -v t="${tokens}" -v r="${reps}" -v ns="$((end - start))" -v tb="${tables}" \
+        'BEGIN { printf("%-8s tokens/sec: %12.0f   scanner .rodata: %8d bytes\n", c, t * r / (ns / 1e9), tb) }'
+done
+
+make -s clean
@@ -0,0 +1,70 @@
+#! /usr/bin/env bash
+
+# Compares running programs with the bytecode interpreter (-run) and with the JIT (-run -jit) against compiling them (-codegen,
+# assembled and linked with the runtime) and running the executable, on a loop-heavy program (a sieve, counted many times) and a call-heavy one (naive
+# recursive fibonacci). Each time covers everything from source to exit: compiling is part of what -run saves.
+# usage: scripts/bench_vm.sh [sieve size] [fibonacci argument]
+
+PARENT="$( cd "$( dirname "${BASH_SOURCE[0]}" )" >/dev/null 2>&1 && pwd )"
+cd "${PARENT}/.."
+
+size=${1:-100000}
+fib=${2:-30}
+dir=$(mktemp -d)
+trap 'rm -rf "${dir}"' EXIT
+
+cat > "${dir}/loops.bminor" <<BMINOR
+composite: array [${size}] boolean;
+
+main: function integer () = {
+    round: integer;
+    i: integer;
+    j: integer;
+    primes: integer;
+    for( round = 0; round < 50; round++ ){
+        for( i = 0; i < ${size}; i++ ) composite[i] = false;
+        primes = 0;
+        for( i = 2; i < ${size}; i++ ){
+            if( !composite[i] ){
+                primes++;
+                for( j = i * i; j < ${size}; j = j + i ) composite[j] = true;
+            }
+        }
+    }
+    print primes, "\n";
+    return 0;
+}
+BMINOR
+
+cat > "${dir}/calls.bminor" <<BMINOR
+fib: function integer (n: integer) = {
+    if( n < 2 ) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+main: function integer () = {
+    print fib(${fib}), "\n";
+    return 0;
+}
+BMINOR
+
+make -s bminor runtime.o > /dev/null || exit 1
+
+elapsed_ms(){
+    local start=$(date +%s%N)
+    "$@" > "${dir}/out" || { echo "failed: $*"; exit 1; }
+    echo $(( ($(date +%s%N) - start) / 1000000 ))
+}
+compile_and_run(){
+    ./bminor -codegen "$1" "${dir}/prog.s" > /dev/null && gcc -o "${dir}/prog" "${dir}/prog.s" runtime.o && "${dir}/prog"
+}
+
+for prog in loops calls; do
+    run_ms=$(elapsed_ms ./bminor -run "${dir}/${prog}.bminor")
+    run_out=$(cat "${dir}/out")
+    jit_ms=$(elapsed_ms ./bminor -run -jit "${dir}/${prog}.bminor")
+    [ "${run_out}" = "$(cat "${dir}/out")" ] || { echo "${prog}: -run and -run -jit disagree"; exit 1; }
+    native_ms=$(elapsed_ms compile_and_run "${dir}/${prog}.bminor")
+    [ "${run_out}" = "$(cat "${dir}/out")" ] || { echo "${prog}: -run and the compiled program disagree"; exit 1; }
+    printf '%-6s -run: %6d ms   -run -jit: %6d ms   -codegen, gcc and run: %6d ms\n' "${prog}" "${run_ms}" "${jit_ms}" "${native_ms}"
+done
@@ -0,0 +1,123 @@
+/* Generates keyword_hash.c: a minimal perfect hash over the keywords in the given file (one per line), so the scanner can match every
+   keyword with the single {IDENT} rule and classify the match with one table probe.
+
+   Hash and displace: each keyword lands in bucket h(k, 0) % N, and every bucket gets the smallest seed d for which h(k, d) % N sends all
+   of its keywords to free slots. Lookup is then slot = h(s, disp[h(s, 0) % N]) % N followed by one compare.
+
+   usage: gen_keyword_hash <keywords file> > keyword_hash.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#define MAX_KEYWORDS    256
+#define MAX_KEYWORD_LEN 64
+#define MAX_SEED        65535
+
+/* must match keyword_hash in the generated code */
+unsigned hash(const char *s, int len, unsigned seed){
+    unsigned h = 2166136261u ^ (seed * 0x9e3779b9u);
+    for(int i = 0; i < len; i++) h = (h ^ (unsigned char) s[i]) * 16777619u;
+    return h;
+}
+
+int main(int argc, char **argv){
+    if( argc != 2 ){
+        fprintf(stderr, "usage: %s <keywords file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    FILE *in = fopen(argv[1], "r");
+    if( !in ){
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    static char words[MAX_KEYWORDS][MAX_KEYWORD_LEN + 1];
+    int n = 0;
+    while( n < MAX_KEYWORDS && fscanf(in, "%64s", words[n]) == 1 ) n++;
+    fclose(in);
+    if( n == 0 ){
+        fprintf(stderr, "%s: no keywords\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    // bucket contents, largest buckets placed first since they are the hardest to fit
+    static int bucket_of[MAX_KEYWORDS], bucket_size[MAX_KEYWORDS], order[MAX_KEYWORDS];
+    for(int i = 0; i < n; i++){
+        bucket_of[i] = hash(words[i], strlen(words[i]), 0) % n;
+        bucket_size[bucket_of[i]]++;
+        order[i] = i;
+    }
+    for(int i = 1; i < n; i++)
+        for(int j = i; j > 0 && bucket_size[order[j]] > bucket_size[order[j-1]]; j--){
+            int tmp = order[j]; order[j] = order[j-1]; order[j-1] = tmp;
+        }
+
+    static int  disp[MAX_KEYWORDS], slot_word[MAX_KEYWORDS];
+    static bool taken[MAX_KEYWORDS];
+    for(int b = 0; b < n; b++) slot_word[b] = -1;
+
+    for(int o = 0; o < n && bucket_size[order[o]]; o++){
+        int b = order[o];
+        unsigned seed;
+        for(seed = 1; seed <= MAX_SEED; seed++){
+            int placed[MAX_KEYWORDS], count = 0;
+            bool fits = true;
+            for(int i = 0; i < n && fits; i++){
+                if( bucket_of[i] != b ) continue;
+                int slot = hash(words[i], strlen(words[i]), seed) % n;
+                if( taken[slot] ) fits = false;
+                else { taken[slot] = true; placed[count++] = slot; slot_word[slot] = i; }
+            }
+            if( fits ) break;
+            // undo this attempt
+            for(int i = 0; i < count; i++){ taken[placed[i]] = false; slot_word[placed[i]] = -1; }
+        }
+        if( seed > MAX_SEED ){
+            fprintf(stderr, "%s: could not find a perfect hash (duplicate keyword?)\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        disp[b] = seed;
+    }
+
+    int min_len = MAX_KEYWORD_LEN, max_len = 0;
+    for(int i = 0; i < n; i++){
+        int len = strlen(words[i]);
+        if( len < min_len ) min_len = len;
+        if( len > max_len ) max_len = len;
+    }
+
+    printf("/* Generated from %s by scripts/gen_keyword_hash.c: do not edit */\n\n", argv[1]);
+    printf("#include \"keyword_hash.h\"\n#include \"token.h\"\n#include <string.h>\n\n");
+    printf("#define KEYWORD_COUNT   %d\n#define KEYWORD_MIN_LEN %d\n#define KEYWORD_MAX_LEN %d\n\n", n, min_len, max_len);
+
+    printf("static const unsigned short disp[KEYWORD_COUNT] = {");
+    for(int b = 0; b < n; b++) printf("%s%d", b ? ", " : "", disp[b]);
+    printf("};\n\n");
+
+    printf("static const struct { const char *word; int len; int token; } keywords[KEYWORD_COUNT] = {\n");
+    for(int s = 0; s < n; s++){
+        char upper[MAX_KEYWORD_LEN + 1];
+        const char *w = words[slot_word[s]];
+        int len = strlen(w);
+        for(int i = 0; i <= len; i++) upper[i] = toupper((unsigned char) w[i]);
+        printf("    { \"%s\", %d, %s },\n", w, len, upper);
+    }
+    printf("};\n\n");
+
+    printf("static inline unsigned keyword_hash(const char *s, int len, unsigned seed){\n"
+           "    unsigned h = 2166136261u ^ (seed * 0x9e3779b9u);\n"
+           "    for(int i = 0; i < len; i++) h = (h ^ (unsigned char) s[i]) * 16777619u;\n"
+           "    return h;\n"
+           "}\n\n");
+
+    printf("int keyword_lookup(const char *s, int len){\n"
+           "    // only identifiers outside the keywords' range of lengths are rejected without hashing\n"
+           "    if( len < KEYWORD_MIN_LEN || len > KEYWORD_MAX_LEN ) return IDENT;\n"
+           "    unsigned slot = keyword_hash(s, len, disp[keyword_hash(s, len, 0) %% KEYWORD_COUNT]) %% KEYWORD_COUNT;\n"
+           "    return keywords[slot].len == len && !memcmp(keywords[slot].word, s, len) ? keywords[slot].token : IDENT;\n"
+           "}\n");
+    return EXIT_SUCCESS;
+}
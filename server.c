@@ -0,0 +1,212 @@
+#include "server.h"
+#include "libbminor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define READ_BUF_SIZE   (64 * 1024)
+#define MAX_HEADER_LEN  128
+
+typedef enum {
+    REQ_DONE,
+    REQ_EOF,
+    REQ_QUIT,
+    REQ_BAD
+} req_t;
+
+/* buffered reader over a file descriptor: the header is read out of the buffer, large sources mostly straight into the source buffer */
+struct conn {
+    int    fd;
+    size_t pos;
+    size_t len;
+    char   buf[READ_BUF_SIZE];
+};
+
+/* state kept warm across requests */
+static struct bminor_ctx *ctx     = NULL;
+static char              *src     = NULL;
+static size_t             src_cap = 0;
+static struct conn        conn;
+
+/* internal helpers */
+bool   server_init();
+req_t  server_handle(struct conn *c, FILE *out);
+bool   stage_from_str(const char *s, bminor_stage_t *stage);
+ssize_t conn_fill(struct conn *c);
+bool   conn_read_line(struct conn *c, char *line, size_t cap, bool *overlong);
+bool   conn_read_bytes(struct conn *c, char *dst, size_t n);
+
+int server_run_stdio(){
+    if( !server_init() ) return EXIT_FAILURE;
+
+    conn.fd  = STDIN_FILENO;
+    conn.pos = conn.len = 0;
+    req_t r;
+    while( (r = server_handle(&conn, stdout)) == REQ_DONE );
+    return r == REQ_BAD ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int server_run_socket(const char *path){
+    if( !server_init() ) return EXIT_FAILURE;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if( strlen(path) >= sizeof(addr.sun_path) ){
+        fprintf(stderr, "[ERROR|server] Socket path %s is too long\n", path);
+        return EXIT_FAILURE;
+    }
+    strcpy(addr.sun_path, path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    // a stale socket file from a previous server would make bind fail
+    unlink(path);
+    if( listen_fd < 0
+        || bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0
+        || listen(listen_fd, 16) < 0 ){
+        fprintf(stderr, "[ERROR|server] Could not listen on %s! %s\n", path, strerror(errno));
+        if( listen_fd >= 0 ) close(listen_fd);
+        return EXIT_FAILURE;
+    }
+
+    req_t r = REQ_DONE;
+    while( r != REQ_QUIT ){
+        int fd = accept(listen_fd, NULL, NULL);
+        if( fd < 0 ){
+            if( errno == EINTR ) continue;
+            fprintf(stderr, "[ERROR|server] accept failed! %s\n", strerror(errno));
+            break;
+        }
+        // a separate descriptor for writing so closing the FILE and the socket are independent
+        FILE *out = fdopen(dup(fd), "w");
+        if( !out ){
+            close(fd);
+            continue;
+        }
+        conn.fd  = fd;
+        conn.pos = conn.len = 0;
+        while( (r = server_handle(&conn, out)) == REQ_DONE );
+        fclose(out);
+        close(fd);
+    }
+
+    close(listen_fd);
+    unlink(path);
+    return r == REQ_QUIT ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+bool server_init(){
+    // a client hanging up mid-response must not take the server down with it
+    signal(SIGPIPE, SIG_IGN);
+
+    if( !ctx ) ctx = bminor_ctx_create();
+    if( !ctx ){
+        fputs("[ERROR|server] Could not create compile context\n", stderr);
+        return false;
+    }
+    return true;
+}
+
+req_t server_handle(struct conn *c, FILE *out){
+    char line[MAX_HEADER_LEN];
+    bool overlong = false;
+    if( !conn_read_line(c, line, sizeof(line), &overlong) ){
+        if( !overlong ) return REQ_EOF;
+        fputs("2 0 0\n", out);
+        fflush(out);
+        return REQ_BAD;
+    }
+    if( !strcmp(line, "quit") ) return REQ_QUIT;
+
+    char stage_str[16];
+    int  verbose;
+    size_t len;
+    bminor_stage_t stage;
+    if( sscanf(line, "%15s %d %zu", stage_str, &verbose, &len) != 3 || !stage_from_str(stage_str, &stage) ){
+        fputs("2 0 0\n", out);
+        fflush(out);
+        return REQ_BAD;
+    }
+
+    // source buffer only ever grows: steady-state requests do not allocate for it
+    if( len + 1 > src_cap ){
+        char *bigger = realloc(src, len + 1);
+        if( !bigger ){
+            fputs("2 0 0\n", out);
+            fflush(out);
+            return REQ_BAD;
+        }
+        src = bigger;
+        src_cap = len + 1;
+    }
+    if( !conn_read_bytes(c, src, len) ) return REQ_EOF;
+
+    int status = bminor_compile(ctx, src, len, stage, verbose) ? 1 : 0;
+
+    size_t out_len;
+    const char *output = bminor_output(ctx, &out_len);
+    struct diag *diags = bminor_diags(ctx);
+    fprintf(out, "%d %zu %d\n", status, out_len, diag_count(diags));
+    fwrite(output, 1, out_len, out);
+    for( struct diag *d = diags; d; d = d->next )
+        fprintf(out, "%s %d %zu\n%s\n", diag_kind_str(d->kind), d->line, strlen(d->msg), d->msg);
+    fflush(out);
+    return REQ_DONE;
+}
+
+bool stage_from_str(const char *s, bminor_stage_t *stage){
+    if     ( !strcmp(s, "scan") )       *stage = BMINOR_SCAN;
+    else if( !strcmp(s, "parse") )      *stage = BMINOR_PARSE;
+    else if( !strcmp(s, "print") )      *stage = BMINOR_PRINT;
+    else if( !strcmp(s, "resolve") )    *stage = BMINOR_RESOLVE;
+    else if( !strcmp(s, "typecheck") )  *stage = BMINOR_TYPECHECK;
+    else if( !strcmp(s, "codegen") )    *stage = BMINOR_CODEGEN;
+    else                                return false;
+    return true;
+}
+
+ssize_t conn_fill(struct conn *c){
+    ssize_t n;
+    do n = read(c->fd, c->buf, sizeof(c->buf));
+    while( n < 0 && errno == EINTR );
+    c->pos = 0;
+    c->len = n > 0 ? n : 0;
+    return n;
+}
+
+bool conn_read_line(struct conn *c, char *line, size_t cap, bool *overlong){
+    size_t i = 0;
+    for(;;){
+        if( c->pos == c->len && conn_fill(c) <= 0 ) return false;
+        char ch = c->buf[c->pos++];
+        if( ch == '\n' ) break;
+        if( i + 1 == cap ){
+            *overlong = true;
+            return false;
+        }
+        line[i++] = ch;
+    }
+    line[i] = '\0';
+    return true;
+}
+
+bool conn_read_bytes(struct conn *c, char *dst, size_t n){
+    // drain what is already buffered, then read the rest directly into 'dst'
+    size_t buffered = c->len - c->pos < n ? c->len - c->pos : n;
+    memcpy(dst, c->buf + c->pos, buffered);
+    c->pos += buffered;
+
+    for( size_t got = buffered; got < n; ){
+        ssize_t r = read(c->fd, dst + got, n - got);
+        if( r < 0 && errno == EINTR ) continue;
+        if( r <= 0 ) return false;
+        got += r;
+    }
+    return true;
+}
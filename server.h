@@ -0,0 +1,20 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/* Persistent compile server: keeps one libbminor context (and with it the warm AST arena and scope pool) alive across requests.
+
+   Protocol, identical on stdin/stdout and on each socket connection:
+     request:   "<stage> <verbose> <length>\n" followed by <length> bytes of source
+                  - <stage> is one of scan, parse, print, resolve, typecheck, codegen; <verbose> is 0 or 1
+                "quit\n" stops the server
+     response:  "<status> <output length> <diagnostic count>\n", the output bytes, then per diagnostic
+                "<kind> <line> <message length>\n<message>\n"
+                  - <status> is 0 on success, 1 when the compile failed, 2 for a malformed request (the connection is then dropped)
+*/
+
+/* serve requests from stdin, answering on stdout, until EOF or quit: returns an exit code */
+int server_run_stdio();
+/* listen on a Unix domain socket at 'path', serving connections one at a time until a quit request: returns an exit code */
+int server_run_socket( const char *path );
+
+#endif
@@ -1,16 +1,24 @@
 #include "stmt.h"
 #include "scope.h"
+#include "diag.h"
+#include "output.h"
+#include "arena.h"
+#include "type.h"
+#include "codegen.h"
+#include "licm.h"
+#include "bounds.h"
+#include "profile.h"
+#include "runtime.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-extern void indent(int indents);
+/* internal helpers */
+void stmt_codegen_one(struct stmt *s);
+void stmt_codegen_print(struct expr *e);
 
 struct stmt * stmt_create( stmt_t kind, struct decl *decl, struct expr *expr_list, struct stmt *body){
-    struct stmt *s = malloc(sizeof(*s));
-    if (!s){
-        puts("Failed to allocate space for stmt, exiting...");
-        exit(EXIT_FAILURE);
-    }
+    struct stmt *s = arena_alloc(sizeof(*s));
 
     s->kind = kind;
     s->decl = decl;
@@ -35,48 +43,48 @@ void stmt_print(struct stmt *s, int indents, bool indent_first){
             break;
         case STMT_EXPR:
             expr_print(s->expr_list);
-            fputs(";", stdout);
+            fputs(";", out_stream);
             break;
         case STMT_IF_ELSE:
-            fputs("if( ", stdout);
+            fputs("if( ", out_stream);
             expr_print(s->expr_list);
-            fputs(" )", stdout);
+            fputs(" )", out_stream);
             bool body_is_not_block = !(s->body->kind == STMT_BLOCK);
-            fputs(body_is_not_block ? "\n" : " " , stdout);
+            fputs(body_is_not_block ? "\n" : " " , out_stream);
             stmt_print(s->body, indents + body_is_not_block, body_is_not_block);
             if (s->body->next) {
-                fputs("\n", stdout);
+                fputs("\n", out_stream);
                 indent(indents);
-                fputs("else", stdout);
+                fputs("else", out_stream);
                 bool body_is_not_block_or_if = !(s->body->next->kind == STMT_BLOCK || s->body->next->kind == STMT_IF_ELSE);
-                fputs(body_is_not_block_or_if ? "\n" : " " , stdout);
+                fputs(body_is_not_block_or_if ? "\n" : " " , out_stream);
                 stmt_print(s->body->next, indents + body_is_not_block_or_if, body_is_not_block_or_if);
             }
             break;
         case STMT_FOR:
-            fputs("for( ", stdout);
+            fputs("for( ", out_stream);
             expr_print_list(s->expr_list, " ; ");
-            fputs(" )", stdout);
+            fputs(" )", out_stream);
             body_is_not_block = !(s->body->kind == STMT_BLOCK);
-            fputs(body_is_not_block ? "\n" : " " , stdout);
+            fputs(body_is_not_block ? "\n" : " " , out_stream);
             stmt_print(s->body, indents + body_is_not_block, body_is_not_block);
             break;
         case STMT_PRINT:
-            fputs("print ", stdout);
+            fputs("print ", out_stream);
             expr_print_list(s->expr_list, ", ");
-            fputs(";", stdout);
+            fputs(";", out_stream);
             break;
         case STMT_RETURN:
-            fputs("return ", stdout);
+            fputs("return ", out_stream);
             expr_print(s->expr_list);
-            fputs(";", stdout);
+            fputs(";", out_stream);
             break;
         case STMT_BLOCK:
-            fputs("{\n", stdout);
+            fputs("{\n", out_stream);
             stmt_print_list(s->body, indents + 1, "\n");
-            fputs("\n", stdout);
+            fputs("\n", out_stream);
             indent(indents);
-            fputs("}", stdout);
+            fputs("}", out_stream);
             break;
         default:
             break;
@@ -87,7 +95,7 @@ void stmt_print_list(struct stmt *s, int indents, char *delim){
     if (!s) return;
 
     stmt_print(s, indents, true);
-    if (s->next) fputs(delim, stdout);
+    if (s->next) fputs(delim, out_stream);
     stmt_print_list(s->next, indents, delim);
 }
 
@@ -118,3 +126,166 @@ int stmt_resolve(struct stmt *s, struct scope *sc, bool verbose){
     err_count += stmt_resolve(s->next, sc, verbose);
     return err_count;
 }
+
+int stmt_typecheck(struct stmt *s, struct type *ret_type){
+    if( !s ) return 0;
+
+    int err_count = 0;
+    struct expr *e = s->expr_list;
+    switch(s->kind){
+        case STMT_DECL:
+            err_count += decl_typecheck(s->decl);
+            break;
+        case STMT_EXPR:
+            err_count += expr_typecheck(e);
+            break;
+        case STMT_IF_ELSE:
+        case STMT_FOR:
+            // for: only the condition (the middle expression) has a required type
+            for( ; e; e = e->next ){
+                err_count += expr_typecheck(e);
+                bool is_cond = s->kind == STMT_IF_ELSE || e == s->expr_list->next;
+                if( is_cond && e->type && e->type->kind != TYPE_BOOLEAN ){
+                    diag_report(DIAG_TYPECHECK, 0, "Condition %s is %s, not boolean", expr_to_str(e), type_to_str(e->type));
+                    err_count++;
+                }
+            }
+            break;
+        case STMT_PRINT:
+            for( ; e; e = e->next ){
+                err_count += expr_typecheck(e);
+                if( e->type && !type_is_atomic(e->type) ){
+                    diag_report(DIAG_TYPECHECK, 0, "Cannot print %s, of type %s", expr_to_str(e), type_to_str(e->type));
+                    err_count++;
+                }
+            }
+            break;
+        case STMT_RETURN:
+            err_count += expr_typecheck(e);
+            if( !e && ret_type->kind != TYPE_VOID ){
+                diag_report(DIAG_TYPECHECK, 0, "Missing return value in a function returning %s", type_to_str(ret_type));
+                err_count++;
+            }
+            else if( e && e->type && !type_equals(e->type, ret_type) ){
+                diag_report(DIAG_TYPECHECK, 0, "Returning %s, of type %s, from a function returning %s", expr_to_str(e), type_to_str(e->type), type_to_str(ret_type));
+                err_count++;
+            }
+            break;
+        default:
+            break;
+    }
+    err_count += stmt_typecheck(s->body, ret_type);
+    err_count += stmt_typecheck(s->next, ret_type);
+    return err_count;
+}
+
+void stmt_codegen(struct stmt *s){
+    for( ; s; s = s->next ) stmt_codegen_one(s);
+}
+
+void stmt_codegen_one(struct stmt *s){
+    if( !s ) return;
+
+    struct expr *e = s->expr_list;
+    const char *top, *done, *other;
+    switch(s->kind){
+        case STMT_DECL:
+            decl_codegen(s->decl);
+            break;
+        case STMT_EXPR:
+            expr_codegen(e);
+            scratch_free(e->reg);
+            break;
+        case STMT_IF_ELSE:
+            other = label_create();
+            done  = label_create();
+            expr_codegen(e);
+            emit(OP_TESTQ, opnd_reg(e->reg), opnd_reg(e->reg));
+            scratch_free(e->reg);
+            emit1(OP_JE, opnd_label(other));
+            // the else branch hangs off the then branch: generate them one at a time
+            stmt_codegen_one(s->body);
+            emit1(OP_JMP, opnd_label(done));
+            emit_label(other);
+            stmt_codegen_one(s->body->next);
+            emit_label(done);
+            break;
+        case STMT_FOR: {
+            top  = label_create();
+            done = label_create();
+            expr_codegen(e);
+            scratch_free(e->reg);
+            const char *site = profile_loop_enter(s);
+            struct licm_loop loop = licm_loop_plan(s);
+            bool known;
+            if( !loop.count ){
+                emit_label(top);
+                expr_codegen(e->next);
+                emit(OP_TESTQ, opnd_reg(e->next->reg), opnd_reg(e->next->reg));
+                scratch_free(e->next->reg);
+                emit1(OP_JE, opnd_label(done));
+                profile_loop_iteration(site);
+                known = bounds_loop_begin(s);
+                stmt_codegen(s->body);
+                bounds_loop_end(known);
+                expr_codegen(e->next->next);
+                scratch_free(e->next->next->reg);
+                emit1(OP_JMP, opnd_label(top));
+                emit_label(done);
+                licm_loop_end(&loop);
+                break;
+            }
+            // tested once before the invariant expressions are computed, so they are only computed if the loop runs
+            expr_codegen(e->next);
+            emit(OP_TESTQ, opnd_reg(e->next->reg), opnd_reg(e->next->reg));
+            scratch_free(e->next->reg);
+            emit1(OP_JE, opnd_label(done));
+            licm_loop_hoist(&loop);
+            emit_label(top);
+            profile_loop_iteration(site);
+            known = bounds_loop_begin(s);
+            stmt_codegen(s->body);
+            bounds_loop_end(known);
+            expr_codegen(e->next->next);
+            scratch_free(e->next->next->reg);
+            expr_codegen(e->next);
+            emit(OP_TESTQ, opnd_reg(e->next->reg), opnd_reg(e->next->reg));
+            scratch_free(e->next->reg);
+            emit1(OP_JNE, opnd_label(top));
+            emit_label(done);
+            licm_loop_end(&loop);
+            break;
+        }
+        case STMT_PRINT:
+            for( ; e; e = e->next ) stmt_codegen_print(e);
+            break;
+        case STMT_RETURN:
+            if( e ){
+                expr_codegen(e);
+                emit(OP_MOVQ, opnd_reg(e->reg), opnd_reg(REG_RAX));
+                scratch_free(e->reg);
+            }
+            emit1(OP_JMP, opnd_label(codegen_return_label()));
+            break;
+        case STMT_BLOCK:
+            stmt_codegen(s->body);
+            break;
+        default:
+            break;
+    }
+}
+
+void stmt_codegen_print(struct expr *e){
+    /* a call per value, to the runtime's routine for its type */
+    expr_codegen(e);
+    const char *routine;
+    switch(e->type->kind){
+        case TYPE_INTEGER:  routine = RUNTIME_PRINT_INTEGER;   break;
+        case TYPE_CHAR:     routine = RUNTIME_PRINT_CHAR;      break;
+        case TYPE_BOOLEAN:  routine = RUNTIME_PRINT_BOOLEAN;   break;
+        default:            routine = RUNTIME_PRINT_STRING;    break;
+    }
+    emit(OP_MOVQ, opnd_reg(e->reg), opnd_reg(REG_RDI));
+    scratch_free(e->reg);
+    codegen_call(routine);
+}
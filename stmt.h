@@ -34,7 +34,11 @@ void stmt_print( struct stmt *s, int indents, bool indent_first );
 void stmt_print_list( struct stmt *s, int indents, char *delim );
 
 struct scope;
+struct type;
 int  stmt_resolve( struct stmt *s, struct scope *sc, bool verbose);
+/* 'ret_type' is the return type of the function 's' is in: returns the number of type errors */
+int  stmt_typecheck( struct stmt *s, struct type *ret_type );
+void stmt_codegen( struct stmt *s );
 
 
 #endif
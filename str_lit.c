@@ -0,0 +1,52 @@
+#include "str_lit.h"
+#include "arena.h"
+#include <string.h>
+
+char unescape_char(char c){
+    switch(c){
+        case 'n':   return '\n';
+        case '0':   return '\0';
+        default:    return c;
+    }
+}
+
+char char_lit_value(const char *text){
+    // text[0] is the opening quote
+    return text[1] == '\\' ? unescape_char(text[2]) : text[1];
+}
+
+struct str_lit str_lit_scan(const char *text, int text_len){
+    struct str_lit lit;
+    lit.src     = text + 1;
+    lit.src_len = text_len - 2;
+    lit.bytes   = NULL;
+    str_lit_measure(&lit);
+    return lit;
+}
+
+bool str_lit_measure(struct str_lit *lit){
+    // every backslash starts a two character escape standing for one byte
+    int escapes = 0;
+    const char *end = lit->src + lit->src_len;
+    const char *p;
+    for( p = memchr(lit->src, '\\', lit->src_len); p; p = memchr(p, '\\', end - p) ){
+        escapes++;
+        p += 2;
+        if( p >= end ) break;
+    }
+    lit->has_escapes = escapes > 0;
+    lit->len = lit->src_len - escapes;
+    return !p || p == end;
+}
+
+const char *str_lit_bytes(struct str_lit *lit){
+    if( !lit->has_escapes ) return lit->src;
+    if( lit->bytes )        return lit->bytes;
+
+    char *writer = arena_alloc(lit->len + 1);
+    lit->bytes = writer;
+    for( const char *reader = lit->src; reader < lit->src + lit->src_len; reader++ )
+        *writer++ = *reader == '\\' ? unescape_char(*++reader) : *reader;
+    *writer = '\0';
+    return lit->bytes;
+}
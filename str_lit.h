@@ -0,0 +1,30 @@
+#ifndef STR_LIT_H
+#define STR_LIT_H
+
+#include <stdbool.h>
+
+/* A string literal as a span of the source buffer (between, not including, its quotes).
+   The scanner only measures it: the unescaped bytes are produced the first time a consumer asks for them, and only if escapes are present. */
+struct str_lit {
+    const char *src;
+    int         src_len;
+    // length once unescaped: may contain nul bytes (from \0), so consumers must not rely on nul termination
+    int         len;
+    bool        has_escapes;
+    // unescaped copy (arena-allocated), NULL until str_lit_bytes needs to build one
+    const char *bytes;
+};
+
+/* measure the literal whose token text (quotes included) is the 'text_len' bytes at 'text': no allocation */
+struct str_lit str_lit_scan( const char *text, int text_len );
+/* sets 'lit->len' and 'lit->has_escapes' from its span: false if the span ends in half an escape, which no scanned literal does */
+bool           str_lit_measure( struct str_lit *lit );
+/* the literal's 'lit->len' unescaped bytes: points into the source when there were no escapes */
+const char    *str_lit_bytes( struct str_lit *lit );
+
+/* value of the character after a backslash: \n is a linefeed, \0 a nul, anything else stands for itself */
+char unescape_char( char c );
+/* value of a char literal token such as 'a' or '\n' */
+char char_lit_value( const char *text );
+
+#endif
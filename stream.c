@@ -0,0 +1,198 @@
+#include "stream.h"
+#include "token.h"
+#include "diag.h"
+#include "arena.h"
+#include "str_lit.h"
+#include <stdlib.h>
+#include <string.h>
+
+extern int   yylex();
+extern int   yylineno;
+// the impure push parser takes the token pushed to it from here, as yyparse does
+extern int   yychar;
+extern struct str_lit last_string_literal;
+extern void  scanner_set_source_piece(char *src, size_t len, bool first, bool last);
+
+/* where the bytes tracked so far leave the scanner: enough to tell whether the token under way can go on past whitespace,
+   and whether a comment under way can be cut (the scanner picks it up again in the next piece) */
+typedef enum {
+    STREAM_CODE,            // between tokens, or in one that whitespace ends
+    STREAM_SLASH,           // after a '/' that may open a comment
+    STREAM_COMMENT,         // inside /* */
+    STREAM_COMMENT_STAR,    // inside /* */, after a '*'
+    STREAM_LINE_COMMENT,    // inside // (the end of the line ends it)
+    STREAM_STRING,          // inside a string literal
+    STREAM_STRING_ESC,      // inside a string literal, after a backslash
+    STREAM_CHAR,            // after the quote opening a char literal
+    STREAM_CHAR_ESC,        // after the quote and a backslash
+    STREAM_CHAR_END         // where the quote closing a char literal would be
+} stream_lex_t;
+
+struct stream {
+    stream_decl_fn on_decl;
+    void          *arg;
+    yypstate      *ps;
+    // bytes fed but not scanned yet, with room after them for the two nul bytes the scanner needs
+    char          *buf;
+    size_t         len, cap;
+    // how far 'lex' has been tracked through 'buf', and the end of the longest prefix that scans the same on its own
+    size_t         tracked, safe;
+    stream_lex_t   lex;
+    // whether the scanner has been given a piece of the source yet
+    bool           started;
+    // YYPUSH_MORE until the parse is over, then what yypush_parse returned
+    int            status;
+};
+
+// the stream being parsed, which the grammar hands top-level declarations to
+static struct stream *open_stream = NULL;
+
+/* internal helpers */
+void stream_track(struct stream *s);
+void stream_scan(struct stream *s, size_t n, bool last);
+
+struct stream *stream_create(stream_decl_fn on_decl, void *arg){
+    if( open_stream ) diag_fatal("Only one stream can be parsed at a time");
+
+    struct stream *s = malloc(sizeof(*s));
+    if( !s ) diag_fatal("Could not allocate a stream");
+    s->on_decl = on_decl;
+    s->arg     = arg;
+    s->ps      = yypstate_new();
+    s->cap     = 4096;
+    s->buf     = malloc(s->cap);
+    if( !s->ps || !s->buf ) diag_fatal("Could not allocate a stream");
+    s->len     = s->tracked = s->safe = 0;
+    s->lex     = STREAM_CODE;
+    s->started = false;
+    s->status  = YYPUSH_MORE;
+
+    open_stream = s;
+    return s;
+}
+
+void stream_delete(struct stream *s){
+    if( !s ) return;
+    yypstate_delete(s->ps);
+    free(s->buf);
+    free(s);
+    open_stream = NULL;
+}
+
+int stream_feed(struct stream *s, const char *chunk, size_t len){
+    if( s->status != YYPUSH_MORE ) return 1;
+
+    if( s->len + len + 2 > s->cap ){
+        size_t cap = s->cap * 2 > s->len + len + 2 ? s->cap * 2 : s->len + len + 2;
+        char *bigger = realloc(s->buf, cap);
+        if( !bigger ) diag_fatal("Could not allocate %zu bytes for the stream", cap);
+        s->buf = bigger;
+        s->cap = cap;
+    }
+    memcpy(s->buf + s->len, chunk, len);
+    s->len += len;
+
+    stream_track(s);
+    if( s->safe ) stream_scan(s, s->safe, false);
+    return s->status != YYPUSH_MORE;
+}
+
+int stream_finish(struct stream *s){
+    if( s->status == YYPUSH_MORE ) stream_scan(s, s->len, true);
+    return s->status != 0;
+}
+
+bool stream_decl_reduced(struct decl *d){
+    if( !open_stream ) return false;
+    open_stream->on_decl(d, open_stream->arg);
+    return true;
+}
+
+void stream_track(struct stream *s){
+    /* Follows the bytes fed since the last call, moving 'safe' past each whitespace byte that falls between tokens: flex
+       matches the longest token it can, and whitespace only continues comments and literals, so scanning stopped there makes
+       the same tokens as scanning the whole source would. Comments are skipped a piece at a time, so 'safe' also moves past
+       each of their bytes but a '*' (which a '/' at the start of the next piece could have closed the comment with): a long
+       comment is not held in the buffer. */
+    for( ; s->tracked < s->len; s->tracked++ ){
+        char c = s->buf[s->tracked];
+        switch( s->lex ){
+            case STREAM_SLASH:
+                if( c == '*' || c == '/' ){
+                    s->lex  = c == '*' ? STREAM_COMMENT : STREAM_LINE_COMMENT;
+                    s->safe = s->tracked + 1;
+                    continue;
+                }
+                break;
+            case STREAM_COMMENT:
+            case STREAM_COMMENT_STAR:
+                if( c == '/' && s->lex == STREAM_COMMENT_STAR ){ s->lex = STREAM_CODE; continue; }
+                s->lex = c == '*' ? STREAM_COMMENT_STAR : STREAM_COMMENT;
+                if( c != '*' ) s->safe = s->tracked + 1;
+                continue;
+            case STREAM_LINE_COMMENT:
+                if( c == '\n' ) break;
+                s->safe = s->tracked + 1;
+                continue;
+            case STREAM_STRING:
+                if( c == '\\' )      s->lex = STREAM_STRING_ESC;
+                else if( c == '"' )  s->lex = STREAM_CODE;
+                // a raw newline leaves the literal unterminated: the scanner rejects its opening quote
+                else if( c == '\n' ) break;
+                continue;
+            case STREAM_STRING_ESC:
+                s->lex = STREAM_STRING;
+                continue;
+            case STREAM_CHAR:
+                if( c == '\\' ){ s->lex = STREAM_CHAR_ESC; continue; }
+                if( c != '\'' && c != '\n' ){ s->lex = STREAM_CHAR_END; continue; }
+                break;
+            case STREAM_CHAR_ESC:
+                if( c != '\n' ){ s->lex = STREAM_CHAR_END; continue; }
+                break;
+            case STREAM_CHAR_END:
+                if( c == '\'' ){ s->lex = STREAM_CODE; continue; }
+                break;
+            case STREAM_CODE:
+                break;
+        }
+
+        // not part of a comment or literal: what it starts, if anything
+        s->lex = STREAM_CODE;
+        switch( c ){
+            case '/':  s->lex = STREAM_SLASH;  break;
+            case '"':  s->lex = STREAM_STRING; break;
+            case '\'': s->lex = STREAM_CHAR;   break;
+            case ' ': case '\t': case '\r': case '\n':
+                s->safe = s->tracked + 1;
+                break;
+        }
+    }
+}
+
+void stream_scan(struct stream *s, size_t n, bool last){
+    /* Pushes the tokens of the first 'n' bytes of the buffer to the parser, and TOKEN_EOF after them if they are the 'last' of
+       the source, then drops those bytes */
+    // the scanner wants two nul bytes after what it scans: borrow the ones there until it is done
+    char held[2] = { s->buf[n], s->buf[n + 1] };
+    s->buf[n] = s->buf[n + 1] = '\0';
+    scanner_set_source_piece(s->buf, n, !s->started, last);
+    s->started = true;
+
+    int t;
+    do {
+        t = yylex();
+        if( t == TOKEN_EOF && !last ) break;
+        // the literal's span is about to be overwritten by the rest of the source
+        if( t == STR_LIT ) last_string_literal.src = arena_strndup(last_string_literal.src, last_string_literal.src_len);
+        yychar    = t;
+        s->status = yypush_parse(s->ps);
+    } while( s->status == YYPUSH_MORE && t != TOKEN_EOF );
+
+    s->buf[n]     = held[0];
+    s->buf[n + 1] = held[1];
+    memmove(s->buf, s->buf + n, s->len - n);
+    s->len     -= n;
+    s->tracked -= n;
+    s->safe     = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "decl.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Push parsing: source handed over in chunks as it arrives (from a pipe or a socket, say) instead of as a complete file, each
+   top-level declaration handed back as soon as it reduces. Only what has not been scanned yet is buffered: a chunk is scanned
+   up to the last point no token can straddle (whitespace outside comments and literals), the rest waits for the next chunk.
+   String literals are copied out of the buffer, so nothing in the AST points into it.
+   Streams use the bison parser (yypush_parse) and the scanner's global state: only one may be open at a time. */
+
+struct stream;
+
+/* gets each top-level declaration, in source order; 'arg' is what the stream was created with */
+typedef void (*stream_decl_fn)( struct decl *d, void *arg );
+
+struct stream *stream_create( stream_decl_fn on_decl, void *arg );
+void           stream_delete( struct stream *s );
+
+/* parses as far as the 'len' bytes at 'chunk' allow: returns 0 while the source may still be valid, 1 once a syntax error has
+   been reported (what is fed after that is ignored) */
+int stream_feed( struct stream *s, const char *chunk, size_t len );
+/* end of the source: parses what was held back, returns 0 if the whole program parsed */
+int stream_finish( struct stream *s );
+
+/* called by the grammar for each top-level declaration: true if a stream took it, false if it belongs in 'ast' */
+bool stream_decl_reduced( struct decl *d );
+
+#endif
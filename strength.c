@@ -0,0 +1,151 @@
+#include "strength.h"
+
+// longest multiply chain worth unrolling x ^ c into, rather than running the loop
+#define MAX_EXP_MULS 8
+
+typedef enum {
+    MUL_NONE,       // power of two: the shift alone
+    MUL_LEA,        // 3, 5 or 9: leaq (r,r,c-1)
+    MUL_LEA_LEA,    // product of two of 3, 5, 9
+    MUL_SHIFT_ADD,  // 2^k + 1
+    MUL_SHIFT_SUB   // 2^k - 1
+} mul_plan_t;
+
+/* internal helpers */
+bool is_pow2(unsigned long m);
+int  log2_floor(unsigned long m);
+bool is_lea_factor(unsigned long m);
+void emit_pow2_bias(reg_t r, reg_t bias, int k);
+
+bool strength_reduce_mul(reg_t r, long c){
+    if( c == 0 ){
+        emit(OP_XORQ, opnd_reg(r), opnd_reg(r));
+        return true;
+    }
+    unsigned long m = c < 0 ? -(unsigned long) c : (unsigned long) c;
+    int shift = __builtin_ctzl(m);
+    unsigned long odd = m >> shift;
+
+    /* plan before emitting anything: odd part first, then the shift for the power of two factored out of it */
+    mul_plan_t plan;
+    unsigned long first = 0;
+    if( odd == 1 )                  plan = MUL_NONE;
+    else if( is_lea_factor(odd) )   plan = MUL_LEA;
+    else if( is_pow2(odd - 1) )     plan = MUL_SHIFT_ADD;
+    else if( is_pow2(odd + 1) )     plan = MUL_SHIFT_SUB;
+    else {
+        plan = MUL_NONE;
+        for( first = 3; first <= 9; first += first - 1 )
+            if( odd % first == 0 && is_lea_factor(odd / first) ){
+                plan = MUL_LEA_LEA;
+                break;
+            }
+        if( plan != MUL_LEA_LEA ) return false;
+    }
+
+    reg_t t;
+    switch(plan){
+        case MUL_LEA:
+            emit(OP_LEAQ, opnd_mem_index(r, r, odd - 1, 0), opnd_reg(r));
+            break;
+        case MUL_LEA_LEA:
+            emit(OP_LEAQ, opnd_mem_index(r, r, first - 1, 0), opnd_reg(r));
+            emit(OP_LEAQ, opnd_mem_index(r, r, odd / first - 1, 0), opnd_reg(r));
+            break;
+        case MUL_SHIFT_ADD:
+        case MUL_SHIFT_SUB:
+            t = scratch_alloc();
+            emit(OP_MOVQ, opnd_reg(r), opnd_reg(t));
+            emit(OP_SALQ, opnd_imm(log2_floor(plan == MUL_SHIFT_ADD ? odd - 1 : odd + 1)), opnd_reg(r));
+            emit(plan == MUL_SHIFT_ADD ? OP_ADDQ : OP_SUBQ, opnd_reg(t), opnd_reg(r));
+            scratch_free(t);
+            break;
+        default:
+            break;
+    }
+    if( shift ) emit(OP_SALQ, opnd_imm(shift), opnd_reg(r));
+    if( c < 0 ) emit1(OP_NEGQ, opnd_reg(r));
+    return true;
+}
+
+bool strength_reduce_div(reg_t r, long c){
+    if( c == 1 )  return true;
+    if( c == -1 ){
+        emit1(OP_NEGQ, opnd_reg(r));
+        return true;
+    }
+    unsigned long m = c < 0 ? -(unsigned long) c : (unsigned long) c;
+    if( !is_pow2(m) ) return false;
+
+    // an arithmetic shift rounds toward negative infinity: biasing negative dividends by 2^k - 1 makes it round toward zero
+    int k = log2_floor(m);
+    reg_t bias = scratch_alloc();
+    emit_pow2_bias(r, bias, k);
+    emit(OP_ADDQ, opnd_reg(bias), opnd_reg(r));
+    emit(OP_SARQ, opnd_imm(k), opnd_reg(r));
+    scratch_free(bias);
+    if( c < 0 ) emit1(OP_NEGQ, opnd_reg(r));
+    return true;
+}
+
+bool strength_reduce_mod(reg_t r, long c){
+    // the divisor's sign never affects the remainder
+    unsigned long m = c < 0 ? -(unsigned long) c : (unsigned long) c;
+    if( m == 1 ){
+        emit(OP_XORQ, opnd_reg(r), opnd_reg(r));
+        return true;
+    }
+    if( !is_pow2(m) ) return false;
+
+    // ((x + bias) & (2^k - 1)) - bias: the low bits of the biased dividend are those of the truncated remainder plus the bias
+    int k = log2_floor(m);
+    reg_t bias = scratch_alloc();
+    emit_pow2_bias(r, bias, k);
+    emit(OP_ADDQ, opnd_reg(bias), opnd_reg(r));
+    emit(OP_ANDQ, opnd_imm(m - 1), opnd_reg(r));
+    emit(OP_SUBQ, opnd_reg(bias), opnd_reg(r));
+    scratch_free(bias);
+    return true;
+}
+
+bool strength_reduce_exp(reg_t r, long c){
+    if( c <= 0 ){
+        emit(OP_MOVQ, opnd_imm(1), opnd_reg(r));
+        return true;
+    }
+    int squarings = log2_floor(c);
+    int multiplies = __builtin_popcountl(c) - 1;
+    if( squarings + multiplies > MAX_EXP_MULS ) return false;
+
+    // left to right over the bits of c: square for every bit after the leading one, multiply by the base for each set bit
+    reg_t base = REG_NONE;
+    if( multiplies ){
+        base = scratch_alloc();
+        emit(OP_MOVQ, opnd_reg(r), opnd_reg(base));
+    }
+    for( int bit = squarings - 1; bit >= 0; bit-- ){
+        emit(OP_IMULQ, opnd_reg(r), opnd_reg(r));
+        if( c >> bit & 1 ) emit(OP_IMULQ, opnd_reg(base), opnd_reg(r));
+    }
+    scratch_free(base);
+    return true;
+}
+
+void emit_pow2_bias(reg_t r, reg_t bias, int k){
+    /* bias = x < 0 ? 2^k - 1 : 0, from the sign bits of x */
+    emit(OP_MOVQ, opnd_reg(r), opnd_reg(bias));
+    if( k > 1 ) emit(OP_SARQ, opnd_imm(63), opnd_reg(bias));
+    emit(OP_SHRQ, opnd_imm(64 - k), opnd_reg(bias));
+}
+
+bool is_pow2(unsigned long m){
+    return m && !(m & (m - 1));
+}
+
+int log2_floor(unsigned long m){
+    return 63 - __builtin_clzl(m);
+}
+
+bool is_lea_factor(unsigned long m){
+    return m == 3 || m == 5 || m == 9;
+}
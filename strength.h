@@ -0,0 +1,21 @@
+#ifndef STRENGTH_H
+#define STRENGTH_H
+
+#include "codegen.h"
+#include <stdbool.h>
+
+/* Strength reduction for ^, *, / and % with a constant operand, applied during instruction selection (expr_codegen).
+   Each rewrites register 'r', holding the other operand's value, into the result in place. They return false without emitting
+   anything when 'c' has no sequence cheaper than the general one (imulq, idivq, the exponentiation loop).
+   Semantics match the general sequences exactly: signed, wrapping, division truncating toward zero, % taking the dividend's sign. */
+
+/* shifts, lea and shift/add or shift/sub combinations */
+bool strength_reduce_mul( reg_t r, long c );
+/* by ±2^k: arithmetic shift after biasing negative dividends by 2^k - 1 */
+bool strength_reduce_div( reg_t r, long c );
+/* by ±2^k: mask, with the same bias */
+bool strength_reduce_mod( reg_t r, long c );
+/* square-and-multiply chain: x ^ c for c <= 0 is 1, as for the general loop */
+bool strength_reduce_exp( reg_t r, long c );
+
+#endif
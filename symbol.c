@@ -1,19 +1,23 @@
 #include "symbol.h"
+#include "diag.h"
+#include "output.h"
+#include "arena.h"
+#include "codegen.h"
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
 
 struct symbol *symbol_create( symbol_t kind, struct type *type, char *name, bool func_defined){
-    struct symbol *s = malloc(sizeof(*s));
-    if( !s ){
-        puts("Could not allocate memory for symbol. Exiting...\n");
-        exit(EXIT_FAILURE);
-    }
+    struct symbol *s = arena_alloc(sizeof(*s));
 
     s->kind  = kind;
     s->type  = type;
     s->name  = name;
     s->func_defined = func_defined;
+    s->definition   = NULL;
+    s->inline_info  = NULL;
+    s->pure         = false;
+    s->profile_site = 0;
 
     return s;
 }
@@ -22,21 +26,25 @@ void symbol_print(struct symbol *sym){
     if( !sym ) return;
     switch(sym->kind){
         case SYMBOL_GLOBAL:
-            printf("global %s", sym->name);
+            fprintf(out_stream, "global %s", sym->name);
             break;
         case SYMBOL_LOCAL:
-            printf("local %d", sym->which);
+            fprintf(out_stream, "local %d", sym->which);
             break;
         case SYMBOL_PARAM:
-            printf("param %d", sym->which);
+            fprintf(out_stream, "param %d", sym->which);
             break;
         default:
-            puts(":/\n");
+            fputs(":/\n", out_stream);
             break;
     }
 }
 
 void symbol_delete(struct symbol *sym){
-    // don't free/delete anything but the symbol struct itself. the name and type pointed to should remain bc they're still used in AST
-    free(sym);
+    // symbols live in the AST arena alongside the name and type they point to: the memory comes back when the arena is reset
+    (void) sym;
+}
+
+struct operand symbol_codegen(struct symbol *sym){
+    return sym->kind == SYMBOL_GLOBAL ? opnd_sym(sym->name) : opnd_mem(REG_RBP, sym->frame_offset);
 }
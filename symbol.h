@@ -4,6 +4,9 @@
 #include "type.h"
 #include <stdbool.h>
 
+struct decl;
+struct inline_info;
+
 typedef enum {
 	SYMBOL_LOCAL,
 	SYMBOL_PARAM,
@@ -16,6 +19,18 @@ struct symbol {
 	char *name;
 	int which;
     bool func_defined;
+    // %rbp-relative address of a local or parameter, assigned by the frame layout during codegen
+    int frame_offset;
+    // under -run, the frame slot of a local or parameter, the first quadword of a global, or the index of a function (see vm.h)
+    int vm_slot;
+    // the function's definition, set by the resolver
+    struct decl *definition;
+    // set by inline_plan for a function whose body may replace calls to it (see inline.h)
+    struct inline_info *inline_info;
+    // set by licm_plan for a defined function whose calls may be hoisted out of loops (see licm.h)
+    bool pure;
+    // under -profile, the index of a defined function's counters in the profile table (see profile.h)
+    int profile_site;
 };
 
 struct symbol * symbol_create( symbol_t kind, struct type *type, char *name, bool func_defined );
@@ -24,4 +39,8 @@ void symbol_print(struct symbol *sym);
 
 void symbol_delete(struct symbol *sym);
 
+/* operand addressing the symbol's storage: rip-relative for globals, in the frame otherwise */
+struct operand;
+struct operand symbol_codegen(struct symbol *sym);
+
 #endif
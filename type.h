@@ -3,6 +3,7 @@
 
 #include "decl.h"
 #include "expr.h"
+#include <stdbool.h>
 
 typedef enum {
 	TYPE_VOID,
@@ -24,4 +25,14 @@ struct type {
 struct type * type_create( type_t kind, struct type *subtype, struct expr *arr_sz, struct decl *params );
 void          type_print( struct type *t );
 
+/* structural equality: arrays of unknown size (parameters) match arrays of any length */
+bool          type_equals( struct type *a, struct type *b );
+bool          type_is_atomic( struct type *t );
+/* number of elements of an array type whose size is a constant, -1 otherwise */
+int           type_array_length( struct type *t );
+/* bytes a value of type 't' occupies in memory: arrays are stored in place, everything else is a quadword */
+int           type_size( struct type *t );
+/* printed form of 't' for diagnostics (arena allocated) */
+char        * type_to_str( struct type *t );
+
 #endif
@@ -1,13 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "type.h"
+#include "diag.h"
+#include "output.h"
+#include "arena.h"
 
 struct type *type_create(type_t kind, struct type *subtype, struct expr *arr_sz, struct decl *params){
-    struct type *t = malloc(sizeof(*t));
-    if( !t ) {
-        puts("Failed to allocate space for type, exiting...");
-        exit(EXIT_FAILURE);
-    }
+    struct type *t = arena_alloc(sizeof(*t));
 
     t->kind     = kind;
     t->subtype  = subtype;
@@ -23,22 +22,64 @@ void type_print(struct type *t){
     //char *kind_to_str[] = {"void", "boolean", "char", "integer", "string", "array", "function"};
     //printf("%s", kind_to_str[t->kind - TYPE_VOID]);
     char *type_t_to_str[] = <type_t_to_str_arr_placeholder>;
-    printf("%s", type_t_to_str[t->kind - <first_type_placeholder>]);
+    fputs(type_t_to_str[t->kind - <first_type_placeholder>], out_stream);
     switch(t->kind){
         case TYPE_ARRAY:
-            fputs(" [", stdout);
+            fputs(" [", out_stream);
             expr_print(t->arr_sz);
-            fputs("] ", stdout);
+            fputs("] ", out_stream);
             type_print(t->subtype);
             break;
         case TYPE_FUNCTION:
-            fputs(" ", stdout);
+            fputs(" ", out_stream);
             type_print(t->subtype);
-            fputs(" (", stdout);
+            fputs(" (", out_stream);
             decl_print_list(t->params, 0, "", ", ");
-            fputs(")", stdout);
+            fputs(")", out_stream);
             break;
         default:
             break;
     }
 }
+
+bool type_equals(struct type *a, struct type *b){
+    if( a == b ) return true;
+    if( !a || !b || a->kind != b->kind ) return false;
+
+    switch(a->kind){
+        case TYPE_ARRAY:
+            // an array of unknown size (a parameter) accepts any length
+            if( a->arr_sz && b->arr_sz && type_array_length(a) != type_array_length(b) ) return false;
+            return type_equals(a->subtype, b->subtype);
+        case TYPE_FUNCTION:
+            if( !type_equals(a->subtype, b->subtype) ) return false;
+            struct decl *pa = a->params, *pb = b->params;
+            for( ; pa && pb; pa = pa->next, pb = pb->next )
+                if( !type_equals(pa->type, pb->type) ) return false;
+            return !pa && !pb;
+        default:
+            return true;
+    }
+}
+
+bool type_is_atomic(struct type *t){
+    return t && (t->kind == TYPE_BOOLEAN || t->kind == TYPE_CHAR || t->kind == TYPE_INTEGER || t->kind == TYPE_STRING);
+}
+
+int type_array_length(struct type *t){
+    long n;
+    return t->arr_sz && expr_const_int(t->arr_sz, &n) ? n : -1;
+}
+
+int type_size(struct type *t){
+    // every value (integer, char, boolean, string pointer, array pointer) is a quadword: only arrays stored in place are bigger
+    if( t->kind != TYPE_ARRAY ) return 8;
+    int len = type_array_length(t);
+    return len < 0 ? 8 : len * type_size(t->subtype);
+}
+
+char *type_to_str(struct type *t){
+    output_capture_begin();
+    type_print(t);
+    return output_capture_end();
+}
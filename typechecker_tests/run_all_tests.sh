@@ -0,0 +1,13 @@
+#! /usr/bin/env bash
+
+echo "[My tests]"
+cd my_tests
+./run_all_tests.sh
+echo "-----------------"
+cd ..
+
+#echo "[Thain's tests]"
+#cd thain_tests
+#./run_all_tests.sh
+#echo "-----------------"
+#cd ..
@@ -0,0 +1,185 @@
+#include "vm.h"
+#include "diag.h"
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* where a call returns to */
+struct vm_call {
+    const struct vm_insn *ret;
+    int64_t              *fp;
+    // the caller's slot for the returned value
+    int32_t               dest;
+};
+
+/* a C function, called with every argument register loaded: the ones it does not take are ignored */
+typedef int64_t (*vm_native_fn)( int64_t, int64_t, int64_t, int64_t, int64_t, int64_t );
+
+int vm_run(struct vm_program *p, int *status){
+    static const void *const handlers[VM_OPCODE_COUNT] = {
+#define VM_HANDLER(name) [name] = &&do_##name,
+        VM_OPCODE_TABLE(VM_HANDLER)
+#undef VM_HANDLER
+    };
+    if( !p->threaded ){
+        for( int i = 0; i < p->code_len; i++ ) p->code[i].handler = handlers[p->code[i].op];
+        p->threaded = true;
+    }
+
+    // globals start out with their initial values on every run
+    int64_t *globals = malloc((p->global_count + 1) * sizeof(*globals));
+    // a C function is passed six slots whatever it takes: the last frame may end right below the spare ones
+    int64_t *stack   = malloc((VM_STACK_SLOTS + 6) * sizeof(*stack));
+    struct vm_call *calls = malloc(VM_MAX_CALLS * sizeof(*calls));
+    if( !globals || !stack || !calls ) diag_fatal("Could not allocate the interpreter's stack");
+    memcpy(globals, p->globals, p->global_count * sizeof(*globals));
+
+    const struct vm_insn *code = p->code, *pc;
+    const struct vm_function *callee = &p->functions[p->main];
+    const int64_t *constants = p->constants;
+    int64_t *fp = stack, *stack_end = stack + VM_STACK_SLOTS;
+    struct vm_call *sp = calls, *calls_end = calls + VM_MAX_CALLS;
+    int64_t result = 0;
+    int err_count = 0;
+
+#define DISPATCH()  goto *pc->handler
+#define NEXT()      do { pc++; DISPATCH(); } while( 0 )
+#define A           fp[pc->a]
+#define B           fp[pc->b]
+#define C           fp[pc->c]
+/* arithmetic wraps around as the hardware's does */
+#define WRAP(op)    (int64_t) ((uint64_t) B op (uint64_t) C)
+#define JUMP_IF(cond)   do { pc = (cond) ? code + pc->a : pc + 1; DISPATCH(); } while( 0 )
+
+    if( fp + callee->frame_size > stack_end ) goto overflow;
+    pc = code + callee->entry;
+    DISPATCH();
+
+do_VM_MOVE:         A = B;                                      NEXT();
+do_VM_LOADI:        A = pc->b;                                  NEXT();
+do_VM_CONST:        A = constants[pc->b];                       NEXT();
+do_VM_GLOBAL:       A = globals[pc->b];                         NEXT();
+do_VM_SET_GLOBAL:   globals[pc->a] = B;                         NEXT();
+do_VM_GLOBAL_ADDR:  A = (intptr_t) (globals + pc->b);           NEXT();
+do_VM_LOCAL_ADDR:   A = (intptr_t) (fp + pc->b);                NEXT();
+do_VM_LOAD:         A = *(int64_t *) B;                         NEXT();
+do_VM_STORE:        *(int64_t *) A = B;                         NEXT();
+do_VM_LOAD_ELEM:    A = ((int64_t *) B)[C];                     NEXT();
+do_VM_STORE_ELEM:   ((int64_t *) A)[B] = C;                     NEXT();
+do_VM_ELEM_ADDR:    A = (intptr_t) ((int64_t *) B + C);         NEXT();
+do_VM_ZERO:         memset(&A, 0, pc->b * sizeof(int64_t));     NEXT();
+do_VM_ADD:          A = WRAP(+);                                NEXT();
+do_VM_ADDI:         A = (int64_t) ((uint64_t) B + pc->c);       NEXT();
+do_VM_SUB:          A = WRAP(-);                                NEXT();
+do_VM_MUL:          A = WRAP(*);                                NEXT();
+do_VM_MULI:         A = (int64_t) ((uint64_t) B * pc->c);       NEXT();
+do_VM_DIV:
+    // the quotient of the most negative integer by -1 does not fit: the hardware traps on it, as on division by zero
+    if( !C || (C == -1 && B == INT64_MIN) ) goto divide_error;
+    A = B / C;
+    NEXT();
+do_VM_MOD:
+    if( !C || (C == -1 && B == INT64_MIN) ) goto divide_error;
+    A = B % C;
+    NEXT();
+do_VM_EXP:          A = vm_power(B, C);                         NEXT();
+do_VM_NEG:          A = (int64_t) -(uint64_t) B;                NEXT();
+do_VM_NOT:          A = !B;                                     NEXT();
+do_VM_LT:           A = B < C;                                  NEXT();
+do_VM_LE:           A = B <= C;                                 NEXT();
+do_VM_GT:           A = B > C;                                  NEXT();
+do_VM_GE:           A = B >= C;                                 NEXT();
+do_VM_EQ:           A = B == C;                                 NEXT();
+do_VM_NE:           A = B != C;                                 NEXT();
+do_VM_STR_EQ:       A = !strcmp((const char *) B, (const char *) C);    NEXT();
+do_VM_STR_NE:       A = !!strcmp((const char *) B, (const char *) C);   NEXT();
+do_VM_JUMP:         pc = code + pc->a;                          DISPATCH();
+do_VM_JUMP_IF:      JUMP_IF(B);
+do_VM_JUMP_UNLESS:  JUMP_IF(!B);
+do_VM_JUMP_LT:      JUMP_IF(B < C);
+do_VM_JUMP_LE:      JUMP_IF(B <= C);
+do_VM_JUMP_GT:      JUMP_IF(B > C);
+do_VM_JUMP_GE:      JUMP_IF(B >= C);
+do_VM_JUMP_EQ:      JUMP_IF(B == C);
+do_VM_JUMP_NE:      JUMP_IF(B != C);
+do_VM_JUMP_LTI:     JUMP_IF(B < pc->c);
+do_VM_JUMP_LEI:     JUMP_IF(B <= pc->c);
+do_VM_JUMP_GTI:     JUMP_IF(B > pc->c);
+do_VM_JUMP_GEI:     JUMP_IF(B >= pc->c);
+do_VM_JUMP_EQI:     JUMP_IF(B == pc->c);
+do_VM_JUMP_NEI:     JUMP_IF(B != pc->c);
+do_VM_CALL:
+    // the arguments are already where the callee's frame starts
+    callee = &p->functions[pc->b];
+    if( sp == calls_end || fp + pc->c + callee->frame_size > stack_end ) goto overflow;
+    *sp++ = (struct vm_call) { pc + 1, fp, pc->a };
+    fp += pc->c;
+    pc  = code + callee->entry;
+    DISPATCH();
+do_VM_CALL_NATIVE:
+    // it may write to stdout itself: what the program printed goes first
+    fflush(out_stream);
+    A = ((vm_native_fn) p->natives[pc->b].fn)(C, (&C)[1], (&C)[2], (&C)[3], (&C)[4], (&C)[5]);
+    NEXT();
+do_VM_RETURN:
+    result = A;
+    if( sp == calls ) goto done;
+    sp--;
+    fp = sp->fp;
+    fp[sp->dest] = result;
+    pc = sp->ret;
+    DISPATCH();
+do_VM_PRINT_INT:    fprintf(out_stream, "%ld", (long) A);       NEXT();
+do_VM_PRINT_CHAR:   putc((char) A, out_stream);                 NEXT();
+do_VM_PRINT_BOOL:   fputs(A ? "true" : "false", out_stream);    NEXT();
+do_VM_PRINT_STR:    fputs((const char *) A, out_stream);        NEXT();
+
+#undef DISPATCH
+#undef NEXT
+#undef A
+#undef B
+#undef C
+#undef WRAP
+#undef JUMP_IF
+
+divide_error:
+    fflush(out_stream);
+    diag_report(DIAG_RUNTIME, 0, "%s %s in %s", pc->op == VM_DIV ? "Division" : "Remainder",
+                fp[pc->c] ? "overflows" : "by zero", vm_function_at(p, pc - code));
+    err_count++;
+    goto done;
+overflow:
+    fflush(out_stream);
+    diag_report(DIAG_RUNTIME, 0, "Stack overflow: %s called with %ld calls in progress", callee->name, (long) (sp - calls));
+    err_count++;
+done:
+    fflush(out_stream);
+    free(globals);
+    free(stack);
+    free(calls);
+    *status = (int) result;
+    return err_count;
+}
+
+const char *vm_function_at(struct vm_program *p, int insn){
+    /* name of the function instruction 'insn' belongs to: functions are laid out one after the other */
+    const char *name = "";
+    for( int i = 0, entry = -1; i < p->function_count; i++ ){
+        if( p->functions[i].entry <= insn && p->functions[i].entry > entry ){
+            entry = p->functions[i].entry;
+            name  = p->functions[i].name;
+        }
+    }
+    return name;
+}
+
+int64_t vm_power(int64_t base, int64_t exponent){
+    /* square-and-multiply, as compiled code does: non-positive exponents give 1 */
+    uint64_t result = 1, b = base;
+    for( ; exponent > 0; exponent >>= 1 ){
+        if( exponent & 1 ) result *= b;
+        b *= b;
+    }
+    return (int64_t) result;
+}
@@ -0,0 +1,145 @@
+#ifndef VM_H
+#define VM_H
+
+#include "decl.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Bytecode interpreter (-run): runs a resolved and typechecked program in process, without an assembler or linker.
+   vm_compile translates the function bodies into register-based bytecode. Each function has a frame of 64-bit slots: its
+   parameters, then its locals (arrays stored in place, nested blocks sharing slots as in codegen's frame layout), then the
+   temporaries of its expressions. Instructions name the slots they read and write, so that 'a = b + c' is one instruction and
+   a variable is read where it lives rather than copied to a stack first. A call evaluates its arguments into consecutive
+   slots at the top of the caller's frame, and the callee's frame starts there: they are already its parameters.
+   vm_run dispatches with computed goto, threading the code first so that every instruction holds the address of its handler
+   and every handler ends by jumping to the next one's: there is no loop, switch or bounds check between instructions.
+   Values are laid out as -codegen lays them out (a quadword each, array values are addresses), so the programs behave the
+   same, calls to C functions included; -run additionally stops with a runtime error on division by zero, where compiled
+   programs trap. */
+
+/* slots all frames together may take (8 bytes each), and calls that may be nested: only the pages used are touched */
+#define VM_STACK_SLOTS  (1 << 23)
+#define VM_MAX_CALLS    (1 << 20)
+
+/* Opcode table: each row expands into a vm_opcode_t enumerator and its handler in vm_run.
+ * 'a' is the slot written, 'b' and 'c' the slots read, unless noted; targets are instruction indices.
+ *      name                operands */
+#define VM_OPCODE_TABLE(X) \
+    X(VM_MOVE)          /* a = b                                                        */ \
+    X(VM_LOADI)         /* a = the constant b                                           */ \
+    X(VM_CONST)         /* a = constants[b] (the address of a string literal's bytes)   */ \
+    X(VM_GLOBAL)        /* a = global quadword b                                        */ \
+    X(VM_SET_GLOBAL)    /* global quadword a = b                                        */ \
+    X(VM_GLOBAL_ADDR)   /* a = the address of global quadword b                         */ \
+    X(VM_LOCAL_ADDR)    /* a = the address of slot b                                    */ \
+    X(VM_LOAD)          /* a = the quadword at address b                                */ \
+    X(VM_STORE)         /* the quadword at address a = b                                */ \
+    X(VM_LOAD_ELEM)     /* a = quadword c of the array at address b                     */ \
+    X(VM_STORE_ELEM)    /* quadword b of the array at address a = c                     */ \
+    X(VM_ELEM_ADDR)     /* a = the address of quadword c of the array at address b      */ \
+    X(VM_ZERO)          /* slots a to a + b - 1 = 0                                     */ \
+    X(VM_ADD)           \
+    X(VM_ADDI)          /* a = b + the constant c                                       */ \
+    X(VM_SUB)           \
+    X(VM_MUL)           \
+    X(VM_MULI)          /* a = b * the constant c                                       */ \
+    X(VM_DIV)           \
+    X(VM_MOD)           \
+    X(VM_EXP)           \
+    X(VM_NEG)           /* a = -b                                                       */ \
+    X(VM_NOT)           /* a = !b                                                       */ \
+    X(VM_LT)            \
+    X(VM_LE)            \
+    X(VM_GT)            \
+    X(VM_GE)            \
+    X(VM_EQ)            \
+    X(VM_NE)            \
+    X(VM_STR_EQ)        /* a = the strings at b and c have the same bytes               */ \
+    X(VM_STR_NE)        \
+    X(VM_JUMP)          /* to a                                                         */ \
+    X(VM_JUMP_IF)       /* to a if b                                                    */ \
+    X(VM_JUMP_UNLESS)   /* to a unless b                                                */ \
+    X(VM_JUMP_LT)       /* to a if b < c: the comparisons a branch tests, fused         */ \
+    X(VM_JUMP_LE)       \
+    X(VM_JUMP_GT)       \
+    X(VM_JUMP_GE)       \
+    X(VM_JUMP_EQ)       \
+    X(VM_JUMP_NE)       \
+    X(VM_JUMP_LTI)      /* to a if b < the constant c                                   */ \
+    X(VM_JUMP_LEI)      \
+    X(VM_JUMP_GTI)      \
+    X(VM_JUMP_GEI)      \
+    X(VM_JUMP_EQI)      \
+    X(VM_JUMP_NEI)      \
+    X(VM_CALL)          /* a = function b, its arguments in slots c and up              */ \
+    X(VM_CALL_NATIVE)   /* a = C function natives[b], its arguments in slots c and up   */ \
+    X(VM_RETURN)        /* returns a                                                    */ \
+    X(VM_PRINT_INT)     /* prints a                                                     */ \
+    X(VM_PRINT_CHAR)    \
+    X(VM_PRINT_BOOL)    \
+    X(VM_PRINT_STR)
+
+typedef enum {
+#define VM_OPCODE_ENUM(name) name,
+    VM_OPCODE_TABLE(VM_OPCODE_ENUM)
+#undef VM_OPCODE_ENUM
+    VM_OPCODE_COUNT
+} vm_opcode_t;
+
+struct vm_insn {
+    // set by vm_run from 'op' before the first run
+    const void *handler;
+    int32_t     op;
+    int32_t     a, b, c;
+};
+
+struct vm_function {
+    const char *name;
+    // index of its first instruction
+    int         entry;
+    int         params;
+    // slots of its frame, temporaries included
+    int         frame_size;
+};
+
+/* a function the program declares but does not define: looked up in the C library, as a compiled program would be linked with it */
+struct vm_native {
+    const char *name;
+    void       *fn;
+    int         params;
+};
+
+struct vm_program {
+    struct vm_insn     *code;
+    int                 code_len, code_cap;
+    struct vm_function *functions;
+    int                 function_count;
+    // index of the function named main
+    int                 main;
+    struct vm_native   *natives;
+    int                 native_count, native_cap;
+    // addresses of string literals' bytes (nul terminated)
+    int64_t            *constants;
+    int                 constant_count, constant_cap;
+    // initial values of the globals, each at the quadword given by its symbol's vm_slot
+    int64_t            *globals;
+    int                 global_count;
+    // whether the code has been threaded (see vm_insn)
+    bool                threaded;
+};
+
+/* translates the (resolved and typechecked) program 'ast' to bytecode: NULL once errors have been reported */
+struct vm_program *vm_compile( struct decl *ast );
+void               vm_delete( struct vm_program *p );
+
+/* runs the program's main function, printing to out_stream, and stores what main returns in 'status':
+   returns the number of runtime errors (which stop the program) */
+int vm_run( struct vm_program *p, int *status );
+
+/* shared with the JIT (see jit.h) */
+/* name of the function instruction 'insn' belongs to */
+const char *vm_function_at( struct vm_program *p, int insn );
+/* base ^ exponent as compiled code computes it */
+int64_t     vm_power( int64_t base, int64_t exponent );
+
+#endif
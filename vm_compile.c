@@ -0,0 +1,649 @@
+#define _GNU_SOURCE // RTLD_DEFAULT
+#include "vm.h"
+#include "stmt.h"
+#include "diag.h"
+#include "arena.h"
+#include "str_lit.h"
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+// arguments a C function can be passed: those that go in registers, as for -codegen
+#define MAX_NATIVE_ARGS 6
+
+// marks the end of a list of jumps waiting for their target (see vm_patch)
+#define NO_JUMP -1
+
+/* program being compiled */
+static struct vm_program *prog = NULL;
+static int err_count = 0;
+/* function being compiled: the lowest slot not holding a variable or live temporary, and the most slots it has needed */
+static int next_slot = 0, frame_size = 0;
+
+/* internal helpers */
+void vm_function(struct decl *d);
+void vm_stmt(struct stmt *s);
+void vm_stmt_one(struct stmt *s);
+void vm_decl(struct decl *d);
+void vm_array_literal(struct expr *lit, struct type *t, int slot);
+void vm_effect(struct expr *e);
+int  vm_expr(struct expr *e, int dest);
+int  vm_operand(struct expr *e, struct expr *later);
+int  vm_ident(struct expr *e, int dest);
+int  vm_elem_addr(struct expr *e);
+int  vm_assign(struct expr *e, int dest);
+int  vm_step(struct expr *e, int dest);
+int  vm_logical(struct expr *e, int dest);
+int  vm_binary(struct expr *e, int dest);
+int  vm_call(struct expr *e, int dest);
+int  vm_branch(struct expr *e, bool when);
+bool vm_writes(struct expr *e);
+int  vm_slot_alloc(int n);
+int  vm_target(int dest, int mark);
+int  vm_emit(vm_opcode_t op, int a, int b, int c);
+void vm_patch(int jumps, int target);
+int  vm_join(int jumps, int more);
+int  vm_string(struct str_lit *lit);
+int  vm_native(struct symbol *sym, int nargs);
+void vm_global_value(struct type *t, struct expr *init, int64_t *at);
+
+struct vm_program *vm_compile(struct decl *ast){
+    prog = calloc(1, sizeof(*prog));
+    if( !prog ) diag_fatal("Could not allocate a bytecode program");
+    prog->main = -1;
+    err_count = 0;
+
+    // every function and global gets its index up front: calls and uses may come before the definition
+    for( struct decl *d = ast; d; d = d->next ){
+        if( d->type->kind == TYPE_FUNCTION ){
+            if( d->symbol->definition != d ) continue;
+            d->symbol->vm_slot = prog->function_count++;
+            if( !strcmp(d->ident, "main") ) prog->main = d->symbol->vm_slot;
+        }
+        else {
+            d->symbol->vm_slot = prog->global_count;
+            prog->global_count += type_size(d->type) / 8;
+        }
+    }
+    prog->functions = calloc(prog->function_count + 1, sizeof(*prog->functions));
+    prog->globals   = calloc(prog->global_count + 1, sizeof(*prog->globals));
+    if( !prog->functions || !prog->globals ) diag_fatal("Could not allocate a bytecode program");
+
+    for( struct decl *d = ast; d; d = d->next ){
+        if( d->type->kind != TYPE_FUNCTION )    vm_global_value(d->type, d->init_value, prog->globals + d->symbol->vm_slot);
+        else if( d->symbol->definition == d )   vm_function(d);
+    }
+    if( prog->main < 0 ){
+        diag_report(DIAG_CODEGEN, 0, "There is no function main to run");
+        err_count++;
+    }
+
+    if( err_count ){
+        vm_delete(prog);
+        return NULL;
+    }
+    return prog;
+}
+
+void vm_delete(struct vm_program *p){
+    if( !p ) return;
+    free(p->code);
+    free(p->functions);
+    free(p->constants);
+    free(p->natives);
+    free(p->globals);
+    free(p);
+}
+
+void vm_function(struct decl *d){
+    struct vm_function *f = &prog->functions[d->symbol->vm_slot];
+    f->name  = d->ident;
+    f->entry = prog->code_len;
+
+    // the caller left the arguments in the first slots
+    next_slot = frame_size = 0;
+    for( struct decl *p = d->type->params; p; p = p->next, f->params++ )
+        p->symbol->vm_slot = vm_slot_alloc(1);
+
+    vm_stmt(d->func_body);
+    // falling off the end returns 0
+    int zero = vm_slot_alloc(1);
+    vm_emit(VM_LOADI, zero, 0, 0);
+    vm_emit(VM_RETURN, zero, 0, 0);
+    f->frame_size = frame_size;
+}
+
+/* statements =========================================================== */
+
+void vm_stmt(struct stmt *s){
+    for( ; s; s = s->next ) vm_stmt_one(s);
+}
+
+void vm_stmt_one(struct stmt *s){
+    // the temporaries of a statement are dead once it is done, the locals of a block once the block is
+    int mark = next_slot, jumps, skip, top;
+    struct expr *e = s->expr_list;
+    switch(s->kind){
+        case STMT_DECL:
+            vm_decl(s->decl);
+            // the local lives on until its block ends
+            return;
+        case STMT_EXPR:
+            vm_effect(e);
+            break;
+        case STMT_IF_ELSE:
+            jumps = vm_branch(e, false);
+            // the else branch hangs off the then branch: compile them one at a time
+            vm_stmt_one(s->body);
+            next_slot = mark;
+            if( s->body->next ){
+                skip = vm_emit(VM_JUMP, NO_JUMP, 0, 0);
+                vm_patch(jumps, prog->code_len);
+                vm_stmt_one(s->body->next);
+                vm_patch(skip, prog->code_len);
+            }
+            else vm_patch(jumps, prog->code_len);
+            break;
+        case STMT_FOR:
+            // the condition is tested at the bottom, so that an iteration takes a single jump
+            vm_effect(e);
+            skip = e->next->kind == EXPR_EMPTY ? NO_JUMP : vm_emit(VM_JUMP, NO_JUMP, 0, 0);
+            top  = prog->code_len;
+            vm_stmt(s->body);
+            next_slot = mark;
+            vm_effect(e->next->next);
+            vm_patch(skip, prog->code_len);
+            if( e->next->kind == EXPR_EMPTY ) vm_emit(VM_JUMP, top, 0, 0);
+            else                              vm_patch(vm_branch(e->next, true), top);
+            break;
+        case STMT_PRINT:
+            for( ; e; e = e->next ){
+                int value = vm_expr(e, -1);
+                switch(e->type->kind){
+                    case TYPE_INTEGER:  vm_emit(VM_PRINT_INT, value, 0, 0);  break;
+                    case TYPE_CHAR:     vm_emit(VM_PRINT_CHAR, value, 0, 0); break;
+                    case TYPE_BOOLEAN:  vm_emit(VM_PRINT_BOOL, value, 0, 0); break;
+                    default:            vm_emit(VM_PRINT_STR, value, 0, 0);  break;
+                }
+                next_slot = mark;
+            }
+            break;
+        case STMT_RETURN:
+            if( e ) vm_emit(VM_RETURN, vm_expr(e, -1), 0, 0);
+            else {
+                int zero = vm_slot_alloc(1);
+                vm_emit(VM_LOADI, zero, 0, 0);
+                vm_emit(VM_RETURN, zero, 0, 0);
+            }
+            break;
+        case STMT_BLOCK:
+            vm_stmt(s->body);
+            break;
+        default:
+            break;
+    }
+    next_slot = mark;
+}
+
+void vm_decl(struct decl *d){
+    /* a local: its slots are taken until its block ends */
+    int quads = type_size(d->type) / 8, slot = vm_slot_alloc(quads);
+    d->symbol->vm_slot = slot;
+    if( d->type->kind == TYPE_ARRAY ){
+        // the typechecker makes an array literal exactly as long as the array
+        if( d->init_value ) vm_array_literal(d->init_value, d->type, slot);
+        else                vm_emit(VM_ZERO, slot, quads, 0);
+    }
+    else if( d->init_value ) vm_expr(d->init_value, slot);
+    else                     vm_emit(VM_LOADI, slot, 0, 0);
+    next_slot = slot + quads;
+}
+
+void vm_array_literal(struct expr *lit, struct type *t, int slot){
+    /* evaluates the elements of 'lit', an array literal of type 't', into the slots from 'slot' up */
+    int stride = type_size(t->subtype) / 8, mark = next_slot;
+    for( struct expr *el = lit->data->arr_elements; el; el = el->next, slot += stride ){
+        if( el->kind == EXPR_ARR_LIT ) vm_array_literal(el, t->subtype, slot);
+        else                           vm_expr(el, slot);
+        next_slot = mark;
+    }
+}
+
+/* expressions ========================================================== */
+
+void vm_effect(struct expr *e){
+    /* 'e' is evaluated for what it does, not for its value */
+    int mark = next_slot;
+    if( e->kind == EXPR_EMPTY ) return;
+    if( e->kind == EXPR_POST_INC || e->kind == EXPR_POST_DEC ){
+        struct expr *target = e->data->operator_args;
+        // a counter's old value is not needed
+        if( target->kind == EXPR_IDENT && target->symbol->kind != SYMBOL_GLOBAL ){
+            vm_emit(VM_ADDI, target->symbol->vm_slot, target->symbol->vm_slot, e->kind == EXPR_POST_INC ? 1 : -1);
+            return;
+        }
+    }
+    vm_expr(e, -1);
+    next_slot = mark;
+}
+
+int vm_expr(struct expr *e, int dest){
+    /* Emits the evaluation of 'e', returning the slot its value is in: 'dest' if that is not -1. Otherwise a variable's own
+       slot, or a temporary at the top of the frame: what it leaves above that is free again.
+       The result is only written once the operands have been read, so 'dest' may be one of the variables they read. */
+    int mark = next_slot, t;
+    long c;
+    switch(e->kind){
+        case EXPR_INT_LIT:
+        case EXPR_CHAR_LIT:
+        case EXPR_BOOL_LIT:
+            t = vm_target(dest, mark);
+            vm_emit(VM_LOADI, t, e->kind == EXPR_INT_LIT  ? e->data->int_data
+                               : e->kind == EXPR_CHAR_LIT ? e->data->char_data
+                               : e->data->bool_data, 0);
+            return t;
+        case EXPR_STR_LIT:
+            t = vm_target(dest, mark);
+            vm_emit(VM_CONST, t, vm_string(e->data->str_data), 0);
+            return t;
+        case EXPR_IDENT:
+            return vm_ident(e, dest);
+        case EXPR_ARR_ACC:
+            if( e->type->kind == TYPE_ARRAY ){
+                // an element that is itself an array is used by address
+                t = vm_elem_addr(e);
+                if( dest < 0 ) return t;
+                vm_emit(VM_MOVE, dest, t, 0);
+                next_slot = mark;
+                return dest;
+            }
+            else {
+                struct expr *array = e->data->operator_args, *index = array->next;
+                int base = vm_operand(array, index), i = vm_expr(index, -1);
+                next_slot = mark;
+                t = vm_target(dest, mark);
+                vm_emit(VM_LOAD_ELEM, t, base, i);
+                return t;
+            }
+        case EXPR_FUNC_CALL:
+            return vm_call(e, dest);
+        case EXPR_ASGN:
+            return vm_assign(e, dest);
+        case EXPR_POST_INC:
+        case EXPR_POST_DEC:
+            return vm_step(e, dest);
+        case EXPR_OR:
+        case EXPR_AND:
+            return vm_logical(e, dest);
+        case EXPR_ADD_ID:
+            return vm_expr(e->data->operator_args->next, dest);
+        case EXPR_NOT:
+        case EXPR_ADD_INV:
+            if( e->kind == EXPR_ADD_INV && expr_const_int(e, &c) && c == (int32_t) c ){
+                t = vm_target(dest, mark);
+                vm_emit(VM_LOADI, t, c, 0);
+                return t;
+            }
+            t = vm_expr(e->data->operator_args->next, -1);
+            next_slot = mark;
+            dest = vm_target(dest, mark);
+            vm_emit(e->kind == EXPR_NOT ? VM_NOT : VM_NEG, dest, t, 0);
+            return dest;
+        default:
+            return vm_binary(e, dest);
+    }
+}
+
+int vm_operand(struct expr *e, struct expr *later){
+    /* evaluates 'e', an operand whose value is used after 'later' is evaluated: a variable 'later' assigns to is copied first */
+    int mark = next_slot, slot = vm_expr(e, -1);
+    if( slot >= mark || !vm_writes(later) ) return slot;
+    int copy = vm_slot_alloc(1);
+    vm_emit(VM_MOVE, copy, slot, 0);
+    return copy;
+}
+
+int vm_ident(struct expr *e, int dest){
+    struct symbol *sym = e->symbol;
+    bool array = e->type->kind == TYPE_ARRAY;
+    // arrays are stored in place, so their value is their address: parameters hold the address the caller passed
+    if( sym->kind == SYMBOL_GLOBAL ){
+        int t = vm_target(dest, next_slot);
+        vm_emit(array ? VM_GLOBAL_ADDR : VM_GLOBAL, t, sym->vm_slot, 0);
+        return t;
+    }
+    if( array && sym->kind == SYMBOL_LOCAL ){
+        int t = vm_target(dest, next_slot);
+        vm_emit(VM_LOCAL_ADDR, t, sym->vm_slot, 0);
+        return t;
+    }
+    if( dest < 0 ) return sym->vm_slot;
+    if( dest != sym->vm_slot ) vm_emit(VM_MOVE, dest, sym->vm_slot, 0);
+    return dest;
+}
+
+int vm_elem_addr(struct expr *e){
+    /* leaves the address of array element 'e' in a temporary */
+    int mark = next_slot;
+    struct expr *array = e->data->operator_args, *index = array->next;
+    int base = vm_operand(array, index), i = vm_expr(index, -1);
+    int stride = type_size(e->type) / 8;
+    if( stride != 1 ){
+        int scaled = vm_slot_alloc(1);
+        vm_emit(VM_MULI, scaled, i, stride);
+        i = scaled;
+    }
+    next_slot = mark;
+    int t = vm_slot_alloc(1);
+    vm_emit(VM_ELEM_ADDR, t, base, i);
+    return t;
+}
+
+int vm_assign(struct expr *e, int dest){
+    /* as compiled code does, the value is evaluated before where it goes */
+    int mark = next_slot;
+    struct expr *lvalue = e->data->operator_args, *value = lvalue->next;
+    struct symbol *sym = lvalue->kind == EXPR_IDENT ? lvalue->symbol : NULL;
+
+    if( sym && sym->kind != SYMBOL_GLOBAL ){
+        vm_expr(value, sym->vm_slot);
+        if( dest < 0 || dest == sym->vm_slot ) return sym->vm_slot;
+        vm_emit(VM_MOVE, dest, sym->vm_slot, 0);
+        return dest;
+    }
+    if( sym ){
+        int v = vm_expr(value, dest);
+        vm_emit(VM_SET_GLOBAL, sym->vm_slot, v, 0);
+        return v;
+    }
+
+    int v = vm_operand(value, lvalue);
+    struct expr *array = lvalue->data->operator_args, *index = array->next;
+    int base = vm_operand(array, index), i = vm_expr(index, -1);
+    vm_emit(VM_STORE_ELEM, base, i, v);
+    if( dest < 0 ){
+        // only the value is still needed: a temporary holding it is the first one taken
+        next_slot = v >= mark ? v + 1 : mark;
+        return v;
+    }
+    vm_emit(VM_MOVE, dest, v, 0);
+    next_slot = mark;
+    return dest;
+}
+
+int vm_step(struct expr *e, int dest){
+    /* ++ and --: the value is the one from before, so it goes in a temporary even when 'dest' is the variable stepped */
+    int mark = next_slot, delta = e->kind == EXPR_POST_INC ? 1 : -1;
+    struct expr *target = e->data->operator_args;
+    int old = vm_slot_alloc(1);
+    if( target->kind == EXPR_IDENT && target->symbol->kind != SYMBOL_GLOBAL ){
+        vm_emit(VM_MOVE, old, target->symbol->vm_slot, 0);
+        vm_emit(VM_ADDI, target->symbol->vm_slot, target->symbol->vm_slot, delta);
+    }
+    else if( target->kind == EXPR_IDENT ){
+        int stepped = vm_slot_alloc(1);
+        vm_emit(VM_GLOBAL, old, target->symbol->vm_slot, 0);
+        vm_emit(VM_ADDI, stepped, old, delta);
+        vm_emit(VM_SET_GLOBAL, target->symbol->vm_slot, stepped, 0);
+    }
+    else {
+        int addr = vm_elem_addr(target), stepped = vm_slot_alloc(1);
+        vm_emit(VM_LOAD, old, addr, 0);
+        vm_emit(VM_ADDI, stepped, old, delta);
+        vm_emit(VM_STORE, addr, stepped, 0);
+    }
+    next_slot = mark + 1;
+    if( dest < 0 ) return old;
+    vm_emit(VM_MOVE, dest, old, 0);
+    next_slot = mark;
+    return dest;
+}
+
+int vm_logical(struct expr *e, int dest){
+    /* short-circuits: the right operand is only evaluated when the left one does not decide the result */
+    int mark = next_slot, t = vm_slot_alloc(1);
+    struct expr *left = e->data->operator_args;
+    vm_expr(left, t);
+    int done = vm_emit(e->kind == EXPR_AND ? VM_JUMP_UNLESS : VM_JUMP_IF, NO_JUMP, t, 0);
+    vm_expr(left->next, t);
+    vm_patch(done, prog->code_len);
+    next_slot = mark + 1;
+    if( dest < 0 ) return t;
+    vm_emit(VM_MOVE, dest, t, 0);
+    next_slot = mark;
+    return dest;
+}
+
+int vm_binary(struct expr *e, int dest){
+    int mark = next_slot;
+    struct expr *left = e->data->operator_args, *right = left->next;
+    long c;
+    vm_opcode_t op;
+    switch(e->kind){
+        case EXPR_ADD:      op = VM_ADD; break;
+        case EXPR_SUB:      op = VM_SUB; break;
+        case EXPR_MUL:      op = VM_MUL; break;
+        case EXPR_DIV:      op = VM_DIV; break;
+        case EXPR_MOD:      op = VM_MOD; break;
+        case EXPR_EXP:      op = VM_EXP; break;
+        case EXPR_LT:       op = VM_LT;  break;
+        case EXPR_LT_EQ:    op = VM_LE;  break;
+        case EXPR_GT:       op = VM_GT;  break;
+        case EXPR_GT_EQ:    op = VM_GE;  break;
+        // strings are equal by content
+        case EXPR_EQ:       op = left->type->kind == TYPE_STRING ? VM_STR_EQ : VM_EQ; break;
+        case EXPR_NOT_EQ:   op = left->type->kind == TYPE_STRING ? VM_STR_NE : VM_NE; break;
+        default:
+            // array literals only appear as initializers, which vm_decl and vm_global_value lay out
+            diag_fatal("No bytecode for %s", expr_to_str(e));
+            return dest;
+    }
+
+    // a constant added, subtracted or multiplied by is part of the instruction
+    bool immediate = (op == VM_ADD || op == VM_SUB || op == VM_MUL) && expr_const_int(right, &c)
+                     && c == (int32_t) c && -c == (int32_t) -c;
+    int l = immediate ? vm_expr(left, -1) : vm_operand(left, right);
+    int r = immediate ? 0 : vm_expr(right, -1);
+    next_slot = mark;
+    int t = vm_target(dest, mark);
+    if( immediate ) vm_emit(op == VM_MUL ? VM_MULI : VM_ADDI, t, l, op == VM_SUB ? -c : c);
+    else            vm_emit(op, t, l, r);
+    return t;
+}
+
+int vm_call(struct expr *e, int dest){
+    /* the arguments go in consecutive slots at the top of the frame, where the callee's frame will start */
+    int mark = next_slot;
+    struct expr *callee = e->data->func_and_args;
+    int nargs = 0;
+    for( struct expr *arg = callee->next; arg; arg = arg->next ) nargs++;
+    // a function defined elsewhere is called in the C library
+    int native = callee->symbol->definition ? -1 : vm_native(callee->symbol, nargs);
+
+    int base = vm_slot_alloc(nargs), i = 0;
+    for( struct expr *arg = callee->next; arg; arg = arg->next, i++ ){
+        vm_expr(arg, base + i);
+        next_slot = base + nargs;
+    }
+    next_slot = mark;
+    int t = vm_target(dest, mark);
+    if( native < 0 ) vm_emit(VM_CALL, t, callee->symbol->vm_slot, base);
+    else             vm_emit(VM_CALL_NATIVE, t, native, base);
+    return t;
+}
+
+int vm_branch(struct expr *e, bool when){
+    /* emits jumps taken when 'e' is 'when', and returns them, for vm_patch to give them their target */
+    static const vm_opcode_t jump_if[] = {
+        [EXPR_LT] = VM_JUMP_LT, [EXPR_LT_EQ] = VM_JUMP_LE, [EXPR_GT] = VM_JUMP_GT,
+        [EXPR_GT_EQ] = VM_JUMP_GE, [EXPR_EQ] = VM_JUMP_EQ, [EXPR_NOT_EQ] = VM_JUMP_NE
+    };
+    static const vm_opcode_t jump_unless[] = {
+        [EXPR_LT] = VM_JUMP_GE, [EXPR_LT_EQ] = VM_JUMP_GT, [EXPR_GT] = VM_JUMP_LE,
+        [EXPR_GT_EQ] = VM_JUMP_LT, [EXPR_EQ] = VM_JUMP_NE, [EXPR_NOT_EQ] = VM_JUMP_EQ
+    };
+    int mark = next_slot, jumps, skip;
+    struct expr *left = NULL, *right = NULL;
+    if( expr_fixity(e->kind) != FIX_NONE ){
+        left  = e->data->operator_args;
+        right = left->next;
+    }
+    long c;
+
+    switch(e->kind){
+        case EXPR_NOT:
+            return vm_branch(right, !when);
+        case EXPR_AND:
+        case EXPR_OR:
+            // 'a && b' is false as soon as a is, 'a || b' true as soon as a is: otherwise b decides
+            if( (e->kind == EXPR_AND) != when ){
+                jumps = vm_branch(left, when);
+                return vm_join(jumps, vm_branch(right, when));
+            }
+            skip  = vm_branch(left, !when);
+            jumps = vm_branch(right, when);
+            vm_patch(skip, prog->code_len);
+            return jumps;
+        case EXPR_BOOL_LIT:
+            return e->data->bool_data == when ? vm_emit(VM_JUMP, NO_JUMP, 0, 0) : NO_JUMP;
+        case EXPR_LT:
+        case EXPR_LT_EQ:
+        case EXPR_GT:
+        case EXPR_GT_EQ:
+        case EXPR_EQ:
+        case EXPR_NOT_EQ:
+            if( left->type->kind == TYPE_STRING ) break;
+            vm_opcode_t op = when ? jump_if[e->kind] : jump_unless[e->kind];
+            if( expr_const_int(right, &c) && c == (int32_t) c ){
+                // the immediate forms follow the register forms in the same order
+                int l = vm_expr(left, -1);
+                next_slot = mark;
+                return vm_emit(op + VM_JUMP_LTI - VM_JUMP_LT, NO_JUMP, l, c);
+            }
+            int l = vm_operand(left, right), r = vm_expr(right, -1);
+            next_slot = mark;
+            return vm_emit(op, NO_JUMP, l, r);
+        default:
+            break;
+    }
+    int v = vm_expr(e, -1);
+    next_slot = mark;
+    return vm_emit(when ? VM_JUMP_IF : VM_JUMP_UNLESS, NO_JUMP, v, 0);
+}
+
+bool vm_writes(struct expr *e){
+    /* whether evaluating 'e' may store to a variable of the frame */
+    if( !e ) return false;
+    switch(e->kind){
+        case EXPR_ASGN:
+        case EXPR_POST_INC:
+        case EXPR_POST_DEC:
+            return true;
+        case EXPR_EMPTY:
+        case EXPR_IDENT:
+        case EXPR_INT_LIT:
+        case EXPR_STR_LIT:
+        case EXPR_CHAR_LIT:
+        case EXPR_BOOL_LIT:
+            return false;
+        default:
+            // operands, array elements, or the function and its arguments: the union puts them all in the same place
+            for( struct expr *operand = e->data->operator_args; operand; operand = operand->next )
+                if( vm_writes(operand) ) return true;
+            return false;
+    }
+}
+
+/* slots, instructions and constants ==================================== */
+
+int vm_slot_alloc(int n){
+    int slot = next_slot;
+    next_slot += n;
+    if( next_slot > frame_size ) frame_size = next_slot;
+    return slot;
+}
+
+int vm_target(int dest, int mark){
+    /* the slot a result goes in: 'dest', or a temporary at 'mark' (the top of the frame before the operands) */
+    next_slot = mark;
+    return dest >= 0 ? dest : vm_slot_alloc(1);
+}
+
+int vm_emit(vm_opcode_t op, int a, int b, int c){
+    if( prog->code_len == prog->code_cap ){
+        prog->code_cap = prog->code_cap ? 2 * prog->code_cap : 256;
+        struct vm_insn *bigger = realloc(prog->code, prog->code_cap * sizeof(*bigger));
+        if( !bigger ) diag_fatal("Could not allocate %d bytecode instructions", prog->code_cap);
+        prog->code = bigger;
+    }
+    prog->code[prog->code_len] = (struct vm_insn) { .handler = NULL, .op = op, .a = a, .b = b, .c = c };
+    return prog->code_len++;
+}
+
+void vm_patch(int jumps, int target){
+    /* a jump waiting for its target holds the next one in the list in its 'a' */
+    while( jumps != NO_JUMP ){
+        int next = prog->code[jumps].a;
+        prog->code[jumps].a = target;
+        jumps = next;
+    }
+}
+
+int vm_join(int jumps, int more){
+    if( jumps == NO_JUMP ) return more;
+    int last = jumps;
+    while( prog->code[last].a != NO_JUMP ) last = prog->code[last].a;
+    prog->code[last].a = more;
+    return jumps;
+}
+
+int vm_string(struct str_lit *lit){
+    /* the literal's bytes, nul terminated, as a constant */
+    if( prog->constant_count == prog->constant_cap ){
+        prog->constant_cap = prog->constant_cap ? 2 * prog->constant_cap : 64;
+        int64_t *bigger = realloc(prog->constants, prog->constant_cap * sizeof(*bigger));
+        if( !bigger ) diag_fatal("Could not allocate %d bytecode constants", prog->constant_cap);
+        prog->constants = bigger;
+    }
+    prog->constants[prog->constant_count] = (intptr_t) arena_strndup(str_lit_bytes(lit), lit->len);
+    return prog->constant_count++;
+}
+
+int vm_native(struct symbol *sym, int nargs){
+    /* index of the C function named like 'sym' in the program's natives, looking it up the first time */
+    for( int i = 0; i < prog->native_count; i++ )
+        if( !strcmp(prog->natives[i].name, sym->name) ) return i;
+
+    void *fn = dlsym(RTLD_DEFAULT, sym->name);
+    if( !fn || nargs > MAX_NATIVE_ARGS ){
+        diag_report(DIAG_CODEGEN, 0, fn ? "Function %s is declared but not defined: C functions take at most %d arguments"
+                                        : "Function %s is declared but not defined, and the C library has no such function",
+                    sym->name, MAX_NATIVE_ARGS);
+        err_count++;
+        return 0;
+    }
+    if( prog->native_count == prog->native_cap ){
+        prog->native_cap = prog->native_cap ? 2 * prog->native_cap : 8;
+        struct vm_native *bigger = realloc(prog->natives, prog->native_cap * sizeof(*bigger));
+        if( !bigger ) diag_fatal("Could not allocate %d C functions", prog->native_cap);
+        prog->natives = bigger;
+    }
+    prog->natives[prog->native_count] = (struct vm_native) { sym->name, fn, nargs };
+    return prog->native_count++;
+}
+
+void vm_global_value(struct type *t, struct expr *init, int64_t *at){
+    /* the typechecker only lets constant initializers through; the storage is zero to start with */
+    if( !init ) return;
+    if( init->kind == EXPR_ARR_LIT ){
+        for( struct expr *el = init->data->arr_elements; el; el = el->next, at += type_size(t->subtype) / 8 )
+            vm_global_value(t->subtype, el, at);
+        return;
+    }
+    long val = 0;
+    if( init->kind == EXPR_STR_LIT )        val = (intptr_t) arena_strndup(str_lit_bytes(init->data->str_data), init->data->str_data->len);
+    else if( init->kind == EXPR_CHAR_LIT )  val = init->data->char_data;
+    else if( init->kind == EXPR_BOOL_LIT )  val = init->data->bool_data;
+    else                                    expr_const_int(init, &val);
+    *at = val;
+}
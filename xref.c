@@ -0,0 +1,312 @@
+#include "xref.h"
+#include "diag.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* identifies an index, and the layout version: bump the last byte when the layout changes */
+static const char xref_magic[8] = { 'B', 'M', 'X', 'R', 'E', 'F', '\0', 1 };
+
+/* the tables of an index while the program is walked: sites are sorted by symbol when it is written */
+struct xref_builder {
+    struct xref_symbol *symbols;
+    uint32_t            symbol_count, symbol_cap;
+    struct xref_site   *sites;
+    uint32_t            site_count, site_cap;
+    char               *names;
+    uint32_t            names_size, names_cap;
+    // the index of each symbol met so far, by address (open addressing, at most half full)
+    struct symbol     **seen;
+    uint32_t           *seen_ids;
+    uint32_t            seen_cap;
+};
+
+/* internal helpers */
+void     xref_decl(struct xref_builder *b, struct decl *d);
+void     xref_declared(struct xref_builder *b, struct decl *d);
+void     xref_type(struct xref_builder *b, struct type *t);
+void     xref_stmt(struct xref_builder *b, struct stmt *s);
+void     xref_expr(struct xref_builder *b, struct expr *e);
+uint32_t xref_symbol_id(struct xref_builder *b, struct symbol *sym);
+void     xref_add_site(struct xref_builder *b, uint32_t symbol, int line, int column, xref_site_t kind);
+void    *xref_grow(void *array, uint32_t *cap, uint32_t needed, size_t elem_size);
+uint32_t xref_hash(uint32_t line, uint32_t column);
+int      xref_compare_sites(const void *a, const void *b);
+void     xref_builder_delete(struct xref_builder *b);
+
+int xref_write(struct decl *ast, const char *path){
+    struct xref_builder b = {0};
+    xref_decl(&b, ast);
+
+    // every site of a symbol together, in source order
+    qsort(b.sites, b.site_count, sizeof(*b.sites), xref_compare_sites);
+    for( uint32_t i = 0; i < b.site_count; i++ ){
+        struct xref_symbol *sym = &b.symbols[b.sites[i].symbol];
+        if( !sym->site_count ) sym->first_site = i;
+        sym->site_count++;
+    }
+
+    // every position the index knows, at most half the slots full so that probes stay short
+    uint32_t positions = b.site_count;
+    for( uint32_t i = 0; i < b.symbol_count; i++ ) positions += b.symbols[i].line != 0;
+    uint32_t slot_count = positions ? 2 : 0;
+    while( slot_count && slot_count < 2 * positions ) slot_count *= 2;
+    struct xref_slot *slots = calloc(slot_count ? slot_count : 1, sizeof(*slots));
+    if( !slots ) diag_fatal("Could not allocate the position table of %s", path);
+    for( uint32_t i = 0; i < b.symbol_count + b.site_count; i++ ){
+        // definitions, then the other sites
+        struct xref_slot entry = i < b.symbol_count
+                                 ? (struct xref_slot){ b.symbols[i].line, b.symbols[i].column, i + 1 }
+                                 : (struct xref_slot){ b.sites[i - b.symbol_count].line, b.sites[i - b.symbol_count].column,
+                                                       b.sites[i - b.symbol_count].symbol + 1 };
+        if( !entry.line ) continue;
+        uint32_t at = xref_hash(entry.line, entry.column) & (slot_count - 1);
+        while( slots[at].symbol ) at = (at + 1) & (slot_count - 1);
+        slots[at] = entry;
+    }
+
+    int err_count = 0;
+    FILE *f = fopen(path, "wb");
+    if( !f ){
+        diag_report(DIAG_FILE, 0, "Could not open %s! %s", path, strerror(errno));
+        err_count++;
+    }
+    else {
+        struct xref_header header = { .symbols = b.symbol_count, .sites = b.site_count, .slots = slot_count, .names = b.names_size };
+        memcpy(header.magic, xref_magic, sizeof(xref_magic));
+        fwrite(&header, sizeof(header), 1, f);
+        fwrite(b.symbols, sizeof(*b.symbols), b.symbol_count, f);
+        fwrite(b.sites, sizeof(*b.sites), b.site_count, f);
+        fwrite(slots, sizeof(*slots), slot_count, f);
+        fwrite(b.names, 1, b.names_size, f);
+        if( ferror(f) ){
+            diag_report(DIAG_FILE, 0, "Could not write %s! %s", path, strerror(errno));
+            err_count++;
+        }
+        if( fclose(f) && !err_count ){
+            diag_report(DIAG_FILE, 0, "Could not write %s! %s", path, strerror(errno));
+            err_count++;
+        }
+        // don't leave a partial index for a tool to map
+        if( err_count ) remove(path);
+    }
+
+    free(slots);
+    xref_builder_delete(&b);
+    return err_count;
+}
+
+void xref_builder_delete(struct xref_builder *b){
+    free(b->symbols);
+    free(b->sites);
+    free(b->names);
+    free(b->seen);
+    free(b->seen_ids);
+}
+
+void xref_decl(struct xref_builder *b, struct decl *d){
+    for( ; d; d = d->next ){
+        if( d->symbol ) xref_declared(b, d);
+        xref_type(b, d->type);
+        xref_expr(b, d->init_value);
+        xref_stmt(b, d->func_body);
+    }
+}
+
+void xref_declared(struct xref_builder *b, struct decl *d){
+    /* 'd' declares its symbol: the symbol's definition if it is the first declaration, or the one with the body */
+    uint32_t id = xref_symbol_id(b, d->symbol);
+    struct xref_symbol *sym = &b->symbols[id];
+    // a symbol first met in a use, or not at all, has no declaration yet
+    if( !sym->line ){
+        sym->line   = d->line;
+        sym->column = d->column;
+    }
+    else if( d->symbol->definition == d ){
+        // the body comes after a prototype, which becomes one of the other declarations
+        xref_add_site(b, id, sym->line, sym->column, XREF_DECLARATION);
+        sym->line   = d->line;
+        sym->column = d->column;
+    }
+    else xref_add_site(b, id, d->line, d->column, XREF_DECLARATION);
+}
+
+void xref_type(struct xref_builder *b, struct type *t){
+    for( ; t; t = t->subtype ){
+        xref_expr(b, t->arr_sz);
+        xref_decl(b, t->params);
+    }
+}
+
+void xref_stmt(struct xref_builder *b, struct stmt *s){
+    for( ; s; s = s->next ){
+        xref_decl(b, s->decl);
+        xref_expr(b, s->expr_list);
+        xref_stmt(b, s->body);
+    }
+}
+
+void xref_expr(struct xref_builder *b, struct expr *e){
+    for( ; e; e = e->next ){
+        switch(e->kind){
+            case EXPR_IDENT:
+                // only a program that resolved is indexed, but a symbol loaded with -include has no declaration in it
+                if( e->symbol ) xref_add_site(b, xref_symbol_id(b, e->symbol), e->line, e->column, XREF_USE);
+                break;
+            case EXPR_EMPTY:
+            case EXPR_INT_LIT:
+            case EXPR_STR_LIT:
+            case EXPR_CHAR_LIT:
+            case EXPR_BOOL_LIT:
+                break;
+            default:
+                // operands, array elements, or the function and its arguments: the union puts them all in the same place
+                xref_expr(b, e->data->operator_args);
+                break;
+        }
+    }
+}
+
+uint32_t xref_symbol_id(struct xref_builder *b, struct symbol *sym){
+    /* index of 'sym' in the symbol table, adding it (not yet declared: line 0) the first time */
+    if( 2 * (b->symbol_count + 1) > b->seen_cap ){
+        uint32_t old_cap = b->seen_cap;
+        struct symbol **old = b->seen;
+        uint32_t *old_ids = b->seen_ids;
+        b->seen_cap = old_cap ? old_cap * 2 : 64;
+        b->seen     = calloc(b->seen_cap, sizeof(*b->seen));
+        b->seen_ids = malloc(b->seen_cap * sizeof(*b->seen_ids));
+        if( !b->seen || !b->seen_ids ) diag_fatal("Could not allocate the cross-reference symbol map");
+        for( uint32_t i = 0; i < old_cap; i++ ){
+            if( !old[i] ) continue;
+            uint32_t at = xref_hash((uintptr_t)old[i] >> 4, (uintptr_t)old[i] >> 36) & (b->seen_cap - 1);
+            while( b->seen[at] ) at = (at + 1) & (b->seen_cap - 1);
+            b->seen[at]     = old[i];
+            b->seen_ids[at] = old_ids[i];
+        }
+        free(old);
+        free(old_ids);
+    }
+
+    uint32_t at = xref_hash((uintptr_t)sym >> 4, (uintptr_t)sym >> 36) & (b->seen_cap - 1);
+    for( ; b->seen[at]; at = (at + 1) & (b->seen_cap - 1) )
+        if( b->seen[at] == sym ) return b->seen_ids[at];
+
+    size_t name_len = strlen(sym->name) + 1;
+    b->names = xref_grow(b->names, &b->names_cap, b->names_size + name_len, 1);
+    memcpy(b->names + b->names_size, sym->name, name_len);
+
+    b->symbols = xref_grow(b->symbols, &b->symbol_cap, b->symbol_count + 1, sizeof(*b->symbols));
+    b->symbols[b->symbol_count] = (struct xref_symbol){ .name = b->names_size, .kind = sym->kind };
+    b->names_size += name_len;
+
+    b->seen[at]     = sym;
+    b->seen_ids[at] = b->symbol_count;
+    return b->symbol_count++;
+}
+
+void xref_add_site(struct xref_builder *b, uint32_t symbol, int line, int column, xref_site_t kind){
+    b->sites = xref_grow(b->sites, &b->site_cap, b->site_count + 1, sizeof(*b->sites));
+    b->sites[b->site_count++] = (struct xref_site){ line, column, symbol, kind };
+}
+
+void *xref_grow(void *array, uint32_t *cap, uint32_t needed, size_t elem_size){
+    /* 'array' with room for at least 'needed' elements, doubling its capacity as needed */
+    if( needed <= *cap ) return array;
+    uint32_t new_cap = *cap ? *cap : 64;
+    while( new_cap < needed ) new_cap *= 2;
+    void *bigger = realloc(array, (size_t)new_cap * elem_size);
+    if( !bigger ) diag_fatal("Could not allocate %zu bytes for the cross-reference index", (size_t)new_cap * elem_size);
+    *cap = new_cap;
+    return bigger;
+}
+
+uint32_t xref_hash(uint32_t line, uint32_t column){
+    // multiplicative mixing of both halves, so that neighboring positions land far apart
+    uint32_t h = line * 0x9E3779B1u ^ column * 0x85EBCA77u;
+    return h ^ (h >> 15);
+}
+
+int xref_compare_sites(const void *a, const void *b){
+    const struct xref_site *x = a, *y = b;
+    if( x->symbol != y->symbol ) return x->symbol < y->symbol ? -1 : 1;
+    if( x->line != y->line )     return x->line < y->line ? -1 : 1;
+    return (x->column > y->column) - (x->column < y->column);
+}
+
+/* reading ============================================================== */
+
+int xref_open(const char *path, struct xref_index *idx){
+    memset(idx, 0, sizeof(*idx));
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if( fd < 0 || fstat(fd, &st) ){
+        diag_report(DIAG_FILE, 0, "Could not open %s! %s", path, strerror(errno));
+        if( fd >= 0 ) close(fd);
+        return 1;
+    }
+    size_t size = st.st_size;
+    void *map = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if( map == MAP_FAILED ){
+        diag_report(DIAG_FILE, 0, "Could not map %s! %s", path, size ? strerror(errno) : "Empty file");
+        return 1;
+    }
+
+    // the tables must fill the file exactly, and the names must end in a nul so that every one of them does
+    const struct xref_header *h = map;
+    size_t expected = 0;
+    if( size >= sizeof(*h) && !memcmp(h->magic, xref_magic, sizeof(xref_magic)) )
+        expected = sizeof(*h) + (size_t)h->symbols * sizeof(struct xref_symbol) + (size_t)h->sites * sizeof(struct xref_site)
+                 + (size_t)h->slots * sizeof(struct xref_slot) + h->names;
+    if( !expected || expected != size || (h->slots & (h->slots - 1)) || (h->names && ((char *)map)[size - 1]) ){
+        diag_report(DIAG_FILE, 0, "%s is not a cross-reference index written by this version of bminor", path);
+        munmap(map, size);
+        return 1;
+    }
+
+    idx->map     = map;
+    idx->size    = size;
+    idx->header  = h;
+    idx->symbols = (const struct xref_symbol *)(h + 1);
+    idx->sites   = (const struct xref_site *)(idx->symbols + h->symbols);
+    idx->slots   = (const struct xref_slot *)(idx->sites + h->sites);
+    idx->names   = (const char *)(idx->slots + h->slots);
+    return 0;
+}
+
+void xref_close(struct xref_index *idx){
+    if( idx->map ) munmap(idx->map, idx->size);
+    memset(idx, 0, sizeof(*idx));
+}
+
+const struct xref_symbol *xref_lookup(const struct xref_index *idx, uint32_t line, uint32_t column){
+    uint32_t mask = idx->header->slots - 1;
+    if( !idx->header->slots ) return NULL;
+    // a full table would never end the probe: a corrupt one is cut off after a lap
+    for( uint32_t at = xref_hash(line, column) & mask, probes = 0; probes <= mask; at = (at + 1) & mask, probes++ ){
+        const struct xref_slot *slot = &idx->slots[at];
+        if( !slot->symbol ) return NULL;
+        if( slot->line == line && slot->column == column )
+            return slot->symbol <= idx->header->symbols ? &idx->symbols[slot->symbol - 1] : NULL;
+    }
+    return NULL;
+}
+
+const char *xref_name(const struct xref_index *idx, const struct xref_symbol *sym){
+    return sym->name < idx->header->names ? idx->names + sym->name : "";
+}
+
+const struct xref_site *xref_sites(const struct xref_index *idx, const struct xref_symbol *sym, uint32_t *count){
+    if( sym->first_site > idx->header->sites || sym->site_count > idx->header->sites - sym->first_site ){
+        *count = 0;
+        return NULL;
+    }
+    *count = sym->site_count;
+    return idx->sites + sym->first_site;
+}
@@ -0,0 +1,78 @@
+#ifndef XREF_H
+#define XREF_H
+
+#include "decl.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* Cross-reference index: each symbol of a resolved program, where it is defined and every place it is used, laid out so that
+   a navigation tool maps the file and answers "go to definition" or "find references" at a position with one hash probe,
+   instead of resolving the program again for every query.
+   Positions are 1-based lines and byte columns of a name's first character; a global loaded with -include is defined at line 0.
+   Like precompiled headers, indexes are in the byte order of the machine that wrote them.
+   The file is the header, then the symbol, site and slot tables, then the names, with no padding between them. */
+
+struct xref_header {
+    char     magic[8];
+    uint32_t symbols;
+    uint32_t sites;
+    // a power of two (or 0)
+    uint32_t slots;
+    // bytes of nul-terminated names
+    uint32_t names;
+};
+
+struct xref_symbol {
+    // offset of the name in the names
+    uint32_t name;
+    // a symbol_t
+    uint32_t kind;
+    // the declaration with the body for a function that has one, the first declaration otherwise
+    uint32_t line, column;
+    // its sites are sites[first_site] to sites[first_site + site_count - 1], in source order
+    uint32_t first_site, site_count;
+};
+
+typedef enum {
+    XREF_USE,           // an identifier naming the symbol
+    XREF_DECLARATION    // a declaration other than the definition: another prototype of a function
+} xref_site_t;
+
+struct xref_site {
+    uint32_t line, column;
+    uint32_t symbol;
+    // an xref_site_t
+    uint32_t kind;
+};
+
+/* open addressing on the position, over every definition and site: 'symbol' is one more than the symbol's index, 0 if empty */
+struct xref_slot {
+    uint32_t line, column;
+    uint32_t symbol;
+};
+
+/* an index mapped into memory */
+struct xref_index {
+    void   *map;
+    size_t  size;
+    const struct xref_header *header;
+    const struct xref_symbol *symbols;
+    const struct xref_site   *sites;
+    const struct xref_slot   *slots;
+    const char               *names;
+};
+
+/* writes the index of 'ast', which must have resolved, to 'path': returns the number of errors */
+int  xref_write( struct decl *ast, const char *path );
+
+/* maps the index at 'path': returns the number of errors (checks only what lookups rely on, so opening is constant time) */
+int  xref_open( const char *path, struct xref_index *idx );
+void xref_close( struct xref_index *idx );
+
+/* the symbol defined or used at 'line', 'column' (the first character of the name), NULL if there is none */
+const struct xref_symbol *xref_lookup( const struct xref_index *idx, uint32_t line, uint32_t column );
+/* the symbol's name, and its sites (NULL with 'count' 0 if the index is corrupt) */
+const char             *xref_name( const struct xref_index *idx, const struct xref_symbol *sym );
+const struct xref_site *xref_sites( const struct xref_index *idx, const struct xref_symbol *sym, uint32_t *count );
+
+#endif